@@ -8,10 +8,12 @@
 #include <Callback.h>
 #include <Menu.h>
 #include <DisplayMgr.h>
-#include <string>
 #include <debug.h>
+#include <Format.h>
+#include <Patches.h>
 
 #include "AltoidMidi.h"
+#include "SysEx.h"
 
 
 Knob knobA("Casio", A7, A8, A9);
@@ -37,13 +39,9 @@ ChannelState ChannelState::currentState[] = {
     ChannelState(15, &knobA)
 };
 
-const char* const PROGMEM programs[] = {"Off", "Lead", "Piano", "Orch+Piano", "Orchestra", "Orch+Pad", "Pad", "Reed", "Flutes", "Brass", "Strings", "B", "C4", "C#4", "Percussion", "Tuned Perc", "E4", "F4", "F#4", "Solo 1", "Solo 2", "Solo 3", "Solo 4", "FX"};
-const uint8_t num_programs = sizeof(programs)/sizeof(const char *);
-DMenu programMenu(num_programs, programs);
-
-const char* const PROGMEM kits[] = {"Percussion", "Tuned Perc", "E4", "F4", "F#4", "Solo 1", "Solo 2", "Solo 3", "Solo 4", "FX"};
-const uint8_t num_kits = sizeof(kits)/sizeof(const char *);
-DMenu kitMenu(num_kits, kits);
+// The names are generated from patches/*.csv; see tools/patchlists.py.
+DMenu programMenu(programs);
+DMenu kitMenu(kits);
 
 
 // When we last sent a message. We suppress display of incoming MIDI for 500 ms after sending
@@ -51,32 +49,145 @@ uint32_t last_receive = 0;
 const uint32_t receive_display_delay = 500;
 
 
-const char * PROGMEM DIGITS = "0123456789abcdef";
+const char *noteName(uint8_t note) {
+    return NoteNames::name(note);
+}
+
+// A channel's program, in bold, or inverted and indented when the channel is off. For a knob
+// sending a controller, the controller and its value instead.
+class ChannelLine: public Label {
+    public:
+        uint8_t channel;
+        ChannelLine(lcdint_t y, uint8_t channel): Label(0, y, 128, 16), channel(channel) {}
+
+        // Show a different channel.
+        void show(uint8_t ch) {
+            channel = ch;
+            m_control = nullptr;
+            sync();
+        }
 
+        // Show a controller.
+        void show(const ControlOutput &control) {
+            channel = control.channel();
+            m_control = &control;
+            sync();
+        }
 
-const char * const PROGMEM NOTES[] = { "C", "C#", "D", "D#", "E", "F", "F#", "G", "G#", "A", "A#", "B" };
+        // Take up the channel's current state. The line is invalidated only if that changed.
+        void sync() {
+            if (m_control) {
+                syncControl();
+                return;
+            }
+            auto &state = ChannelState::currentState[channel - 1];
+            text(state.programName)
+                .style(state.on ? STYLE_BOLD : STYLE_NORMAL)
+                .inverted(!state.on)
+                .indent(state.on ? 0 : 12);
+        }
 
-std::string noteName(int note) {
-    const char * note_name = NOTES[((int)note) % 12];
-    int octave = ((int) note) / 12 - 2;
-    return std::string(note_name) + std::to_string(octave) + (strlen(note_name) < 2 ? " " : "");
+        bool render(Window &w, bool force = false) {
+            if (force || m_dirty) {
+                sync();
+            }
+            return Label::render(w, force);
+        }
+
+    private:
+        const ControlOutput *m_control = nullptr;
+        Format<20> m_control_text;
+
+        void syncControl() {
+            static const char *const kinds[] = {"CC", "CC14", "NRPN"};
+            Format<20> text;
+            text.add(kinds[static_cast<uint8_t>(m_control->kind())]).add(' ')
+                .add(m_control->number()).add(": ").add(m_control->value());
+            if (strcmp(text.c_str(), m_control_text.c_str())) {
+                m_control_text.clear().add(text.c_str());
+                invalidate();
+            }
+            this->text(m_control_text.c_str()).style(STYLE_NORMAL).inverted(false).indent(0);
+        }
+};
+
+// The regular display: a line for the channel of each knob, A to C.
+static Label title(0, 0, 128, 16, DEBUG ? "DEBUG BOX" : "Altoids MIDI Box");
+static ChannelLine lines[] = {ChannelLine(16, 16), ChannelLine(32, 1), ChannelLine(48, 10)};
+
+// The heading while a knob is turned.
+static Label knobTitle(0, 0, 96, 16);
+static NumberField knobNumber(96, 0, 32, 16);
+
+// Text of the most recent incoming message, for the heading.
+static Format<24> headline;
+static InvertedBar headlineBar(0, 0, 128, 16, headline.c_str());
+
+// Temporary displays, lowest first: the greeting, the tempo while a clock comes in, the knob
+// being turned, the program a knob press turned on or off, and the latest incoming message.
+static Overlay splashOverlay(0, 0, BODY_TOP, 128, BODY_HEIGHT);
+static Overlay tempoOverlay(0, 0, HEAD_TOP, 128, HEAD_HEIGHT);
+static Overlay knobHeadOverlay(1, 0, HEAD_TOP, 128, HEAD_HEIGHT);
+static Overlay knobBodyOverlay(1, 0, BODY_TOP, 128, BODY_HEIGHT);
+static Overlay pressOverlay(2, 0, BODY_TOP, 128, BODY_HEIGHT);
+static Overlay headlineOverlay(3, 0, HEAD_TOP, 128, HEAD_HEIGHT);
+
+static void showHeadline() {
+    headlineOverlay.showFor(500, []{
+        headlineBar.render(display, true);
+    });
 }
 
-void onKnobClick(const Knob& knob, uint8_t channel) {
+MidiClock midiClock;
+
+// The tempo as shown, and whether the clock was playing.
+static Format<8> tempoText;
+static bool tempoRunning = false;
+static void showTempo(void *);
+static Timer tempoTimer(showTempo);
+
+static void showTempo(void *) {
+    scheduler.scheduleIn(tempoTimer, TEMPO_REFRESH_MS);
+    // Once the clock stops, the tempo goes away by itself.
+    if (!midiClock.receiving(micros())) {
+        return;
+    }
+    auto bpm = midiClock.tempo();
+    if (!bpm) {
+        return;
+    }
+    auto tenths = (bpm + 5) / 10;
+    Format<8> text;
+    text.add(tenths / 10).add('.').add(tenths % 10);
+    auto running = midiClock.running();
+    auto lasts = 3 * TEMPO_REFRESH_MS;
+    if (tempoOverlay.visible() && running == tempoRunning && !strcmp(text.c_str(), tempoText.c_str())) {
+        tempoOverlay.extend(lasts);
+        return;
+    }
+    tempoText.clear().add(text.c_str());
+    tempoRunning = running;
+    tempoOverlay.showFor(lasts, []{
+        display.printFixed(0, 0, tempoRunning ? "Play" : "Stop", STYLE_NORMAL);
+        display.printFixed(128 - 8 * tempoText.size(), 0, tempoText.c_str(), STYLE_BOLD);
+    });
+}
+
+void onKnobClick(const Knob &, uint8_t channel) {
     auto &state = ChannelState::currentState[channel - 1];
     auto menu = state.menu;
     if (state.on) {
         state.on = false;
         auto itemName = menu->item(0);
         state.queueProgramChange(0, itemName);
-        showBodyFor(1000, [itemName]{
+        pressOverlay.showFor(1000, [itemName]{
             display.printFixedN(0, 16, itemName, STYLE_BOLD, FONT_SIZE_2X);
         });
     } else {
         state.on = true;
         auto itemName = menu->item(state.program);
         state.queueProgramChange(state.program, itemName);
-        showBodyFor(1000, [itemName]{
+        pressOverlay.showFor(1000, [itemName]{
             display.printFixedN(0, 16, itemName, STYLE_BOLD, FONT_SIZE_2X);
         });
     }
@@ -84,38 +195,33 @@ void onKnobClick(const Knob& knob, uint8_t channel) {
 
 void onKnobChange(const Knob& knob, uint8_t channel, uint32_t pos) {
     auto &state = ChannelState::currentState[channel - 1];
-    auto pgm = pos & 255;
+    uint16_t entry = pos;
     auto menu = state.menu;
-    state.queueProgramChange(pgm, menu->item(pgm));
-    showFor(5000, [knob, pos]() {
-        char buf[8];
-        buf[0] = DIGITS[(pos/100)%10];
-        buf[1] = DIGITS[(pos/10)%10];
-        buf[2] = DIGITS[pos%10];
-        buf[3] = '\0';
-        // Suppress leading zero and right-justify.
-        auto numStr = buf;
-        auto numStart = 127 - 6 * 3;
-        if (buf[0] == '0') {
-            numStr++;
-            numStart += 6;
-            if (buf[1] == '0') {
-                numStr++;
-                numStart += 6;
-            }
+    // Choosing a program switches the channel back on.
+    state.on = true;
+    state.queueProgramChange(entry, menu->item(entry));
+    knobHeadOverlay.showFor(5000, [&knob, pos]() {
+        knobTitle.text(knob.getName()).render(display, true);
+        knobNumber.value(pos).render(display, true);
+    });
+    knobBodyOverlay.showFor(5000, [menu, pos] {
+        // The menu draws only what changed, unless something else was drawn there.
+        static DMenu *shown = nullptr;
+        if (knobBodyOverlay.erased() || menu != shown) {
+            menu->invalidate();
+            shown = menu;
         }
-        display.printFixed(0, 0, knob.getName(), STYLE_NORMAL);
-        display.printFixed(103, 0, numStr, STYLE_NORMAL);
-    }, [menu, pos] {
         menu->select(pos);
-        menu->draw(display);
+        if (menu->draw(display)) {
+            knobBodyOverlay.invalidate();
+        }
     });
 }
 
 void onNoteOn(byte cable, byte channel, byte note, byte velocity) {
   if (velocity > 0) {
         if (DEBUG_MAIN) {
-            debug((std::string("ON ") + std::to_string(channel) + " " + std::to_string(note)));
+            debugLog(LogSource::NOTE_ON, channel, note);
         }
         ChannelState::currentState[channel-1].keys.down(note);
         noteMsg(true, cable, " ON", channel, note, velocity);
@@ -137,123 +243,402 @@ void noteMsg(boolean on, byte cable, const char* msg, byte channel, byte note, b
     digitalWrite(LED_BUILTIN, notes_on > 0 ? LOW : HIGH);
     if (DEBUG_MAIN) {
         if (last_receive + receive_display_delay <= millis()) {
-            std::string txt =  std::to_string(cable) + "!" + std::to_string(channel) + ":" + msg + " " + noteName(note) + "@" + std::to_string(velocity);
-            debug(txt);
-            showHeadFor(500, [txt]{
-                display.invertColors();
-                display.printFixed(0, 0, txt.c_str(), STYLE_NORMAL);
-                display.invertColors();
-            });
+            debugLog(LogSource::NOTE, cable, channel, note, velocity, 0, msg);
+            headline.clear().add(cable).add('!').add(channel).add(':').add(msg).add(' ')
+                .note(note).add('@').add(velocity);
+            showHeadline();
         }
     }
 }
 
 
 void onProgramChange(byte cable,  byte channel, byte b2) {
-    byte pgm = b2 % programMenu.count;
     ChannelState &state = ChannelState::currentState[channel - 1];
-    state.programChanged(pgm);
-    state.program = pgm;
-    state.programName = programMenu.item(pgm);
-    if (state.knob) {
-        state.knob->write(pgm);
+    auto &menu = state.menu ? *state.menu : programMenu;
+    // The entry for the bank last selected, or failing that, by position. A banked list's
+    // positions are not program numbers, so a program it lacks leaves the channel as it was.
+    auto found = menu.find(state.bank_msb, state.bank_lsb, b2);
+    if (found >= 0 || !menu.patch(0).banked) {
+        uint16_t pgm = found >= 0 ? found : b2 % menu.size();
+        state.programChanged(pgm);
+        state.program = pgm;
+        state.programName = menu.item(pgm);
+        state.known = true;
+        ChannelState::saveSoon();
+        if (state.knob) {
+            state.knob->write(pgm);
+        }
     }
     if (DEBUG_MAIN) {
         if (last_receive + receive_display_delay <= millis()) {
-            std::string txt =  std::to_string(cable) + "!" + std::to_string(channel) + ":PGM" + " #" + std::to_string(b2);
-            debug(txt);
-            showHeadFor(500, [txt]{
-                display.invertColors();
-                display.printFixed(0, 0, txt.c_str(), STYLE_NORMAL);
-                display.invertColors();
-            });
+            debugLog(LogSource::PROGRAM, cable, channel, b2);
+            headline.clear().add(cable).add('!').add(channel).add(":PGM #").add(b2);
+            showHeadline();
         }
     } else {
-        updateDisplay();
+        for (auto &line : lines) {
+            if (line.channel == channel) {
+                line.sync();
+            }
+        }
     }
 }
 
 
-void defaultDisplayHead() {
-    display.printFixed(0, 0, DEBUG ? "DEBUG BOX" : "Altoids MIDI Box", STYLE_NORMAL);
+void onControlChange(byte cable, byte channel, byte number, byte value) {
+    // Forwarded to the host, it may change what the knobs' controllers left there.
+    if ((router.destinations(cable, channel) & 1) && (number < 64 || (number >= 96 && number <= 101))) {
+        controlEncoder.forget();
+    }
+    // Bank select, for finding the entry of the program change that follows.
+    auto &state = ChannelState::currentState[channel - 1];
+    if (number == 0) {
+        state.bank_msb = value;
+    } else if (number == 32) {
+        state.bank_lsb = value;
+    }
 }
 
-void defaultDisplayBody() {
-    auto line = [](uint8_t i, uint8_t channel){
-        auto &state = ChannelState::currentState[channel- 1];
-        if (state.on) {
-            display.printFixed(0, i * 16, state.programName, STYLE_BOLD);
-        } else {
-            display.invertColors();
-            display.printFixed(12, i * 16, state.programName, STYLE_NORMAL);
-            display.invertColors();
+
+// Register the handlers for cable number C. Channel messages are forwarded as the router says,
+// as well as handled locally.
+template<uint8_t C>
+static void beginCable(MidiCable &cable) {
+    cable.begin(MIDI_CHANNEL_OMNI);
+    cable.setHandleNoteOn([](byte channel, byte note, byte velocity){
+        router.forward(C, midi::NoteOn, channel, note, velocity);
+        onNoteOn(C, channel, note, velocity);
+    });
+    cable.setHandleNoteOff([](byte channel, byte note, byte velocity){
+        router.forward(C, midi::NoteOff, channel, note, velocity);
+        onNoteOff(C, channel, note, velocity);
+    });
+    cable.setHandleProgramChange([](byte channel, byte b2){
+        router.forward(C, midi::ProgramChange, channel, b2);
+        onProgramChange(C, channel, b2);
+    });
+    cable.setHandleControlChange([](byte channel, byte number, byte value){
+        router.forward(C, midi::ControlChange, channel, number, value);
+        onControlChange(C, channel, number, value);
+    });
+    cable.setHandleAfterTouchPoly([](byte channel, byte note, byte pressure){
+        router.forward(C, midi::AfterTouchPoly, channel, note, pressure);
+    });
+    cable.setHandleAfterTouchChannel([](byte channel, byte pressure){
+        router.forward(C, midi::AfterTouchChannel, channel, pressure);
+    });
+    cable.setHandleSystemExclusive([](byte *data, unsigned size){
+        onSysEx(C, data, size);
+    });
+    cable.setHandlePitchBend([](byte channel, int bend){
+        unsigned value = bend + 8192;
+        router.forward(C, midi::PitchBend, channel, value & 0x7f, (value >> 7) & 0x7f);
+    });
+    cable.setHandleClock([]{
+        midiClock.tick(micros());
+    });
+    cable.setHandleStart([]{
+        midiClock.start();
+    });
+    cable.setHandleContinue([]{
+        midiClock.resume();
+    });
+    cable.setHandleStop([]{
+        midiClock.stop();
+    });
+    cable.setHandleSongPosition([](unsigned beats){
+        midiClock.songPosition(beats);
+    });
+}
+
+static Knob *const knobs[] = {&knobA, &knobB, &knobC};
+// What each knob sends, when it sends a controller rather than choosing programs.
+static ControlOutput knobControls[] = {
+    ControlOutput(controlEncoder), ControlOutput(controlEncoder), ControlOutput(controlEncoder)
+};
+static DMenu *const menus[] = {&programMenu, &kitMenu};
+// Items of menus replaced over SysEx; until then, the menus show the built-in tables.
+static NameTable menuItems[2];
+
+// Have a knob select from menu for channel chan.
+static void configKnob(Knob &knob, DMenu &menu, uint8_t chan) {
+    auto &state = ChannelState::currentState[chan - 1];
+    state.knob = &knob;
+    state.menu = &menu;
+    knob
+        .range(0, menu.size() - 1, true)
+        .precision(Knob::Precision::NORMAL)
+        .acceleration()
+        .onChange([chan](Knob &knob, int, int pos){
+            onKnobChange(knob, chan, pos);
+        })
+        .onPress([chan](Knob &knob, bool){
+            onKnobClick(knob, chan);
+        });
+}
+
+bool bindKnob(uint8_t k, uint8_t channel, uint8_t m) {
+    if (k >= 3 || channel < 1 || channel > 16 || m >= 2) {
+        return false;
+    }
+    auto knob = knobs[k];
+    auto &state = ChannelState::currentState[channel - 1];
+    // A channel has one knob; move the other off it first.
+    if (state.knob && state.knob != knob) {
+        return false;
+    }
+    for (auto &other : ChannelState::currentState) {
+        if (other.knob == knob) {
+            other.knob = nullptr;
         }
-    };
-    line(0, 16);
-    line(1, 1);
-    line(2, 10);
+    }
+    knobControls[k].disable();
+    configKnob(*knob, *menus[m], channel);
+    if (state.program >= menus[m]->size()) {
+        state.program = 0;
+    }
+    state.programName = menus[m]->item(state.program);
+    knob->write(state.program);
+    lines[k].show(channel);
+    return true;
+}
+
+bool setMenuItems(uint8_t m, const NameTable &items) {
+    if (m >= 2 || items.count() == 0) {
+        return false;
+    }
+    auto menu = menus[m];
+    menuItems[m] = items;
+    menu->setItems(menuItems[m].pool());
+    for (auto &state : ChannelState::currentState) {
+        if (state.menu != menu) {
+            continue;
+        }
+        if (state.program >= menu->size()) {
+            state.program = menu->size() - 1;
+        }
+        state.programName = menu->item(state.program);
+        if (state.knob) {
+            state.knob->range(0, menu->size() - 1, true);
+        }
+    }
+    updateDisplay();
+    return true;
 }
 
+bool setKnobControl(uint8_t k, uint8_t channel, uint8_t kind, uint16_t number, uint8_t threshold, uint8_t interval_ms) {
+    if (k >= 3 || kind > static_cast<uint8_t>(ControlKind::NRPN)) {
+        return false;
+    }
+    auto &control = knobControls[k];
+    if (!control.configure(static_cast<ControlKind>(kind), channel, number, threshold, interval_ms)) {
+        return false;
+    }
+    auto knob = knobs[k];
+    for (auto &state : ChannelState::currentState) {
+        if (state.knob == knob) {
+            state.knob = nullptr;
+        }
+    }
+    // Every encoder count is a step. Counts come close together within a detent even when
+    // turning slowly, so only a spin accelerates, enough to cross a 14-bit range in a few turns.
+    uint8_t fastest = control.maxValue() > 127 ? control.maxValue() / 128 : 1;
+    knob->range(0, control.maxValue(), false)
+        .precision(Knob::Precision::QUAD)
+        .acceleration({8, 1, fastest})
+        .onChange([k](Knob &, int, int pos){
+            knobControls[k].change(pos);
+            lines[k].sync();
+        })
+        .onPress([](Knob &, bool){});
+    knob->write(0);
+    lines[k].show(control);
+    return true;
+}
+
+bool setKnobRange(uint8_t k, uint16_t first, uint16_t last, bool wrap, uint8_t precision) {
+    if (k >= 3 || first > last || (precision != 1 && precision != 2 && precision != 4)) {
+        return false;
+    }
+    auto knob = knobs[k];
+    for (auto &state : ChannelState::currentState) {
+        if (state.knob == knob) {
+            if (last >= state.menu->size()) {
+                return false;
+            }
+            knob->precision(static_cast<Knob::Precision>(precision)).range(first, last, wrap);
+            return true;
+        }
+    }
+    return false;
+}
+
+bool setRoute(uint8_t srcCable, uint8_t srcChannel, uint8_t dstCable, uint8_t dstChannel) {
+    if (srcCable < 1 || srcCable > NUM_CABLES || dstCable < 1 || dstCable > NUM_CABLES
+            || srcChannel > 16 || dstChannel > 16) {
+        return false;
+    }
+    for (uint8_t channel = 1; channel <= 16; channel++) {
+        if (!srcChannel || channel == srcChannel) {
+            router.route(srcCable, channel, dstCable, dstChannel ? dstChannel : channel);
+        }
+    }
+    return true;
+}
+
+bool clearRoute(uint8_t srcCable, uint8_t srcChannel, uint8_t dstCable) {
+    if (srcCable < 1 || srcCable > NUM_CABLES || dstCable < 1 || dstCable > NUM_CABLES || srcChannel > 16) {
+        return false;
+    }
+    for (uint8_t channel = 1; channel <= 16; channel++) {
+        if (!srcChannel || channel == srcChannel) {
+            router.unroute(srcCable, channel, dstCable);
+        }
+    }
+    return true;
+}
+
+BootTimes bootTimes;
+
+// Bring-up that can wait, a step at a time from the scheduler, so MIDI and the knobs are
+// serviced from the first loop(): the panel first, then the saved programs once USB is up.
+enum class BootStep: uint8_t {DISPLAY, RESTORE, DONE};
+static BootStep bootStep = BootStep::DISPLAY;
+static void boot(void *);
+static Timer bootTimer(boot);
+// How often to look again for the host to finish enumerating the box, in milliseconds.
+static const uint32_t usb_retry = 10;
+
+// Every timer the firmware has, so scheduling one can never fail for want of room: a program
+// change for each channel and the save that follows, the expiry of each overlay layer, boot,
+// the tempo, the preset store's steps, and each knob's controller output.
+static_assert(SCHEDULER_CAPACITY >= sizeof(ChannelState::currentState) / sizeof(ChannelState) + 1
+        + DISPLAY_OVERLAYS + 1 + 1 + 1 + sizeof(knobControls) / sizeof(ControlOutput),
+    "SCHEDULER_CAPACITY is too small for the firmware's timers");
+
+static void boot(void *) {
+    switch (bootStep) {
+        case BootStep::DISPLAY:
+            display.begin();
+            display.clear();
+            display.setTextCursor(0, 0);
+            display.setOffset(0, 0);
+            display.setFixedFont(ssd1306xled_font8x16);
+            splashOverlay.showFor(10000, []{
+                display.printFixedN (0, 8, DEBUG ? "DEBUG" : "BobKerns", STYLE_BOLD, FONT_SIZE_2X);
+            });
+            bootStep = BootStep::RESTORE;
+            scheduler.scheduleIn(bootTimer, 0);
+            break;
+        case BootStep::RESTORE:
+            // Program changes sent before the host is listening would be lost.
+            if (!USBDevice.configured()) {
+                scheduler.scheduleIn(bootTimer, usb_retry);
+                break;
+            }
+            ChannelState::restore();
+            bootTimes.ready = micros();
+            bootStep = BootStep::DONE;
+            break;
+        case BootStep::DONE:
+            break;
+    }
+}
 
 void setup() {
-    delay(2000);
     if(DEBUG) {
         Serial.begin(9600);
     }
 
     pinMode(LED_BUILTIN, OUTPUT);
 
-    CABLE1.begin(MIDI_CHANNEL_OMNI);
-    CABLE1.setHandleNoteOn([](byte channel, byte note, byte velocity){onNoteOn(1, channel, note, velocity);});
-    CABLE1.setHandleNoteOff([](byte channel, byte note, byte velocity){onNoteOff(1, channel, note, velocity);});
-    CABLE1.setHandleProgramChange([](byte channel, byte b2){onProgramChange(1, channel, b2);});
-    //CABLE2.begin(MIDI_CHANNEL_OMNI);
-    //CABLE3.begin(MIDI_CHANNEL_OMNI);
-    //CABLE2.setHandleNoteOn([](byte channel, byte note, byte velocity){onNoteOn(2, channel, note, velocity);});
-    //CABLE2.setHandleNoteOff([](byte channel, byte note, byte velocity){onNoteOff(2, channel, note, velocity);});
-    //CABLE3.setHandleNoteOn([](byte channel, byte note, byte velocity){onNoteOn(3, channel, note, velocity);});
-    //CABLE3.setHandleNoteOff([](byte channel, byte note, byte velocity){onNoteOff(3, channel, note, velocity);});
-
-    auto config = [](Knob &knob, DMenu &menu, uint8_t chan){
-        ChannelState::currentState[chan - 1].menu = &menu;
-            knob
-            .range(0, menu.size() - 1, true)
-            .precision(Knob::Precision::NORMAL)
-            .onChange([chan](Knob & knob, int old, int pos){
-                onKnobChange(knob, chan, pos);
-            })
-            .onPress([chan](Knob& knob, bool state){
-                onKnobClick(knob, chan);
-            })
-            .start(Knob::PULLUP, Knob::PULLUP, Knob::PULLUP);
-        };
-        programMenu.wrap();
-        kitMenu.wrap();
-        config(knobA, programMenu, 16);
-        config(knobB, programMenu, 1);
-        config(knobC, kitMenu, 10);
-
-        display.begin();
-        display.clear();
-        display.setTextCursor(0, 0);
-        display.setOffset(0, 0);
-        display.setFixedFont(ssd1306xled_font8x16);
-
-        showBodyFor(10000, []{
-            display.printFixedN (0, 8, DEBUG ? "DEBUG" : "BobKerns", STYLE_BOLD, FONT_SIZE_2X);
-    });
-}
+    beginCable<1>(CABLE1);
+    beginCable<2>(CABLE2);
+    beginCable<3>(CABLE3);
 
-void loop() {
-    doDisplay();
+        programMenu.wrap().incremental().smooth(MENU_SCROLL_STEP);
+        kitMenu.wrap().incremental().smooth(MENU_SCROLL_STEP);
+        for (auto knob : knobs) {
+            knob->start(Knob::PULLUP, Knob::PULLUP, Knob::PULLUP);
+        }
+        configKnob(knobA, programMenu, 16);
+        configKnob(knobB, programMenu, 1);
+        configKnob(knobC, kitMenu, 10);
 
-    CABLE1.read();
-    //CABLE2.read();
-    //CABLE3.read();
+        screen.add(title);
+        for (auto &line : lines) {
+            screen.add(line);
+        }
+        knobBodyOverlay.retain();
+        for (auto overlay : {&splashOverlay, &tempoOverlay, &knobHeadOverlay, &knobBodyOverlay, &pressOverlay, &headlineOverlay}) {
+            compositor.add(*overlay);
+        }
+        scheduler.scheduleIn(bootTimer, 0);
+        scheduler.scheduleIn(tempoTimer, TEMPO_REFRESH_MS);
+}
+
+StageStats stageStats[NUM_STAGES];
+const char *const stageNames[NUM_STAGES] = {
+    "loop", "display", "cable1", "cable2", "cable3", "knobA", "knobB", "knobC", "scheduler", "debug"
+};
 
-    knobA.poll();
-    knobB.poll();
-    knobC.poll();
+// Time the rest of the enclosing block as a stage of loop(), if PROFILE_LOOP is set.
+#if PROFILE_LOOP
+#define PROFILE_STAGE(stage) ScopedTimer stage_timer(stageStats[stage])
+#else
+#define PROFILE_STAGE(stage)
+#endif
 
-    ChannelState::sendProgramChanges();
+void loop() {
+#if PROFILE_LOOP
+    ScopedTimer whole(stageStats[STAGE_LOOP]);
+    auto loop_start = whole.started();
+#else
+    uint32_t loop_start = DEBUG ? micros() : 0;
+#endif
+    {
+        PROFILE_STAGE(STAGE_DISPLAY);
+        doDisplay();
+        if (bootTimes.firstFrame == BootTimes::NOT_YET && frameBuffer.totalBytes() && !frameBuffer.pending()) {
+            bootTimes.firstFrame = micros();
+        }
+    }
+    {
+        PROFILE_STAGE(STAGE_CABLE1);
+        if (CABLE1.read()) {
+            bootTimes.midiSeen();
+        }
+    }
+    {
+        PROFILE_STAGE(STAGE_CABLE2);
+        if (CABLE2.read()) {
+            bootTimes.midiSeen();
+        }
+    }
+    {
+        PROFILE_STAGE(STAGE_CABLE3);
+        if (CABLE3.read()) {
+            bootTimes.midiSeen();
+        }
+    }
+    {
+        PROFILE_STAGE(STAGE_KNOB_A);
+        knobA.poll();
+    }
+    {
+        PROFILE_STAGE(STAGE_KNOB_B);
+        knobB.poll();
+    }
+    {
+        PROFILE_STAGE(STAGE_KNOB_C);
+        knobC.poll();
+    }
+    {
+        PROFILE_STAGE(STAGE_SCHEDULER);
+        scheduler.service(millis());
+    }
+    {
+        PROFILE_STAGE(STAGE_DEBUG);
+        debugDrain(loop_start);
+    }
 }
\ No newline at end of file
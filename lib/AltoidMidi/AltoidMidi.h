@@ -7,11 +7,16 @@
 #include <Knob.h>
 #include <ChannelState.h>
 #include <DisplayMgr.h>
+#include <Profiler.h>
+#include <NameTable.h>
+#include <MidiClock.h>
+#include <Controller.h>
 
 
 extern void onNoteOn(byte cable, byte channel, byte note, byte velocity);
 extern void onNoteOff(byte cable, byte channel, byte note, byte velocity);
 extern void onProgramChange(byte cable,  byte channel, byte b2);
+extern void onControlChange(byte cable, byte channel, byte number, byte value);
 extern void onKnobChange(const Knob& knob, uint8_t channel, uint32_t pos);
 extern void onKnobClick(const Knob& knob, uint8_t channel);
 extern void noteMsg(boolean on, byte cable, const char* msg, byte channel, byte note, byte velocity);
@@ -22,6 +27,83 @@ extern Knob knobC;
 
 using DMenu = Menu<Display>;
 
+// Pixels the knob menus scroll per loop() when the selection moves past the rows shown.
+// 0 scrolls a whole row at once, which sends the least to the display.
+#ifndef MENU_SCROLL_STEP
+#define MENU_SCROLL_STEP 0
+#endif
+
 
 extern DMenu programMenu;
-extern DMenu kitMenu;
\ No newline at end of file
+extern DMenu kitMenu;
+
+// The MIDI clock, from whichever cable sends one.
+extern MidiClock midiClock;
+
+// How often the tempo on the display is brought up to date, in milliseconds.
+#ifndef TEMPO_REFRESH_MS
+#define TEMPO_REFRESH_MS 250
+#endif
+
+// Configuration while running, as the SysEx commands request it. Knobs are numbered 0-2
+// for A-C, menus 0 for programs and 1 for kits. Each returns false if an argument is out
+// of range, changing nothing.
+// Bind a knob to a channel (1-16) and the menu it selects from, over its whole range.
+// Fails if another knob is bound to the channel.
+extern bool bindKnob(uint8_t knob, uint8_t channel, uint8_t menu);
+// Replace a menu's items with a copy of items.
+extern bool setMenuItems(uint8_t menu, const NameTable &items);
+// Limit a knob to items first through last of its menu. precision is 1, 2 or 4.
+extern bool setKnobRange(uint8_t knob, uint16_t first, uint16_t last, bool wrap, uint8_t precision);
+// Have a knob send a controller on a channel (1-16) instead of choosing programs: kind is a
+// ControlKind, and number the controller or NRPN parameter. See ControlOutput for threshold
+// and interval_ms. Undone by bindKnob().
+extern bool setKnobControl(uint8_t knob, uint8_t channel, uint8_t kind, uint16_t number, uint8_t threshold, uint8_t interval_ms);
+// Forward channel messages received on a cable (1-3) and channel to another cable and channel,
+// besides wherever else they go. Source channel 0 is every channel; destination channel 0 the
+// channel each arrived on.
+extern bool setRoute(uint8_t srcCable, uint8_t srcChannel, uint8_t dstCable, uint8_t dstChannel);
+// Stop forwarding from a cable and channel (0: every channel) to another cable.
+extern bool clearRoute(uint8_t srcCable, uint8_t srcChannel, uint8_t dstCable);
+
+// Time each stage of loop() into stageStats. Each timer costs loop() two micros() calls, so
+// it is off unless asked for; the debug builds set it. Off, the profile reads out empty.
+#ifndef PROFILE_LOOP
+#define PROFILE_LOOP 0
+#endif
+
+// Stages of loop() timed by the profiler; see SysEx.h for reading them out.
+enum Stage: uint8_t {
+    STAGE_LOOP,
+    STAGE_DISPLAY,
+    STAGE_CABLE1,
+    STAGE_CABLE2,
+    STAGE_CABLE3,
+    STAGE_KNOB_A,
+    STAGE_KNOB_B,
+    STAGE_KNOB_C,
+    STAGE_SCHEDULER,
+    STAGE_DEBUG,
+    NUM_STAGES
+};
+
+extern StageStats stageStats[NUM_STAGES];
+extern const char *const stageNames[NUM_STAGES];
+
+// How long the box took to come up, in micros() since reset: until it handled its first
+// incoming MIDI message, until the first frame was fully on the panel, and until the saved
+// programs were sent. NOT_YET until it happens.
+struct BootTimes {
+    static const uint32_t NOT_YET = 0xffffffff;
+    uint32_t firstMidi = NOT_YET;
+    uint32_t firstFrame = NOT_YET;
+    uint32_t ready = NOT_YET;
+
+    inline void midiSeen() {
+        if (firstMidi == NOT_YET) {
+            firstMidi = micros();
+        }
+    }
+};
+
+extern BootTimes bootTimes;
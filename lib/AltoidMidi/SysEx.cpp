@@ -0,0 +1,236 @@
+/**
+ * @copyright Copyright (c) 2021 Bob Kerns
+ * License: MIT
+ */
+#include "SysEx.h"
+#include "AltoidMidi.h"
+#include <cables.h>
+
+namespace {
+    // A reply being built, with room for the longest one.
+    class Reply {
+        public:
+            explicit Reply(sysex::Command command) {
+                add(midi::SystemExclusive).add(sysex::MANUFACTURER).add(sysex::ID1).add(sysex::ID2).add(command);
+            }
+            Reply &add(byte b) {
+                if (len < sizeof(buf) - 1) {
+                    buf[len++] = b;
+                }
+                return *this;
+            }
+            // A string, terminated by 00.
+            Reply &addString(const char *str) {
+                while (*str) {
+                    add(*str++ & 0x7f);
+                }
+                return add(0);
+            }
+            Reply &add32(uint32_t val) {
+                for (int i = 0; i < 5; i++) {
+                    add(val & 0x7f);
+                    val >>= 7;
+                }
+                return *this;
+            }
+            void send(byte cable) {
+                buf[len++] = midi::SystemExclusiveEnd;
+                CABLES[cable - 1]->sendSysEx(len, buf, true);
+            }
+        private:
+            byte buf[64];
+            unsigned len = 0;
+    };
+
+    void profileDump(byte cable) {
+        for (uint8_t i = 0; i < NUM_STAGES; i++) {
+            auto &s = stageStats[i];
+            Reply(sysex::PROFILE_DUMP)
+                .add(i)
+                .addString(stageNames[i])
+                .add32(s.count())
+                .add32(s.min())
+                .add32(s.max())
+                .add32(s.percentile(50))
+                .add32(s.percentile(99))
+                .send(cable);
+        }
+    }
+
+    void profileReset(byte cable) {
+        for (auto &s : stageStats) {
+            s.reset();
+        }
+        Reply(sysex::PROFILE_RESET).send(cable);
+    }
+
+    void bootTimesDump(byte cable) {
+        Reply(sysex::BOOT_TIMES)
+            .add32(bootTimes.firstMidi)
+            .add32(bootTimes.firstFrame)
+            .add32(bootTimes.ready)
+            .send(cable);
+    }
+
+    // Items for a menu, collected as a MENU_ITEMS message arrives. Shared by the cables;
+    // a second upload started before the first ends takes it over, and the first is refused.
+    NameTable staging;
+    const void *staging_owner = nullptr;
+
+    // The parse of one cable's SysEx, carried from chunk to chunk.
+    class Parser {
+        public:
+            explicit Parser(byte cable): cable(cable) {}
+
+            void chunk(const byte *data, unsigned size) {
+                if (!size) {
+                    return;
+                }
+                unsigned i = 0;
+                auto end = size;
+                // The MIDI library marks a piece that continues a message with a leading F7,
+                // and one that is to be continued with a trailing F0.
+                if (data[0] == midi::SystemExclusive) {
+                    begin();
+                    i = 1;
+                } else if (data[0] == midi::SystemExclusiveEnd && in_message && size > 1) {
+                    i = 1;
+                }
+                if (!in_message) {
+                    return;
+                }
+                auto last = data[size - 1];
+                if (size > i && (last == midi::SystemExclusiveEnd || last == midi::SystemExclusive)) {
+                    end--;
+                }
+                for (; i < end; i++) {
+                    if (data[i] & 0x80) {
+                        in_message = false;
+                        return;
+                    }
+                    add(data[i]);
+                }
+                if (last == midi::SystemExclusiveEnd) {
+                    in_message = false;
+                    finish();
+                }
+            }
+
+        private:
+            static const uint8_t MAX_ARGS = 7;
+            const byte cable;
+            bool in_message = false;
+            bool ours = false;
+            uint8_t pos = 0;        ///< bytes after the F0, up to the first argument
+            byte command = 0;
+            byte args[MAX_ARGS];
+            uint8_t nargs = 0;
+            bool extra = false;     ///< more argument bytes than the command takes
+
+            void begin() {
+                in_message = true;
+                ours = true;
+                pos = 0;
+                nargs = 0;
+                extra = false;
+            }
+
+            void add(byte b) {
+                if (!ours) {
+                    return;
+                }
+                switch (pos) {
+                    case 0: ours = b == sysex::MANUFACTURER; pos++; return;
+                    case 1: ours = b == sysex::ID1; pos++; return;
+                    case 2: ours = b == sysex::ID2; pos++; return;
+                    case 3:
+                        command = b;
+                        pos++;
+                        if (command == sysex::MENU_ITEMS) {
+                            staging.clear();
+                            staging_owner = this;
+                        }
+                        return;
+                }
+                if (command == sysex::MENU_ITEMS && nargs == 1) {
+                    if (staging_owner == this) {
+                        staging.add(b);
+                    }
+                } else if (nargs < MAX_ARGS) {
+                    args[nargs++] = b;
+                } else {
+                    extra = true;
+                }
+            }
+
+            // Act on a whole message.
+            void finish() {
+                if (!ours || pos < 4) {
+                    return;
+                }
+                switch (command) {
+                    case sysex::PROFILE_DUMP:
+                        profileDump(cable);
+                        break;
+                    case sysex::PROFILE_RESET:
+                        profileReset(cable);
+                        break;
+                    case sysex::BOOT_TIMES:
+                        bootTimesDump(cable);
+                        break;
+                    case sysex::KNOB_BIND:
+                        Reply(sysex::KNOB_BIND)
+                            .add(nargs == 3 && !extra && bindKnob(args[0], args[1], args[2]) ? sysex::OK : sysex::BAD_ARGUMENTS)
+                            .send(cable);
+                        break;
+                    case sysex::MENU_ITEMS: {
+                        if (staging_owner != this) {
+                            // Another cable's upload took over the table.
+                            Reply(sysex::MENU_ITEMS).add(sysex::BUSY).add(0).send(cable);
+                            break;
+                        }
+                        staging_owner = nullptr;
+                        auto status = sysex::OK;
+                        if (!staging.finish() || staging.full()) {
+                            status = sysex::TOO_LARGE;
+                        } else if (nargs != 1 || staging.count() == 0 || !setMenuItems(args[0], staging)) {
+                            status = sysex::BAD_ARGUMENTS;
+                        }
+                        Reply(sysex::MENU_ITEMS)
+                            .add(status)
+                            .add(status == sysex::OK ? staging.count() : 0)
+                            .send(cable);
+                        break;
+                    }
+                    case sysex::KNOB_RANGE:
+                        Reply(sysex::KNOB_RANGE)
+                            .add(nargs == 7 && !extra && setKnobRange(args[0], (args[1] << 7) | args[2], (args[3] << 7) | args[4], args[5], args[6]) ? sysex::OK : sysex::BAD_ARGUMENTS)
+                            .send(cable);
+                        break;
+                    case sysex::KNOB_CONTROL:
+                        Reply(sysex::KNOB_CONTROL)
+                            .add(nargs == 7 && !extra && setKnobControl(args[0], args[1], args[2], (args[3] << 7) | args[4], args[5], args[6]) ? sysex::OK : sysex::BAD_ARGUMENTS)
+                            .send(cable);
+                        break;
+                    case sysex::ROUTE:
+                        Reply(sysex::ROUTE)
+                            .add(nargs == 4 && !extra && setRoute(args[0], args[1], args[2], args[3]) ? sysex::OK : sysex::BAD_ARGUMENTS)
+                            .send(cable);
+                        break;
+                    case sysex::UNROUTE:
+                        Reply(sysex::UNROUTE)
+                            .add(nargs == 3 && !extra && clearRoute(args[0], args[1], args[2]) ? sysex::OK : sysex::BAD_ARGUMENTS)
+                            .send(cable);
+                        break;
+                }
+            }
+    };
+
+    Parser parsers[NUM_CABLES] = {Parser(1), Parser(2), Parser(3)};
+}
+
+void onSysEx(byte cable, const byte *data, unsigned size) {
+    if (cable >= 1 && cable <= NUM_CABLES) {
+        parsers[cable - 1].chunk(data, size);
+    }
+}
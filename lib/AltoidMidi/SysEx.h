@@ -0,0 +1,70 @@
+/**
+ * @copyright Copyright (c) 2021 Bob Kerns
+ * License: MIT
+ */
+// SysEx commands understood by the box.
+//
+// Every message is F0 7D 41 4D <command> <data...> F7: 7D is the non-commercial manufacturer ID,
+// and 41 4D ("AM") marks it as ours. Replies go back on the cable the request came in on,
+// with the same header and command. Numbers are sent as five 7-bit bytes, least significant first.
+//
+// Messages are parsed as they arrive, a chunk at a time as the MIDI library delivers them, so
+// a message of any length takes no more buffer than its fixed arguments, and a long upload is
+// interleaved with the rest of the MIDI stream rather than holding it up.
+//
+// The configuration commands change the box until it is reset; they are not saved. Each is
+// acknowledged with a reply whose first data byte is a Status. Knobs are numbered 0-2 for
+// A-C, menus 0 for programs and 1 for kits, and cables and channels from 1.
+#pragma once
+#include <Arduino.h>
+
+namespace sysex {
+    const byte MANUFACTURER = 0x7D;
+    const byte ID1 = 0x41;
+    const byte ID2 = 0x4D;
+    const uint8_t HEADER_SIZE = 5; // F0 7D 41 4D <command>
+
+    enum Command: byte {
+        // Dump the loop profile. One reply per stage:
+        //   <stage> <name...> 00 <count> <min> <max> <p50> <p99>, times in microseconds.
+        PROFILE_DUMP = 0x01,
+        // Clear the loop profile. Reply has no data.
+        PROFILE_RESET = 0x02,
+        // Report how long startup took: <first MIDI> <first frame> <ready>, in microseconds
+        // since reset, each FFFFFFFF if it has not happened yet. See BootTimes.
+        BOOT_TIMES = 0x03,
+        // Bind a knob to a channel and the menu it selects from: <knob> <channel 1-16> <menu>.
+        // The knob's range becomes the whole menu.
+        KNOB_BIND = 0x10,
+        // Replace a menu's items: <menu> <name> 00 <name> 00 ... Reply: <status> <count>.
+        // Names are 7-bit ASCII. The menu is unchanged unless the whole message arrives and fits.
+        MENU_ITEMS = 0x11,
+        // Limit a knob to part of its menu:
+        // <knob> <first MSB> <first LSB> <last MSB> <last LSB> <wrap 0/1> <precision 1/2/4>.
+        KNOB_RANGE = 0x12,
+        // Have a knob send a controller instead of choosing programs, until bound again:
+        // <knob> <channel 1-16> <kind> <number MSB> <number LSB> <threshold> <interval ms>.
+        // Kind 0 is a CC (0-119), 1 a 14-bit CC pair (MSB controller 0-31), 2 an NRPN (0-16383).
+        // A change is sent once it differs by threshold, at most once per interval.
+        KNOB_CONTROL = 0x13,
+        // Forward channel messages from one cable to another, besides wherever else they go:
+        // <source cable 1-3> <source channel> <destination cable 1-3> <destination channel>.
+        // Source channel 0 is every channel, and destination channel 0 the one each came in on.
+        ROUTE = 0x14,
+        // Stop forwarding: <source cable 1-3> <source channel, 0 for all> <destination cable 1-3>.
+        UNROUTE = 0x15,
+    };
+
+    enum Status: byte {
+        OK = 0x00,
+        BAD_ARGUMENTS = 0x01,
+        // Too many items or characters for the menu's table.
+        TOO_LARGE = 0x02,
+        // A MENU_ITEMS upload on another cable started before this one ended, and took over.
+        BUSY = 0x03,
+    };
+}
+
+// Handler for SysEx received on a cable: a whole message, with its F0 and F7, or a piece of
+// one too long for the MIDI library's buffer.
+extern void onSysEx(byte cable, const byte *data, unsigned size);
@@ -4,5 +4,5 @@
  */
 #include "Callback.h"
 
-int Callback::next_idx = 0;
-std::function<void()> Callback::dispatch[Callback::number_of_callbacks];
+// Instantiate the slots for next() here, rather than in every user.
+template struct Callback::Slots<ISR, NUMBER_OF_CALLBACKS, Callback::CallFunction>;
@@ -6,14 +6,17 @@
 #pragma once
 #undef min
 #undef max
+#include <stddef.h>
+#include <array>
 #include <functional>
+#include <utility>
 
 #ifndef NUMBER_OF_CALLBACKS
 #define NUMBER_OF_CALLBACKS 16
 #endif
 
-#if NUMBER_OF_CALLBACKS > 64 || NUMBER_OF_CALLBACKS < 0
-#error "Too many callbacks"
+#if NUMBER_OF_CALLBACKS < 1
+#error "Need at least one callback"
 #endif
 
 typedef std::function<void()> ISR;
@@ -21,95 +24,107 @@ typedef void(*callbackFn)();
 
 class Callback {
     private:
-        static int next_idx;
-        static const size_t number_of_callbacks = NUMBER_OF_CALLBACKS;
-        static std::function<void()> dispatch[number_of_callbacks];
+        // The class a pointer to member function belongs to.
+        template<typename M>
+        struct memberOf;
+        template<typename T>
+        struct memberOf<void (T::*)()> {
+            using type = T;
+        };
+
+        // One trampoline per slot, each a plain function that loads its slot and calls it.
+        // The trampolines are generated at compile time, so there is no limit but N.
+        template<typename Target, size_t N, typename Call>
+        struct Slots {
+            static Target slots[N];
+
+            template<size_t I>
+            static void trampoline() {
+                Call::call(slots[I]);
+            }
+
+            template<size_t... I>
+            static constexpr std::array<callbackFn, N> make(std::index_sequence<I...>) {
+                return {{&trampoline<I>...}};
+            }
+
+            static constexpr std::array<callbackFn, N> fns = make(std::make_index_sequence<N>{});
+
+            static callbackFn claim(const Target &target) {
+                for (size_t i = 0; i < N; i++) {
+                    if (!slots[i]) {
+                        slots[i] = target;
+                        return fns[i];
+                    }
+                }
+                return nullptr;
+            }
+
+            static bool release(callbackFn fn) {
+                for (size_t i = 0; i < N; i++) {
+                    if (fns[i] == fn) {
+                        slots[i] = Target();
+                        return true;
+                    }
+                }
+                return false;
+            }
+        };
+
+        template<auto M>
+        struct CallMember {
+            template<typename T>
+            static void call(T *obj) {
+                if (obj) (obj->*M)();
+            }
+        };
+
+        struct CallFunction {
+            static void call(const ISR &fn) {
+                if (fn) fn();
+            }
+        };
+
+        using FunctionSlots = Slots<ISR, NUMBER_OF_CALLBACKS, CallFunction>;
+
+        template<auto M, size_t N>
+        using MemberSlots = Slots<typename memberOf<decltype(M)>::type *, N, CallMember<M>>;
+
     public:
+    /**
+     * A plain function that calls fn, for any callable. The callable is kept in a std::function,
+     * which may allocate for large captures; prefer bind() for member functions.
+     * Returns NULL if all NUMBER_OF_CALLBACKS slots are in use.
+     */
     static callbackFn next(ISR fn) {
-        if (next_idx >= NUMBER_OF_CALLBACKS) {
-            return NULL;
-        }
-        dispatch[next_idx] = fn;
-        switch (next_idx++) {
-            case 0: return []{ dispatch[0](); };
-            case 1: return []{ dispatch[1](); };
-            case 2: return []{ dispatch[2](); };
-            case 3: return []{ dispatch[3](); };
-            case 4: return []{ dispatch[4](); };
-            case 5: return []{ dispatch[5](); };
-            case 6: return []{ dispatch[6](); };
-            case 7: return []{ dispatch[7](); };
-#if NUMBER_OF_CALLBACKS > 8
-            case 8: return []{ dispatch[8](); };
-            case 9: return []{ dispatch[9](); };
-            case 10: return []{ dispatch[10](); };
-            case 11: return []{ dispatch[11](); };
-            case 12: return []{ dispatch[12](); };
-            case 13: return []{ dispatch[13](); };
-            case 14: return []{ dispatch[14](); };
-            case 15: return []{ dispatch[15](); };
-#endif
-#if NUMBER_OF_CALLBACKS > 16
-            case 16: return []{ dispatch[16](); };
-            case 17: return []{ dispatch[17](); };
-            case 18: return []{ dispatch[18](); };
-            case 19: return []{ dispatch[19](); };
-            case 20: return []{ dispatch[20](); };
-            case 21: return []{ dispatch[21](); };
-            case 22: return []{ dispatch[22](); };
-            case 23: return []{ dispatch[23](); };
-#endif
-#if NUMBER_OF_CALLBACKS > 24
-            case 24: return []{ dispatch[24](); };
-            case 25: return []{ dispatch[25](); };
-            case 26: return []{ dispatch[26](); };
-            case 27: return []{ dispatch[27](); };
-            case 28: return []{ dispatch[28](); };
-            case 29: return []{ dispatch[29](); };
-            case 30: return []{ dispatch[30](); };
-            case 31: return []{ dispatch[31](); };
-#endif
-#if NUMBER_OF_CALLBACKS > 32
-            case 32: return []{ dispatch[32](); };
-            case 33: return []{ dispatch[33](); };
-            case 34: return []{ dispatch[34](); };
-            case 35: return []{ dispatch[35](); };
-            case 36: return []{ dispatch[36](); };
-            case 37: return []{ dispatch[37](); };
-            case 38: return []{ dispatch[38](); };
-            case 39: return []{ dispatch[39](); };
-#endif
-#if NUMBER_OF_CALLBACKS > 40
-            case 40: return []{ dispatch[40](); };
-            case 41: return []{ dispatch[41](); };
-            case 42: return []{ dispatch[42](); };
-            case 43: return []{ dispatch[43](); };
-            case 44: return []{ dispatch[44](); };
-            case 45: return []{ dispatch[45](); };
-            case 46: return []{ dispatch[46](); };
-            case 47: return []{ dispatch[47](); };
-#endif
-#if NUMBER_OF_CALLBACKS > 48
-            case 48: return []{ dispatch[48](); };
-            case 49: return []{ dispatch[49](); };
-            case 50: return []{ dispatch[50](); };
-            case 51: return []{ dispatch[51](); };
-            case 52: return []{ dispatch[52](); };
-            case 53: return []{ dispatch[53](); };
-            case 54: return []{ dispatch[54](); };
-            case 55: return []{ dispatch[55](); };
-#endif
-#if NUMBER_OF_CALLBACKS > 56
-            case 56: return []{ dispatch[56](); };
-            case 57: return []{ dispatch[57](); };
-            case 58: return []{ dispatch[58](); };
-            case 59: return []{ dispatch[59](); };
-            case 60: return []{ dispatch[60](); };
-            case 51: return []{ dispatch[61](); };
-            case 62: return []{ dispatch[62](); };
-            case 63: return []{ dispatch[63](); };
-#endif
-        }
-        return NULL;
+        return FunctionSlots::claim(fn);
+    }
+
+    /**
+     * Free the slot behind a function returned by next(). Detach the interrupt first.
+     */
+    static bool release(callbackFn fn) {
+        return FunctionSlots::release(fn);
+    }
+
+    /**
+     * A plain function that calls obj.*M(), e.g. bind<&Knob::updateCount>(knob). Each member
+     * function has its own N slots holding just an object pointer, so nothing is allocated and
+     * dispatch is one load and a direct call. Returns NULL if all N slots are in use.
+     */
+    template<auto M, size_t N = NUMBER_OF_CALLBACKS>
+    static callbackFn bind(typename memberOf<decltype(M)>::type &obj) {
+        return MemberSlots<M, N>::claim(&obj);
+    }
+
+    /**
+     * Free the slot behind a function returned by bind<M, N>(). Detach the interrupt first.
+     */
+    template<auto M, size_t N = NUMBER_OF_CALLBACKS>
+    static bool unbind(callbackFn fn) {
+        return MemberSlots<M, N>::release(fn);
     }
 };
+
+template<typename Target, size_t N, typename Call>
+Target Callback::Slots<Target, N, Call>::slots[N] = {};
@@ -4,15 +4,13 @@
  */
 #include "ChannelState.h"
 #include "cables.h"
+#include <string.h>
 
-void ChannelState::sendProgramChanges() {
-    auto now = millis();;
-    for (int i = 0; i < 16; i++) {
-        auto &cs = currentState[i];
-        if (cs.send_program_at && cs.send_program_at <= now) {
-            cs.sendProgramChange();
-        }
-    }
+Timer ChannelState::save_timer(save);
+Preset ChannelState::saved;
+
+void ChannelState::sendProgramChange(void *state) {
+    static_cast<ChannelState *>(state)->sendProgramChange();
 }
 
 void ChannelState::allNotesOff() {
@@ -22,30 +20,91 @@ void ChannelState::allNotesOff() {
     });
 }
 
+void ChannelState::sendPatch(uint16_t entry) {
+    auto patch = menu ? menu->patch(entry) : Patch{false, 0, 0, static_cast<uint8_t>(entry & 0x7f)};
+    if (patch.banked) {
+        CABLE1.sendControlChange(0, patch.msb, channel + 1);
+        CABLE1.sendControlChange(32, patch.lsb, channel + 1);
+    }
+    CABLE1.sendProgramChange(patch.program, channel + 1);
+}
+
 void ChannelState::sendProgramChange() {
     allNotesOff();
-    CABLE1.sendProgramChange(send_program, channel + 1);
-    program = send_program;
-    programName = send_program_name;
-    send_program_at = 0;
+    sendPatch(send_program);
+    // Switched off, the channel keeps its program for when it is switched back on.
+    if (on) {
+        program = send_program;
+        programName = send_program_name;
+    }
+    known = true;
+    saveSoon();
 }
 
-void ChannelState::queueProgramChange(uint8_t program, const char * programName) {
-    send_program_at = millis() + send_delay;
+void ChannelState::queueProgramChange(uint16_t program, const char * programName) {
+    scheduler.scheduleIn(program_timer, send_delay);
     send_program = program;
     send_program_name = programName;
-    on = true;
 }
 
-void ChannelState::programChanged(uint8_t pgm) {
-    if (!send_program_at) {
+void ChannelState::programChanged(uint16_t pgm) {
+    if (!program_timer.pending()) {
         if (program != pgm) {
             if (!keys.allUp()) {
-                CABLE1.sendProgramChange(program, channel + 1);
+                sendPatch(program);
                 allNotesOff();
                 program = pgm;
-                CABLE1.sendProgramChange(program, channel + 1);
+                sendPatch(program);
+            }
+        }
+    }
+}
+void ChannelState::saveSoon() {
+    scheduler.scheduleIn(save_timer, save_delay);
+}
+
+void ChannelState::save(void *) {
+    Preset preset;
+    memset(&preset, 0, sizeof(preset));
+    for (auto &state : currentState) {
+        preset.program[state.channel] = state.program;
+        preset.known |= state.known << state.channel;
+        preset.off |= !state.on << state.channel;
+    }
+    // Unchanged settings cost no flash wear.
+    if (memcmp(&preset, &saved, sizeof(preset)) != 0) {
+        saved = preset;
+        presets.save(preset);
+    }
+}
+
+bool ChannelState::restore() {
+    if (!presets.restore(saved)) {
+        return false;
+    }
+    for (auto &state : currentState) {
+        if (!(saved.known & (1 << state.channel))) {
+            continue;
+        }
+        state.known = true;
+        state.on = !(saved.off & (1 << state.channel));
+        state.program = saved.program[state.channel];
+        if (state.menu) {
+            // The list may have changed since.
+            if (state.program >= state.menu->size()) {
+                state.program = 0;
             }
+            state.programName = state.menu->item(state.program);
+        }
+        if (state.knob) {
+            state.knob->write(state.program);
         }
     }
-}
\ No newline at end of file
+    // Back to back, ahead of anything else, so the instruments are all set up together.
+    for (auto &state : currentState) {
+        if (state.known) {
+            state.sendPatch(state.on ? state.program : 0);
+        }
+    }
+    return true;
+}
@@ -8,27 +8,50 @@
 #include <Knob.h>
 #include <Menu.h>
 #include <DisplayMgr.h>
+#include <Scheduler.h>
+#include <Presets.h>
 using DMenu = Menu<Display>;
 
 class ChannelState {
     public:
         const uint8_t channel;
-        uint8_t program = 0;
+        uint16_t program = 0; ///< entry in the menu; for a list without banks, the program number
+        uint8_t bank_msb = 0; ///< bank last selected by incoming MIDI
+        uint8_t bank_lsb = 0;
         const char * programName = "(Not set)";
         bool on = true;
+        bool known = false; ///< program was set here or by incoming MIDI, so it is worth keeping
         Knob *knob;
         KeyTracker keys;
         DMenu *menu = nullptr;
         static ChannelState currentState[16];
-        ChannelState(uint8_t channel, Knob *knob = nullptr) : channel(channel), knob(knob), keys(channel) {}
-        static void sendProgramChanges();
-        void queueProgramChange(uint8_t program, const char * programName);
-        void programChanged(uint8_t program);
+        ChannelState(uint8_t channel, Knob *knob = nullptr) :
+            channel(channel), knob(knob), keys(channel), program_timer(sendProgramChange, this) {}
+        void queueProgramChange(uint16_t program, const char * programName);
+        void programChanged(uint16_t program);
+        /**
+         * Save every channel's program to flash once they have stopped changing for save_delay.
+         */
+        static void saveSoon();
+        /**
+         * Take up the programs saved in flash, and send them all at once.
+         * @returns false if nothing was saved.
+         */
+        static bool restore();
     private:
         const unsigned int send_delay = 500;
-        unsigned long send_program_at = 0;
-        uint8_t send_program = 0;
+        // Long enough that turning a knob through the menu is one save, not one per step.
+        static const unsigned int save_delay = 2000;
+        static Timer save_timer;
+        static Preset saved;
+        static void save(void *);
+        // Sends the queued program change once the knob has been still for send_delay.
+        Timer program_timer;
+        uint16_t send_program = 0;
         const char * send_program_name = nullptr;
+        static void sendProgramChange(void *state);
         void sendProgramChange();
+        // Select an entry of the menu: bank select first if it has banks, then the program.
+        void sendPatch(uint16_t entry);
         void allNotesOff();
 };
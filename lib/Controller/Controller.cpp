@@ -0,0 +1,113 @@
+/**
+ * @copyright Copyright (c) 2021 Bob Kerns
+ * License: MIT
+ */
+#include "Controller.h"
+#include <Arduino.h>
+
+ControlEncoder controlEncoder(CABLE1);
+
+uint8_t ControlEncoder::send(ControlKind kind, uint8_t channel, uint16_t number, uint16_t value, uint16_t previous) {
+    uint8_t sent = 0;
+    auto cc = [&](uint8_t n, uint8_t v) {
+        m_cable.sendControlChange(n, v, channel);
+        sent++;
+    };
+    uint8_t msb = value >> 7;
+    uint8_t lsb = value & 0x7f;
+    // The receiver keeps the MSB, so a change within it needs only the LSB.
+    auto same_msb = previous != NONE && (previous >> 7) == msb;
+    switch (kind) {
+        case ControlKind::CC:
+            cc(number, lsb);
+            break;
+        case ControlKind::CC14:
+            // An MSB resets the LSB, so the LSB always follows it.
+            if (!same_msb) {
+                cc(number, msb);
+            }
+            cc(number + 32, lsb);
+            break;
+        case ControlKind::NRPN: {
+            auto &selected = m_selected[channel - 1];
+            if (selected != number) {
+                cc(99, number >> 7);
+                cc(98, number & 0x7f);
+                selected = number;
+            }
+            if (!same_msb) {
+                cc(6, msb);
+            }
+            cc(38, lsb);
+            break;
+        }
+    }
+    m_messages += sent;
+    return sent;
+}
+
+void ControlEncoder::forget() {
+    for (auto &selected : m_selected) {
+        selected = NONE;
+    }
+    m_epoch++;
+}
+
+bool ControlOutput::configure(ControlKind kind, uint8_t channel, uint16_t number, uint16_t threshold, uint16_t interval_ms) {
+    auto limit = kind == ControlKind::CC ? 119 : kind == ControlKind::CC14 ? 31 : 16383;
+    if (channel < 1 || channel > 16 || number > limit) {
+        return false;
+    }
+    scheduler.cancel(m_timer);
+    m_kind = kind;
+    m_channel = channel;
+    m_number = number;
+    m_threshold = threshold ? threshold : 1;
+    m_interval = interval_ms;
+    m_value = 0;
+    m_sent = ControlEncoder::NONE;
+    m_enabled = true;
+    return true;
+}
+
+void ControlOutput::disable() {
+    scheduler.cancel(m_timer);
+    m_enabled = false;
+}
+
+void ControlOutput::change(uint16_t value) {
+    m_value = value;
+    if (!m_enabled) {
+        return;
+    }
+    auto previous = sent();
+    if (value == previous) {
+        scheduler.cancel(m_timer);
+        return;
+    }
+    auto far = previous == ControlEncoder::NONE || abs((int32_t)value - previous) >= m_threshold;
+    auto since = millis() - m_sent_ms;
+    if (far && since >= m_interval) {
+        scheduler.cancel(m_timer);
+        send();
+    } else if (far) {
+        scheduler.scheduleIn(m_timer, m_interval - since);
+    } else {
+        // Each small change puts the send off again, until the knob rests.
+        scheduler.scheduleIn(m_timer, CONTROL_SETTLE_MS);
+    }
+}
+
+void ControlOutput::send() {
+    m_encoder.send(m_kind, m_channel, m_number, m_value, sent());
+    m_sent = m_value;
+    m_epoch = m_encoder.epoch();
+    m_sent_ms = millis();
+}
+
+void ControlOutput::flush(void *output) {
+    auto out = static_cast<ControlOutput *>(output);
+    if (out->m_enabled && out->m_value != out->sent()) {
+        out->send();
+    }
+}
@@ -0,0 +1,137 @@
+/**
+ * @copyright Copyright (c) 2021 Bob Kerns
+ * License: MIT
+ */
+// Knobs as continuous controllers: 7-bit CC, 14-bit CC pairs, and NRPN.
+#pragma once
+#include <stdint.h>
+#include <Scheduler.h>
+#include <cables.h>
+
+// The shortest time between sends from one knob, in milliseconds. A fast sweep sends at most
+// this often; the latest value goes out when the time is up.
+#ifndef CONTROL_INTERVAL_MS
+#define CONTROL_INTERVAL_MS 10
+#endif
+
+// How long a knob must rest before a change smaller than its threshold is sent, in milliseconds,
+// so it always ends up at the value it shows.
+#ifndef CONTROL_SETTLE_MS
+#define CONTROL_SETTLE_MS 100
+#endif
+
+// Numbered as in the KNOB_CONTROL SysEx command.
+enum class ControlKind: uint8_t {
+    CC = 0,     ///< one controller, 0-127
+    CC14 = 1,   ///< controller number (0-31) for the MSB and number + 32 for the LSB, 0-16383
+    NRPN = 2,   ///< parameter number 0-16383, set by CC 99/98, value by data entry CC 6/38, 0-16383
+};
+
+/**
+ * Sends controller values on a cable, leaving out what the receiver already has: the NRPN
+ * parameter number when it is the one last selected on the channel, and the MSB of a 14-bit
+ * value when only the LSB changed. The messages for a value are all control changes on one
+ * channel, so on a serial link they would share one running status byte.
+ *
+ * This knows only what it sent. Anything else sent on the cable that may change the
+ * receiver's parameter selection or MSBs must be followed by forget().
+ */
+class ControlEncoder {
+    public:
+        static const uint16_t NONE = 0xffff;
+
+        ControlEncoder(MidiCable &cable): m_cable(cable) { forget(); }
+
+        /**
+         * Send value for a controller on channel (1-16). previous is the value last sent for
+         * it, or NONE; it must have been sent since forget() was last called.
+         * @returns the number of messages sent.
+         */
+        uint8_t send(ControlKind kind, uint8_t channel, uint16_t number, uint16_t value, uint16_t previous);
+
+        /**
+         * Assume nothing about the receiver: the next value of each controller is sent in full.
+         */
+        void forget();
+
+        /**
+         * Changes with each forget(), so a value remembered from an earlier one can be recognized.
+         */
+        uint8_t epoch() const { return m_epoch; }
+
+        /**
+         * Messages sent in all.
+         */
+        uint32_t messages() const { return m_messages; }
+
+    private:
+        MidiCable &m_cable;
+        uint16_t m_selected[16]; ///< NRPN parameter last selected on each channel, or NONE
+        uint8_t m_epoch = 0;
+        uint32_t m_messages = 0;
+};
+
+/**
+ * What one knob sends as a controller, thinned so a fast sweep does not flood the cable: a
+ * change is sent at once if it is at least the threshold away from what was last sent, and
+ * at least the interval has passed since then. Otherwise it waits: until the interval is up
+ * if it is large enough, or until the knob has rested for CONTROL_SETTLE_MS if not.
+ */
+class ControlOutput {
+    public:
+        ControlOutput(ControlEncoder &encoder): m_encoder(encoder), m_timer(flush, this) {}
+
+        /**
+         * Start sending as a controller on channel (1-16). The threshold is at least 1.
+         * @returns false, changing nothing, if number is out of range for kind.
+         */
+        bool configure(ControlKind kind, uint8_t channel, uint16_t number,
+                       uint16_t threshold = 1, uint16_t interval_ms = CONTROL_INTERVAL_MS);
+
+        /**
+         * Stop sending. A change waiting to be sent is dropped.
+         */
+        void disable();
+
+        bool enabled() const { return m_enabled; }
+        ControlKind kind() const { return m_kind; }
+        uint8_t channel() const { return m_channel; }
+        uint16_t number() const { return m_number; }
+
+        /**
+         * The largest value: 127, or 16383 for 14-bit controllers.
+         */
+        uint16_t maxValue() const { return m_kind == ControlKind::CC ? 127 : 16383; }
+
+        /**
+         * The latest value, whether or not it has gone out yet.
+         */
+        uint16_t value() const { return m_value; }
+
+        /**
+         * The knob turned to value.
+         */
+        void change(uint16_t value);
+
+    private:
+        ControlEncoder &m_encoder;
+        Timer m_timer;
+        ControlKind m_kind = ControlKind::CC;
+        bool m_enabled = false;
+        uint8_t m_channel = 1;
+        uint8_t m_epoch = 0; ///< the encoder's epoch when m_sent was sent
+        uint16_t m_number = 0;
+        uint16_t m_threshold = 1;
+        uint16_t m_interval = CONTROL_INTERVAL_MS;
+        uint16_t m_value = 0;
+        uint16_t m_sent = ControlEncoder::NONE;
+        uint32_t m_sent_ms = 0;
+
+        // What the receiver has, as far as the encoder knows.
+        uint16_t sent() const { return m_epoch == m_encoder.epoch() ? m_sent : ControlEncoder::NONE; }
+        void send();
+        static void flush(void *output);
+};
+
+// Controllers go to the host, on the first cable, like the knobs' program changes.
+extern ControlEncoder controlEncoder;
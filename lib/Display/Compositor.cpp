@@ -0,0 +1,87 @@
+/**
+ * @copyright Copyright (c) 2021 Bob Kerns
+ * License: MIT
+ */
+#include "Compositor.h"
+
+void Overlay::showFor(uint32_t ms, DisplayFn draw) {
+    m_draw = draw;
+    if (m_visible) {
+        invalidate();
+    } else {
+        m_visible = true;
+        erase();
+    }
+    scheduler.scheduleIn(m_expiry, ms);
+}
+
+void Overlay::extend(uint32_t ms) {
+    if (m_visible) {
+        scheduler.scheduleIn(m_expiry, ms);
+    }
+}
+
+void Overlay::hide() {
+    scheduler.cancel(m_expiry);
+    if (m_visible) {
+        m_visible = false;
+        m_vacated = true;
+    }
+}
+
+void Overlay::expire(void *overlay) {
+    static_cast<Overlay *>(overlay)->hide();
+}
+
+void Overlay::draw(Window &) {
+    if (m_draw) {
+        m_draw();
+    }
+}
+
+bool Compositor::add(Overlay &overlay) {
+    if (m_count >= DISPLAY_OVERLAYS) {
+        return false;
+    }
+    auto i = m_count++;
+    for (; i > 0 && m_layers[i - 1]->z > overlay.z; i--) {
+        m_layers[i] = m_layers[i - 1];
+    }
+    m_layers[i] = &overlay;
+    return true;
+}
+
+void Compositor::hideAll() {
+    for (uint8_t i = 0; i < m_count; i++) {
+        m_layers[i]->hide();
+    }
+}
+
+bool Compositor::render(Window &w) {
+    Damage damage;
+    for (uint8_t i = 0; i < m_count; i++) {
+        auto layer = m_layers[i];
+        if (layer->m_vacated) {
+            layer->m_vacated = false;
+            damage.add(layer->bounds());
+        }
+    }
+    damage.clear(w);
+    auto drew = m_base.render(w, damage) || !damage.empty();
+    // Painter's order: each layer redrawn adds its region, so the layers above it follow.
+    for (uint8_t i = 0; i < m_count; i++) {
+        auto layer = m_layers[i];
+        if (!layer->m_visible) {
+            continue;
+        }
+        if (damage.intersects(layer->bounds())) {
+            layer->erase();
+        }
+        if (layer->dirty()) {
+            layer->render(w, true);
+            damage.add(layer->bounds());
+            drew = true;
+        }
+    }
+    return drew;
+}
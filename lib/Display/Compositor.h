@@ -0,0 +1,96 @@
+/**
+ * @copyright Copyright (c) 2021 Bob Kerns
+ * License: MIT
+ */
+// Temporary displays, layered over the regular one.
+#pragma once
+#include <functional>
+#include <Scheduler.h>
+#include "Widget.h"
+
+#ifndef DISPLAY_OVERLAYS
+#define DISPLAY_OVERLAYS 8
+#endif
+
+using DisplayFn = std::function<void()>;
+
+/**
+ * A region of the screen that shows something for a while, over the regular display and
+ * any overlay with a lower z. Each overlay has its own deadline, so one notification does not
+ * displace another in a different layer; showing again in the same layer replaces what it showed.
+ *
+ * The drawing function draws relative to the overlay's region, which has been cleared first
+ * unless the overlay retains its pixels.
+ */
+class Overlay: public Widget {
+    public:
+        const uint8_t z;
+
+        Overlay(uint8_t z, lcdint_t x, lcdint_t y, lcduint_t w, lcduint_t h):
+            Widget(x, y, w, h), z(z), m_expiry(expire, this) {}
+
+        /**
+         * Show what draw draws until ms milliseconds have passed.
+         */
+        void showFor(uint32_t ms, DisplayFn draw);
+
+        /**
+         * Keep showing what is shown until ms milliseconds from now, without redrawing it.
+         */
+        void extend(uint32_t ms);
+
+        /**
+         * Stop showing, uncovering whatever is beneath.
+         */
+        void hide();
+
+        /**
+         * Keep the region's pixels between redraws, for drawing that updates what it drew
+         * last time. The drawing function must then draw everything when erased() is true.
+         */
+        Overlay &retain(bool retain = true) { m_retain = retain; return *this; }
+
+        bool visible() const { return m_visible; }
+
+    protected:
+        DisplayFn m_draw;
+        Timer m_expiry;
+        bool m_visible = false;
+        bool m_vacated = false; ///< hidden since last composited, so what was beneath needs redrawing
+        friend class Compositor;
+
+        static void expire(void *overlay);
+        void draw(Window &w);
+};
+
+/**
+ * Draws the regular display and the overlays above it, in z order, redrawing only where
+ * something changed: a widget or overlay that was invalidated, an overlay that was hidden,
+ * and anything drawn over those.
+ */
+class Compositor {
+    public:
+        Compositor(WidgetGroup &base): m_base(base) {}
+
+        /**
+         * Add an overlay layer. Layers with equal z stack in the order added.
+         * @returns false if there are already DISPLAY_OVERLAYS layers.
+         */
+        bool add(Overlay &overlay);
+
+        /**
+         * Hide every overlay.
+         */
+        void hideAll();
+
+        /**
+         * Bring the window up to date.
+         * @returns true if anything was drawn.
+         */
+        bool render(Window &w);
+
+    protected:
+        WidgetGroup &m_base;
+        Overlay *m_layers[DISPLAY_OVERLAYS] = {}; ///< lowest z first
+        uint8_t m_count = 0;
+};
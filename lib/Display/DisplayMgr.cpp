@@ -4,67 +4,31 @@
  */
 #include "DisplayMgr.h"
 RawDisplay rawDisplay(-1);
+FrameDisplay frameBuffer(rawDisplay);
 
+Display display(frameBuffer);
+WidgetGroup screen(0, 0, FrameDisplay::WIDTH, FrameDisplay::HEIGHT);
+Compositor compositor(screen);
 
-DisplayFn tmpDisplay;
-uint32_t tmpDisplay_end = 0;
-DisplayFn displayHead = defaultDisplayHead;
-DisplayFn displayBody = defaultDisplayBody;
+static uint32_t display_budget_us = DISPLAY_BUDGET_US;
 
-WindowImpl<RawDisplay> display(rawDisplay);
-
-void show(DisplayFn head, DisplayFn body) {
-    display.clear();
-    display.setTextCursor(0, 0);
-    display.setOffset(0, 0);
-    display.setFixedFont(ssd1306xled_font8x16);
-
-    head();
-    display.setOffset(0, 16);
-    body();
-}
-
-// Rate limit the temporary displays
-static uint32_t last_tmp = 0;
-static const uint32_t tmp_rate = 200;
-
-void showFor(uint32_t ms, DisplayFn head, DisplayFn body) {
-    auto now = millis();
-    if (last_tmp + tmp_rate < now) {
-        tmpDisplay_end = ms + now;
-        tmpDisplay = [now, head, body]{
-            last_tmp = now;
-            show(head, body);
-            tmpDisplay = NULL;
-        };
-    }
-}
-
-void showHeadFor(uint32_t ms, DisplayFn head) {
-    showFor(ms, head, displayBody);
-}
-
-void showBodyFor(uint32_t ms, DisplayFn body) {
-    showFor(ms, displayHead, body);
+void setDisplayBudget(uint32_t us) {
+    display_budget_us = us;
 }
 
 void doDisplay() {
-    if (tmpDisplay_end >  millis()) {
-        if (tmpDisplay) {
-            tmpDisplay();
-            tmpDisplay = NULL;
-        }
-    } else if (tmpDisplay_end > 0) {
-        tmpDisplay_end = 0;
-        tmpDisplay = NULL;
-        show();
+    // Until the panel is brought up, drawing waits, so it starts from what begin() leaves.
+    if (!frameBuffer.begun()) {
+        return;
     }
+    compositor.render(display);
+    frameBuffer.flushFor(display_budget_us);
 }
 
 // Update the display with the latest data
 void updateDisplay(bool override) {
-    // If we're not currently showing a temp display
-    if (override || !tmpDisplay_end) {
-        tmpDisplay_end = 1;
+    if (override) {
+        compositor.hideAll();
     }
+    screen.invalidate();
 }
@@ -9,38 +9,51 @@
 #undef max
 #include <functional>
 #include "Window.h"
+#include "FrameBuffer.h"
+#include "Widget.h"
+#include "Compositor.h"
 
 using RawDisplay = DisplaySSD1306_128x64_I2C;
 extern RawDisplay rawDisplay;
-using Display = WindowImpl<RawDisplay>;
+// Drawing goes to RAM; show() sends only what changed to the panel.
+using FrameDisplay = FrameBuffer<RawDisplay>;
+extern FrameDisplay frameBuffer;
+using Display = WindowImpl<FrameDisplay>;
 extern Display display;
 
-using DisplayFn = std::function<void()>;
-
 const auto SCREEN_WIDTH = 128; // OLED display width, in pixels
 const auto SCREEN_HEIGHT = 32; // OLED display height, in pixels
 
-// Called from loop()
-extern void doDisplay();
-
-extern void defaultDisplayHead();
-extern void defaultDisplayBody();
+// How long each doDisplay() may spend sending to the panel, in microseconds. At least one
+// changed page (128 bytes) is sent per call, so 0 means one page per loop().
+#ifndef DISPLAY_BUDGET_US
+#define DISPLAY_BUDGET_US 0
+#endif
 
-extern DisplayFn displayHead;
-extern DisplayFn displayBody;
+// Called from loop(). Draws any new display, then sends part of what changed to the panel.
+// Does nothing until display.begin().
+extern void doDisplay();
 
-// Make these be the current display until changed.
-extern void show(DisplayFn head = displayHead, DisplayFn body = displayBody);
+// Change the time doDisplay() may spend sending to the panel.
+extern void setDisplayBudget(uint32_t us);
 
-// Make these be the current display until ms milliseconds have passed.
-extern void showFor(uint32_t ms, DisplayFn head = displayHead, DisplayFn body = displayBody);
+// The widgets of the regular display, beneath any overlays. doDisplay() redraws just the
+// ones that have been invalidated or uncovered.
+extern WidgetGroup screen;
 
-// Make these be the current display heading until ms milliseconds have passed.
-extern void showHeadFor(uint32_t ms, DisplayFn head);
+// The heading and body regions of the screen, for overlays.
+const lcdint_t HEAD_TOP = 0;
+const lcduint_t HEAD_HEIGHT = 16;
+const lcdint_t BODY_TOP = HEAD_TOP + HEAD_HEIGHT;
+const lcduint_t BODY_HEIGHT = FrameDisplay::HEIGHT - HEAD_HEIGHT;
 
-// Make these be the current display body until ms milliseconds have passed.
-extern void showBodyFor(uint32_t ms, DisplayFn body);
+// Draws the screen and any overlays shown over it; add each Overlay here once, at setup.
+// Drawing is in RAM; doDisplay() then sends only the parts of the screen that differ from
+// what is already shown, a piece at a time. See frameBuffer.frameBytes() for the cost of
+// the last update.
+extern Compositor compositor;
 
-// Update the main display with the latest data
-// Set override = true to immediately flush any temporary display.
+// Redraw all of the main display with the latest data. When only some widgets of the
+// screen changed, invalidating just those is cheaper.
+// Set override = true to also hide every overlay.
 extern void updateDisplay(bool override = false);
@@ -0,0 +1,452 @@
+/**
+ * @copyright Copyright (c) 2021 Bob Kerns
+ * License: MIT
+ */
+#include "FrameBuffer.h"
+
+template<class P>
+void FrameBuffer<P>::begin() {
+    _panel.begin();
+    m_begun = true;
+    m_shadow_invalid = 0xff;
+}
+
+template<class P>
+uint32_t FrameBuffer<P>::flushPage(lcduint_t page) {
+    bool valid = !(m_shadow_invalid & (1 << page));
+    uint16_t touched = valid ? m_touched[page] : 0xffff;
+    m_touched[page] = 0;
+    m_shadow_invalid &= ~(1 << page);
+    if (!touched) {
+        return 0;
+    }
+    uint32_t sent = 0;
+    // Coalesce runs of changed tiles into a single transfer.
+    int run = -1;
+    for (lcduint_t t = 0; t <= TILES; t++) {
+        bool changed = false;
+        if (t < TILES && (touched & (1 << t))) {
+            auto off = page * WIDTH + t * 8;
+            changed = !valid || memcmp(m_buf + off, m_shadow + off, 8);
+        }
+        if (changed) {
+            if (run < 0) {
+                run = t;
+            }
+        } else if (run >= 0) {
+            lcduint_t x = run * 8;
+            lcduint_t w = (t - run) * 8;
+            auto off = page * WIDTH + x;
+            _panel.drawBuffer1(x, page * 8, w, 8, m_buf + off);
+            memcpy(m_shadow + off, m_buf + off, w);
+            sent += w;
+            run = -1;
+        }
+    }
+    m_pending_bytes += sent;
+    m_total_bytes += sent;
+    return sent;
+}
+
+template<class P>
+void FrameBuffer<P>::flushed() {
+    m_frame_bytes = m_pending_bytes;
+    m_pending_bytes = 0;
+}
+
+template<class P>
+uint32_t FrameBuffer<P>::flush() {
+    uint32_t sent = 0;
+    for (lcduint_t page = 0; page < PAGES; page++) {
+        sent += flushPage(page);
+    }
+    flushed();
+    return sent;
+}
+
+template<class P>
+bool FrameBuffer<P>::pending() const {
+    if (m_shadow_invalid) {
+        return true;
+    }
+    for (auto t : m_touched) {
+        if (t) {
+            return true;
+        }
+    }
+    return false;
+}
+
+template<class P>
+bool FrameBuffer<P>::flushFor(uint32_t budget_us) {
+    if (!pending()) {
+        return true;
+    }
+    auto start = micros();
+    do {
+        auto page = m_next_page;
+        m_next_page = (m_next_page + 1) % PAGES;
+        if (m_touched[page] || (m_shadow_invalid & (1 << page))) {
+            flushPage(page);
+            if (!pending()) {
+                flushed();
+                return true;
+            }
+            if (micros() - start >= budget_us) {
+                return false;
+            }
+        }
+    } while (true);
+}
+
+template<class P>
+void FrameBuffer<P>::touch(lcdint_t x1, lcdint_t page1, lcdint_t x2, lcdint_t page2) {
+    uint32_t bits = ((2u << (x2 >> 3)) - 1) & ~((1u << (x1 >> 3)) - 1);
+    for (lcdint_t page = page1; page <= page2; page++) {
+        m_touched[page] |= bits;
+    }
+}
+
+template<class P>
+template<typename F>
+void FrameBuffer<P>::area(lcdint_t x, lcdint_t y, lcduint_t w, lcduint_t h, bool opaque, F pixel) {
+    lcdint_t x1 = max(x, 0);
+    lcdint_t y1 = max(y, 0);
+    lcdint_t x2 = min(x + (lcdint_t)w, (lcdint_t)WIDTH) - 1;
+    lcdint_t y2 = min(y + (lcdint_t)h, (lcdint_t)HEIGHT) - 1;
+    if (x1 > x2 || y1 > y2) {
+        return;
+    }
+    bool fg = m_color != 0;
+    bool bg = m_bgColor != 0;
+    for (lcdint_t py = y1; py <= y2; py++) {
+        for (lcdint_t px = x1; px <= x2; px++) {
+            if (pixel(px - x, py - y)) {
+                plot(px, py, fg);
+            } else if (opaque) {
+                plot(px, py, bg);
+            }
+        }
+    }
+    touch(x1, y1 >> 3, x2, y2 >> 3);
+}
+
+/**
+ * Draws pixel on specified position
+ * @param x - position X
+ * @param y - position Y
+ * @note color can be set via setColor()
+ */
+template<class P>
+void FrameBuffer<P>::putPixel(lcdint_t x, lcdint_t y) {
+    fillRect(x, y, x, y);
+}
+
+/**
+ * Draws horizontal or vertical line
+ * @param x1 - position X
+ * @param y1 - position Y
+ * @param y2 - position Y
+ * @note color can be set via setColor()
+ */
+template<class P>
+void FrameBuffer<P>::drawVLine(lcdint_t x1, lcdint_t y1, lcdint_t y2) {
+    fillRect(x1, y1, x1, y2);
+}
+
+/**
+ * Draws horizontal or vertical line
+ * @param x1 - position X
+ * @param y1 - position Y
+ * @param x2 - position X
+ * @note color can be set via setColor()
+ */
+template<class P>
+void FrameBuffer<P>::drawHLine(lcdint_t x1, lcdint_t y1, lcdint_t x2) {
+    fillRect(x1, y1, x2, y1);
+}
+
+/**
+ * Fills rectangle area, a page byte at a time.
+ * @param x1 - position X
+ * @param y1 - position Y
+ * @param x2 - position X
+ * @param y2 - position Y
+ * @note color can be set via setColor()
+ */
+template<class P>
+void FrameBuffer<P>::fillRect(lcdint_t x1, lcdint_t y1, lcdint_t x2, lcdint_t y2) {
+    if (x1 > x2) std::swap(x1, x2);
+    if (y1 > y2) std::swap(y1, y2);
+    x1 = max(x1, 0);
+    y1 = max(y1, 0);
+    x2 = min(x2, (lcdint_t)WIDTH - 1);
+    y2 = min(y2, (lcdint_t)HEIGHT - 1);
+    if (x1 > x2 || y1 > y2) {
+        return;
+    }
+    for (lcdint_t page = y1 >> 3; page <= y2 >> 3; page++) {
+        lcdint_t top = max(y1 - page * 8, 0);
+        lcdint_t bottom = min(y2 - page * 8, 7);
+        uint8_t mask = (0xff >> (7 - bottom)) & (0xff << top);
+        auto row = m_buf + page * WIDTH;
+        for (lcdint_t x = x1; x <= x2; x++) {
+            row[x] = m_color ? (row[x] | mask) : (row[x] & ~mask);
+        }
+    }
+    touch(x1, y1 >> 3, x2, y2 >> 3);
+}
+
+/**
+ * Moves the pixels in a rectangle up or down, a column at a time. Pixels moved out of the
+ * rectangle are dropped, and those left uncovered get the background color.
+ * @param x1 - position X
+ * @param y1 - position Y
+ * @param x2 - position X
+ * @param y2 - position Y
+ * @param dy - pixels to move down; negative moves up
+ */
+template<class P>
+void FrameBuffer<P>::scroll(lcdint_t x1, lcdint_t y1, lcdint_t x2, lcdint_t y2, lcdint_t dy) {
+    static_assert(HEIGHT <= 64, "a column must fit in 64 bits");
+    if (x1 > x2) std::swap(x1, x2);
+    if (y1 > y2) std::swap(y1, y2);
+    x1 = max(x1, 0);
+    y1 = max(y1, 0);
+    x2 = min(x2, (lcdint_t)WIDTH - 1);
+    y2 = min(y2, (lcdint_t)HEIGHT - 1);
+    if (x1 > x2 || y1 > y2 || dy == 0) {
+        return;
+    }
+    uint64_t mask = (~0ull >> (63 - y2)) & (~0ull << y1);
+    uint64_t kept = dy > 0 ? (dy < 64 ? mask << dy : 0) : (-dy < 64 ? mask >> -dy : 0);
+    uint64_t vacated = m_bgColor ? mask & ~kept : 0;
+    lcdint_t page1 = y1 >> 3;
+    lcdint_t page2 = y2 >> 3;
+    for (lcdint_t x = x1; x <= x2; x++) {
+        uint64_t col = 0;
+        for (lcdint_t page = page1; page <= page2; page++) {
+            col |= (uint64_t)m_buf[page * WIDTH + x] << (page * 8);
+        }
+        uint64_t moved = dy > 0 ? (col & mask) << dy : (col & mask) >> -dy;
+        col = (col & ~mask) | (moved & kept) | vacated;
+        for (lcdint_t page = page1; page <= page2; page++) {
+            m_buf[page * WIDTH + x] = col >> (page * 8);
+        }
+    }
+    touch(x1, page1, x2, page2);
+}
+
+/**
+ * Draws bitmap, located in Flash, in XBMP format
+ */
+template<class P>
+void FrameBuffer<P>::drawXBitmap(lcdint_t x, lcdint_t y, lcduint_t w, lcduint_t h, const uint8_t *bitmap) {
+    lcduint_t stride = (w + 7) / 8;
+    area(x, y, w, h, true, [bitmap, stride](lcduint_t col, lcduint_t row){
+        return (bitmap[row * stride + col / 8] >> (col & 7)) & 1;
+    });
+}
+
+/**
+ * Draws monochrome bitmap in page layout using the current colors.
+ * Whole, aligned pages are copied a byte at a time.
+ */
+template<class P>
+void FrameBuffer<P>::drawBitmap1(lcdint_t x, lcdint_t y, lcduint_t w, lcduint_t h, const uint8_t *bitmap) {
+    if ((y & 7) == 0 && (h & 7) == 0 && y >= 0 && y + (lcdint_t)h <= (lcdint_t)HEIGHT) {
+        lcdint_t x1 = max(x, 0);
+        lcdint_t x2 = min(x + (lcdint_t)w, (lcdint_t)WIDTH) - 1;
+        if (x1 > x2) {
+            return;
+        }
+        uint8_t fg = m_color ? 0xff : 0;
+        uint8_t bg = m_bgColor ? 0xff : 0;
+        for (lcduint_t p = 0; p < h / 8; p++) {
+            auto src = bitmap + p * w;
+            auto row = m_buf + ((y >> 3) + p) * WIDTH;
+            for (lcdint_t cx = x1; cx <= x2; cx++) {
+                auto bits = src[cx - x];
+                row[cx] = (bits & fg) | (~bits & bg);
+            }
+        }
+        touch(x1, y >> 3, x2, ((y + h) >> 3) - 1);
+        return;
+    }
+    area(x, y, w, h, true, [bitmap, w](lcduint_t col, lcduint_t row){
+        return (bitmap[(row >> 3) * w + col] >> (row & 7)) & 1;
+    });
+}
+
+template<class P>
+void FrameBuffer<P>::gfx_drawMonoBitmap(lcdint_t x, lcdint_t y, lcduint_t w, lcduint_t h, const uint8_t *buf) {
+    drawBitmap1(x, y, w, h, buf);
+}
+
+/**
+ * Draws 4-bit bitmap; on a monochrome panel any non-zero pixel is foreground.
+ */
+template<class P>
+void FrameBuffer<P>::drawBitmap4(lcdint_t x, lcdint_t y, lcduint_t w, lcduint_t h, const uint8_t *bitmap) {
+    area(x, y, w, h, true, [bitmap, w](lcduint_t col, lcduint_t row){
+        auto i = row * w + col;
+        return ((bitmap[i / 2] >> ((i & 1) * 4)) & 0x0f) != 0;
+    });
+}
+
+/**
+ * Draws 8-bit bitmap; on a monochrome panel any non-zero pixel is foreground.
+ */
+template<class P>
+void FrameBuffer<P>::drawBitmap8(lcdint_t x, lcdint_t y, lcduint_t w, lcduint_t h, const uint8_t *bitmap) {
+    area(x, y, w, h, true, [bitmap, w](lcduint_t col, lcduint_t row){
+        return bitmap[row * w + col] != 0;
+    });
+}
+
+/**
+ * Draws 16-bit bitmap; on a monochrome panel any non-zero pixel is foreground.
+ */
+template<class P>
+void FrameBuffer<P>::drawBitmap16(lcdint_t x, lcdint_t y, lcduint_t w, lcduint_t h, const uint8_t *bitmap) {
+    area(x, y, w, h, true, [bitmap, w](lcduint_t col, lcduint_t row){
+        auto i = 2 * (row * w + col);
+        return (bitmap[i] | bitmap[i + 1]) != 0;
+    });
+}
+
+template<class P>
+void FrameBuffer<P>::drawBuffer1(lcdint_t x, lcdint_t y, lcduint_t w, lcduint_t h, const uint8_t *buffer) {
+    drawBitmap1(x, y, w, h, buffer);
+}
+
+template<class P>
+void FrameBuffer<P>::drawBuffer4(lcdint_t x, lcdint_t y, lcduint_t w, lcduint_t h, const uint8_t *buffer) {
+    drawBitmap4(x, y, w, h, buffer);
+}
+
+template<class P>
+void FrameBuffer<P>::drawBuffer8(lcdint_t x, lcdint_t y, lcduint_t w, lcduint_t h, const uint8_t *buffer) {
+    drawBitmap8(x, y, w, h, buffer);
+}
+
+template<class P>
+void FrameBuffer<P>::drawBuffer16(lcdint_t x, lcdint_t y, lcduint_t w, lcduint_t h, const uint8_t *buffer) {
+    drawBitmap16(x, y, w, h, buffer);
+}
+
+/**
+ * Clears canvas
+ */
+template<class P>
+void FrameBuffer<P>::clear() {
+    fill(0);
+}
+
+/**
+ * Fill screen content with specified color
+ *
+ * @param color color to fill display with
+ */
+template<class P>
+void FrameBuffer<P>::fill(uint16_t color) {
+    memset(m_buf, color & 0xff, sizeof(m_buf));
+    touch(0, 0, WIDTH - 1, PAGES - 1);
+}
+
+template<class P>
+lcdint_t FrameBuffer<P>::glyph(lcdint_t x, lcdint_t y, uint8_t c, EFontStyle style, uint8_t factor) {
+    SCharInfo info;
+    m_font->getCharBitmap(c, &info);
+    auto data = info.glyph;
+    lcduint_t w = info.width;
+    lcduint_t s = 1 << factor;
+    auto pixel = [data, w, s](lcduint_t col, lcduint_t row) {
+        col /= s;
+        row /= s;
+        return data && ((data[(row >> 3) * w + col] >> (row & 7)) & 1);
+    };
+    if (factor == 0 && data) {
+        drawBitmap1(x, y, w, info.height, data);
+    } else {
+        area(x, y, w * s, info.height * s, true, pixel);
+    }
+    // Bold is a second, transparent pass one pixel to the right, as lcdgfx does it.
+    if (style == STYLE_BOLD) {
+        area(x + s, y, w * s, info.height * s, false, pixel);
+    }
+    return (w + info.spacing) * s;
+}
+
+/**
+ * Draws single character at the text cursor
+ * @param c - character code to print
+ * @returns 0 if char is not printed
+ */
+template<class P>
+uint8_t FrameBuffer<P>::printChar(uint8_t c) {
+    if (!m_font) {
+        return 0;
+    }
+    SCharInfo info;
+    m_font->getCharBitmap(c, &info);
+    if (c == '\n' || m_cursorX + info.width > WIDTH) {
+        m_cursorX = 0;
+        m_cursorY += info.height;
+        if (c == '\n') {
+            return 1;
+        }
+    }
+    m_cursorX += glyph(m_cursorX, m_cursorY, c, STYLE_NORMAL, 0);
+    return 1;
+}
+
+/**
+ * Writes single character at the text cursor
+ * @param c - character code to print
+ */
+template<class P>
+size_t FrameBuffer<P>::write(uint8_t c) {
+    return printChar(c);
+}
+
+/**
+ * Print text at specified position, wrapping at the right edge.
+ *
+ * @param xpos  position in pixels
+ * @param y     position in pixels
+ * @param ch    pointer to NULL-terminated string.
+ * @param style specific font style to use
+ */
+template<class P>
+void FrameBuffer<P>::printFixed(lcdint_t xpos, lcdint_t y, const char *ch, EFontStyle style) {
+    printFixedN(xpos, y, ch, style, 0);
+}
+
+/**
+ * Prints text using size fixed font, scaled by 2^factor, wrapping at the right edge.
+ * @param xpos - horizontal position in pixels
+ * @param y - vertical position in pixels
+ * @param ch - NULL-terminated string to print
+ * @param style - font style (EFontStyle), normal by default.
+ * @param factor - 0, 1, 2, 3.
+ */
+template<class P>
+void FrameBuffer<P>::printFixedN(lcdint_t xpos, lcdint_t y, const char *ch, EFontStyle style, uint8_t factor) {
+    if (!m_font) {
+        return;
+    }
+    lcdint_t x = xpos;
+    for (; *ch && y < (lcdint_t)HEIGHT; ch++) {
+        SCharInfo info;
+        m_font->getCharBitmap(static_cast<uint8_t>(*ch), &info);
+        if (*ch == '\n' || x + (lcdint_t)(info.width << factor) > (lcdint_t)WIDTH) {
+            x = xpos;
+            y += info.height << factor;
+            if (*ch == '\n') {
+                continue;
+            }
+        }
+        x += glyph(x, y, static_cast<uint8_t>(*ch), style, factor);
+    }
+}
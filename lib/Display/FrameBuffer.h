@@ -0,0 +1,142 @@
+/**
+ * @copyright Copyright (c) 2021 Bob Kerns
+ * License: MIT
+ */
+#pragma once
+#include "lcdgfx.h"
+#undef min
+#undef max
+#include <string.h>
+#include <utility>
+
+/**
+ * A RAM image of a 128x64 monochrome panel, in the SSD1306's page layout.
+ *
+ * Drawing goes to RAM. flush() then compares each 8x8 tile touched since the last flush
+ * against a shadow of what the panel already shows, and transmits only the tiles that
+ * actually changed, coalescing adjacent tiles in a page into one transfer.
+ *
+ * This presents the drawing interface WindowImpl expects, so it can stand in for the panel.
+ *
+ * flush() sends everything at once. flushFor() instead sends a page at a time until a time
+ * budget is spent, so the rest of the program can run between pieces of a large update.
+ */
+template<class P>
+class FrameBuffer {
+    public:
+        static const lcduint_t WIDTH = 128;
+        static const lcduint_t HEIGHT = 64;
+        static const lcduint_t PAGES = HEIGHT / 8;
+        static const lcduint_t TILES = WIDTH / 8; ///< tiles per page
+
+        FrameBuffer(P &panel): _panel(panel) {}
+
+        /**
+         * Initializes the panel. Its contents are unknown afterwards, so the next flush sends everything.
+         */
+        void begin();
+        void end() { _panel.end(); m_begun = false; }
+
+        /**
+         * Whether the panel has been initialized, and so can be sent to.
+         */
+        bool begun() const { return m_begun; }
+
+        /**
+         * Transmits the tiles that differ from what the panel shows.
+         * @returns the number of display data bytes sent.
+         */
+        uint32_t flush();
+
+        /**
+         * Transmits changed pages, starting where the last call left off, until budget_us
+         * microseconds have passed. At least one changed page is sent per call.
+         * @returns true if the panel is now up to date.
+         */
+        bool flushFor(uint32_t budget_us);
+
+        /**
+         * Whether anything has been drawn that the panel does not yet show.
+         */
+        bool pending() const;
+
+        /**
+         * Display data bytes sent to bring the panel up to date the last time it was brought
+         * up to date, whether by one flush() or several flushFor().
+         */
+        uint32_t frameBytes() const { return m_frame_bytes; }
+
+        /**
+         * Display data bytes sent by all flushes.
+         */
+        uint32_t totalBytes() const { return m_total_bytes; }
+
+        /**
+         * Returns the page-layout image: PAGES rows of WIDTH bytes, LSB at the top of each page.
+         */
+        const uint8_t *getBuffer() const { return m_buf; }
+
+        lcduint_t width() const { return WIDTH; }
+        lcduint_t height() const { return HEIGHT; }
+
+        void setFont(NanoFont &font) { m_font = &font; }
+        void setColor(uint16_t color) { m_color = color; }
+        void setBackground(uint16_t color) { m_bgColor = color; }
+
+        void putPixel(lcdint_t x, lcdint_t y);
+        void drawVLine(lcdint_t x1, lcdint_t y1, lcdint_t y2);
+        void drawHLine(lcdint_t x1, lcdint_t y1, lcdint_t x2);
+        void fillRect(lcdint_t x1, lcdint_t y1, lcdint_t x2, lcdint_t y2);
+        void scroll(lcdint_t x1, lcdint_t y1, lcdint_t x2, lcdint_t y2, lcdint_t dy);
+        void drawXBitmap(lcdint_t x, lcdint_t y, lcduint_t w, lcduint_t h, const uint8_t *bitmap);
+        void drawBitmap1(lcdint_t x, lcdint_t y, lcduint_t w, lcduint_t h, const uint8_t *bitmap);
+        void gfx_drawMonoBitmap(lcdint_t x, lcdint_t y, lcduint_t w, lcduint_t h, const uint8_t *buf);
+        void drawBitmap4(lcdint_t x, lcdint_t y, lcduint_t w, lcduint_t h, const uint8_t *bitmap);
+        void drawBitmap8(lcdint_t x, lcdint_t y, lcduint_t w, lcduint_t h, const uint8_t *bitmap);
+        void drawBitmap16(lcdint_t x, lcdint_t y, lcduint_t w, lcduint_t h, const uint8_t *bitmap);
+        void drawBuffer1(lcdint_t x, lcdint_t y, lcduint_t w, lcduint_t h, const uint8_t *buffer);
+        void drawBuffer4(lcdint_t x, lcdint_t y, lcduint_t w, lcduint_t h, const uint8_t *buffer);
+        void drawBuffer8(lcdint_t x, lcdint_t y, lcduint_t w, lcduint_t h, const uint8_t *buffer);
+        void drawBuffer16(lcdint_t x, lcdint_t y, lcduint_t w, lcduint_t h, const uint8_t *buffer);
+        void clear();
+        void fill(uint16_t color);
+        uint8_t printChar(uint8_t c);
+        size_t write(uint8_t c);
+        void printFixed(lcdint_t xpos, lcdint_t y, const char *ch, EFontStyle style = STYLE_NORMAL);
+        void printFixedN(lcdint_t xpos, lcdint_t y, const char *ch, EFontStyle style, uint8_t factor);
+
+    protected:
+        P &_panel;
+        uint8_t m_buf[PAGES * WIDTH] = {};
+        uint8_t m_shadow[PAGES * WIDTH] = {};
+        uint16_t m_touched[PAGES] = {}; ///< tiles drawn into since the last flush, one bit per tile
+        bool m_begun = false;
+        uint8_t m_shadow_invalid = 0xff; ///< pages whose panel contents are unknown, one bit per page
+        lcduint_t m_next_page = 0; ///< where flushFor() resumes
+        uint32_t m_pending_bytes = 0; ///< sent since the panel was last up to date
+        uint32_t m_frame_bytes = 0;
+        uint32_t m_total_bytes = 0;
+        NanoFont *m_font = nullptr;
+        uint16_t m_color = 0xFFFF;
+        uint16_t m_bgColor = 0x0000;
+        lcdint_t m_cursorX = 0;
+        lcdint_t m_cursorY = 0;
+
+        void touch(lcdint_t x1, lcdint_t page1, lcdint_t x2, lcdint_t page2);
+        // Transmit the changed tiles of one page. Returns the bytes sent.
+        uint32_t flushPage(lcduint_t page);
+        // Note that the panel is up to date.
+        void flushed();
+        // Set or clear one pixel, unclipped.
+        inline void plot(lcdint_t x, lcdint_t y, bool on) {
+            auto &b = m_buf[(y >> 3) * WIDTH + x];
+            auto mask = static_cast<uint8_t>(1 << (y & 7));
+            b = on ? (b | mask) : (b & ~mask);
+        }
+        // Draw a w x h area; pixel(col, row) says whether a pixel is foreground.
+        // Foreground pixels always get the color; background pixels get the background color if opaque.
+        template<typename F>
+        void area(lcdint_t x, lcdint_t y, lcduint_t w, lcduint_t h, bool opaque, F pixel);
+        // Draw one character at (x, y), scaled by 2^factor. Returns the advance.
+        lcdint_t glyph(lcdint_t x, lcdint_t y, uint8_t c, EFontStyle style, uint8_t factor);
+};
@@ -0,0 +1,145 @@
+/**
+ * @copyright Copyright (c) 2021 Bob Kerns
+ * License: MIT
+ */
+#include "Widget.h"
+#include <Format.h>
+
+static NanoRect join(const NanoRect &a, const NanoRect &b) {
+    return {
+        (NanoPoint){min(a.p1.x, b.p1.x), min(a.p1.y, b.p1.y)},
+        (NanoPoint){max(a.p2.x, b.p2.x), max(a.p2.y, b.p2.y)}
+    };
+}
+
+void Damage::add(const NanoRect &rect) {
+    for (uint8_t i = 0; i < m_count; i++) {
+        if (overlaps(m_rects[i], rect)) {
+            m_rects[i] = join(m_rects[i], rect);
+            return;
+        }
+    }
+    if (m_count < MAX_RECTS) {
+        m_rects[m_count++] = rect;
+    } else {
+        m_rects[MAX_RECTS - 1] = join(m_rects[MAX_RECTS - 1], rect);
+    }
+}
+
+bool Damage::intersects(const NanoRect &rect) const {
+    for (uint8_t i = 0; i < m_count; i++) {
+        if (overlaps(m_rects[i], rect)) {
+            return true;
+        }
+    }
+    return false;
+}
+
+void Damage::clear(Window &w) const {
+    w.setOffset(0, 0);
+    w.invertColors();
+    for (uint8_t i = 0; i < m_count; i++) {
+        w.fillRect(m_rects[i].p1.x, m_rects[i].p1.y, m_rects[i].p2.x, m_rects[i].p2.y);
+    }
+    w.invertColors();
+}
+
+bool Widget::render(Window &w, bool force) {
+    if (!force && !m_dirty) {
+        return false;
+    }
+    m_dirty = false;
+    auto width = w.width();
+    auto height = w.height();
+    w.setOffset(m_x, m_y);
+    w.setSize(m_w, m_h);
+    if (m_erased || !m_retain) {
+        w.invertColors();
+        w.fillRect(0, 0, m_w - 1, m_h - 1);
+        w.invertColors();
+    }
+    draw(w);
+    w.setSize(width, height);
+    m_erased = false;
+    return true;
+}
+
+WidgetGroup &WidgetGroup::add(Widget &widget) {
+    auto last = &m_first;
+    while (*last) {
+        last = &(*last)->m_next;
+    }
+    *last = &widget;
+    widget.m_next = nullptr;
+    m_dirty = true;
+    return *this;
+}
+
+bool WidgetGroup::dirty() const {
+    if (m_dirty) {
+        return true;
+    }
+    for (auto widget = m_first; widget; widget = widget->m_next) {
+        if (widget->dirty()) {
+            return true;
+        }
+    }
+    return false;
+}
+
+bool WidgetGroup::render(Window &w, bool force) {
+    // Redrawing the whole group clears its box first, to erase anything outside the members.
+    auto all = force || m_dirty;
+    auto drew = all && Widget::render(w, true);
+    for (auto widget = m_first; widget; widget = widget->m_next) {
+        if (all) {
+            widget->erase();
+        }
+        drew |= widget->render(w, all);
+    }
+    return drew;
+}
+
+bool WidgetGroup::render(Window &w, Damage &damage) {
+    if (m_dirty) {
+        damage.add(bounds());
+        return render(w, true);
+    }
+    auto drew = false;
+    for (auto widget = m_first; widget; widget = widget->m_next) {
+        if (damage.intersects(widget->bounds())) {
+            widget->erase();
+        }
+        if (widget->dirty()) {
+            widget->render(w, true);
+            damage.add(widget->bounds());
+            drew = true;
+        }
+    }
+    return drew;
+}
+
+void Label::draw(Window &w) {
+    if (m_inverted) {
+        w.invertColors();
+        w.printFixed(m_indent, 0, m_text, m_style);
+        w.invertColors();
+    } else {
+        w.printFixed(m_indent, 0, m_text, m_style);
+    }
+}
+
+void NumberField::draw(Window &w) {
+    Format<12> text;
+    text.add(m_value);
+    SCharInfo info;
+    w.getFont().getCharBitmap('0', &info);
+    w.printFixed(m_w - text.size() * info.width, 0, text.c_str(), STYLE_NORMAL);
+}
+
+void InvertedBar::draw(Window &w) {
+    w.fillRect(0, 0, m_w - 1, m_h - 1);
+    w.invertColors();
+    w.printFixed(m_indent, 0, m_text, m_style);
+    w.invertColors();
+}
@@ -0,0 +1,204 @@
+/**
+ * @copyright Copyright (c) 2021 Bob Kerns
+ * License: MIT
+ */
+// Retained-mode display elements, which remember what they show and redraw only when told
+// it has changed.
+#pragma once
+#include "Window.h"
+
+/**
+ * Whether two rectangles share any pixel.
+ */
+inline bool overlaps(const NanoRect &a, const NanoRect &b) {
+    return a.p1.x <= b.p2.x && b.p1.x <= a.p2.x && a.p1.y <= b.p2.y && b.p1.y <= a.p2.y;
+}
+
+/**
+ * The parts of the screen that must be redrawn in one pass: a few rectangles, in screen pixels.
+ * Overlapping rectangles are merged, as is the last one when there is no more room, so this
+ * can cover more than was added, but never less.
+ */
+class Damage {
+    public:
+        static const uint8_t MAX_RECTS = 4;
+
+        void add(const NanoRect &rect);
+        bool intersects(const NanoRect &rect) const;
+        bool empty() const { return m_count == 0; }
+
+        /**
+         * Fill the damaged area with the background color.
+         */
+        void clear(Window &w) const;
+
+    private:
+        NanoRect m_rects[MAX_RECTS];
+        uint8_t m_count = 0;
+};
+
+/**
+ * Something drawn in a fixed box on the screen.
+ *
+ * A widget keeps what it shows, and a dirty flag. Changing what it shows invalidates it;
+ * render() then clears its box and redraws it, and leaves every other widget alone.
+ */
+class Widget {
+    public:
+        /**
+         * @param x - left edge, in screen pixels
+         * @param y - top edge, in screen pixels
+         * @param w - width in pixels
+         * @param h - height in pixels
+         */
+        Widget(lcdint_t x, lcdint_t y, lcduint_t w, lcduint_t h): m_x(x), m_y(y), m_w(w), m_h(h) {}
+
+        /**
+         * The box this widget owns, in screen pixels.
+         */
+        const NanoRect bounds() const
+        {
+            return { (NanoPoint){m_x, m_y}, (NanoPoint){(lcdint_t)(m_x + m_w - 1), (lcdint_t)(m_y + m_h - 1)} };
+        }
+
+        /**
+         * Mark this widget as needing to be redrawn.
+         */
+        virtual void invalidate() { m_dirty = true; }
+
+        /**
+         * Mark the box as drawn over or cleared, so all of it must be redrawn.
+         */
+        void erase() { m_erased = true; m_dirty = true; }
+
+        /**
+         * Whether the box no longer shows what was last drawn there. Only meaningful to a
+         * widget that retains its pixels, while it draws.
+         */
+        bool erased() const { return m_erased; }
+
+        /**
+         * Whether this widget, or anything in it, needs to be redrawn.
+         */
+        virtual bool dirty() const { return m_dirty; }
+
+        /**
+         * Clear the box and redraw, if invalidated or force is set. A widget that retains its
+         * pixels is cleared only when erased. Drawing may invalidate the widget again, to be
+         * drawn again next time, e.g. to animate.
+         * Drawing is clipped to the box. This leaves the window's offset at the widget's box,
+         * and its size as it was.
+         * @returns true if anything was drawn.
+         */
+        virtual bool render(Window &w, bool force = false);
+
+    protected:
+        lcdint_t m_x;
+        lcdint_t m_y;
+        lcduint_t m_w;
+        lcduint_t m_h;
+        bool m_dirty = true;
+        bool m_erased = true;
+        bool m_retain = false; ///< draws over what it drew before, rather than a cleared box
+        Widget *m_next = nullptr; ///< next sibling in a WidgetGroup
+        friend class WidgetGroup;
+
+        // Draw the contents, relative to the box, which has been cleared to the background
+        // unless the widget retains its pixels and was not erased.
+        virtual void draw(Window &w) = 0;
+
+        // Invalidate if a setting changes.
+        template<typename T>
+        void change(T &field, T value) {
+            if (field != value) {
+                field = value;
+                m_dirty = true;
+            }
+        }
+};
+
+/**
+ * Widgets drawn together, such as a whole screen. Invalidating the group redraws all of it;
+ * otherwise rendering the group redraws just the members that were invalidated.
+ *
+ * Members are chained through the widgets themselves, so a widget can be in only one group.
+ */
+class WidgetGroup: public Widget {
+    public:
+        WidgetGroup(lcdint_t x, lcdint_t y, lcduint_t w, lcduint_t h): Widget(x, y, w, h) {}
+
+        /**
+         * Add a widget, to be drawn after those already added.
+         */
+        WidgetGroup &add(Widget &widget);
+
+        bool dirty() const;
+        bool render(Window &w, bool force = false);
+
+        /**
+         * Redraw the members that were invalidated or touch the damaged area, and add what
+         * was redrawn to it, so whatever is drawn over this group can be redrawn in turn.
+         * @returns true if anything was drawn.
+         */
+        bool render(Window &w, Damage &damage);
+
+    protected:
+        Widget *m_first = nullptr;
+        void draw(Window &) {}
+};
+
+/**
+ * A line of text. When inverted, the text is drawn in the background color on the foreground.
+ */
+class Label: public Widget {
+    public:
+        Label(lcdint_t x, lcdint_t y, lcduint_t w, lcduint_t h, const char *text = "", EFontStyle style = STYLE_NORMAL):
+            Widget(x, y, w, h), m_text(text), m_style(style) {}
+
+        /**
+         * The text is not copied; it must stay put until replaced. A different pointer
+         * invalidates the label, so text changed in place needs invalidate().
+         */
+        Label &text(const char *text) { change(m_text, text); return *this; }
+        Label &style(EFontStyle style) { change(m_style, style); return *this; }
+        Label &inverted(bool inverted = true) { change(m_inverted, inverted); return *this; }
+        /**
+         * Where the text starts, in pixels from the left of the box.
+         */
+        Label &indent(lcdint_t indent) { change(m_indent, indent); return *this; }
+
+    protected:
+        const char *m_text;
+        EFontStyle m_style;
+        bool m_inverted = false;
+        lcdint_t m_indent = 0;
+        void draw(Window &w);
+};
+
+/**
+ * A number, right-justified in its box.
+ */
+class NumberField: public Widget {
+    public:
+        NumberField(lcdint_t x, lcdint_t y, lcduint_t w, lcduint_t h, long value = 0):
+            Widget(x, y, w, h), m_value(value) {}
+
+        NumberField &value(long value) { change(m_value, value); return *this; }
+        long value() const { return m_value; }
+
+    protected:
+        long m_value;
+        void draw(Window &w);
+};
+
+/**
+ * A bar filling its box in the foreground color, with text in the background color.
+ */
+class InvertedBar: public Label {
+    public:
+        InvertedBar(lcdint_t x, lcdint_t y, lcduint_t w, lcduint_t h, const char *text = "", EFontStyle style = STYLE_NORMAL):
+            Label(x, y, w, h, text, style) {}
+
+    protected:
+        void draw(Window &w);
+};
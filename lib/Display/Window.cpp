@@ -4,13 +4,8 @@
  */
 #include "DisplayMgr.h"
 #include "Window.h"
+#include <string.h>
 
-template<class D>
-void WindowImpl<D>::setState() {
-    _display.setFont(*m_font);
-    _display.setColor(m_color);
-    _display.setBackground(m_bgColor);
-}
 /**
  * Draws pixel on specified position
  * @param x - position X
@@ -19,9 +14,10 @@ void WindowImpl<D>::setState() {
  */
 template<class D>
 void WindowImpl<D>::putPixel(lcdint_t x, lcdint_t y) {
-    xlate(x, y, [this](auto x, auto y, auto w, auto h){
+    if (clip(x, y)) {
+        setState();
         _display.putPixel(x, y);
-    });
+    }
 };
 
 /**
@@ -33,9 +29,11 @@ void WindowImpl<D>::putPixel(lcdint_t x, lcdint_t y) {
  */
 template<class D>
 void WindowImpl<D>::drawVLine(lcdint_t x1, lcdint_t y1, lcdint_t y2) {
-    xlate2(x1, y1, x1, y2, [this](auto x1, auto y1, auto x2, auto y2){
+    lcdint_t x2 = x1;
+    if (clip(x1, y1, x2, y2)) {
+        setState();
         _display.drawVLine(x1, y1, y2);
-    });
+    }
 };
 
 /**
@@ -47,9 +45,11 @@ void WindowImpl<D>::drawVLine(lcdint_t x1, lcdint_t y1, lcdint_t y2) {
  */
 template<class D>
 void WindowImpl<D>::drawHLine(lcdint_t x1, lcdint_t y1, lcdint_t x2) {
-    xlate2(x1, y1, x2, y1, [this](auto x1, auto y1, auto x2, auto y2){
+    lcdint_t y2 = y1;
+    if (clip(x1, y1, x2, y2)) {
+        setState();
         _display.drawHLine(x1, y1, x2);
-    });
+    }
 }
 ;
 /**
@@ -62,9 +62,26 @@ void WindowImpl<D>::drawHLine(lcdint_t x1, lcdint_t y1, lcdint_t x2) {
  */
  template<class D>
 void WindowImpl<D>::fillRect(lcdint_t x1, lcdint_t y1, lcdint_t x2, lcdint_t y2) {
-    xlate2(x1, y1, x2, y2, [this](auto x1, auto y1, auto x2, auto y2){
+    if (clip(x1, y1, x2, y2)) {
+        setState();
         _display.fillRect(x1, y1, x2, y2);
-    });
+    }
+};
+
+/**
+ * Moves the pixels in a rectangle up or down
+ * @param x1 - position X
+ * @param y1 - position Y
+ * @param x2 - position X
+ * @param y2 - position Y
+ * @param dy - pixels to move down; negative moves up
+ */
+template<class D>
+void WindowImpl<D>::scroll(lcdint_t x1, lcdint_t y1, lcdint_t x2, lcdint_t y2, lcdint_t dy) {
+    if (clip(x1, y1, x2, y2)) {
+        setState();
+        _display.scroll(x1, y1, x2, y2, dy);
+    }
 };
 
 /**
@@ -79,9 +96,10 @@ void WindowImpl<D>::fillRect(lcdint_t x1, lcdint_t y1, lcdint_t x2, lcdint_t y2)
  */
 template<class D>
 void WindowImpl<D>::drawXBitmap(lcdint_t x, lcdint_t y, lcduint_t w, lcduint_t h, const uint8_t *bitmap) {
-    xlateArea(x, y, w, h, [this, bitmap](auto x, auto y, auto w, auto h){
+    if (clip(x, y, w, h)) {
+        setState();
         _display.drawXBitmap(x, y, w, h, bitmap);
-    });
+    }
 };
 
 /**
@@ -100,9 +118,10 @@ void WindowImpl<D>::drawXBitmap(lcdint_t x, lcdint_t y, lcduint_t w, lcduint_t h
  */
 template<class D>
 void WindowImpl<D>::drawBitmap1(lcdint_t x, lcdint_t y, lcduint_t w, lcduint_t h, const uint8_t *bitmap) {
-    xlateArea(x, y, w, h, [this, bitmap](auto x, auto y, auto w, auto h){
+    if (clip(x, y, w, h)) {
+        setState();
         _display.drawBitmap1(x, y, w, h, bitmap);
-    });
+    }
 };
 
 /**
@@ -117,9 +136,10 @@ void WindowImpl<D>::drawBitmap1(lcdint_t x, lcdint_t y, lcduint_t w, lcduint_t h
  */
 template<class D>
 void WindowImpl<D>::gfx_drawMonoBitmap(lcdint_t x, lcdint_t y, lcduint_t w, lcduint_t h, const uint8_t *buf) {
-    xlateArea(x, y, w, h, [this, buf](auto x, auto y, auto w, auto h){
+    if (clip(x, y, w, h)) {
+        setState();
         _display.gfx_drawMonoBitmap(x, y, w, h, buf);
-    });
+    }
 };
 
 /**
@@ -133,9 +153,10 @@ void WindowImpl<D>::gfx_drawMonoBitmap(lcdint_t x, lcdint_t y, lcduint_t w, lcdu
  */
 template<class D>
 void WindowImpl<D>::drawBitmap4(lcdint_t x, lcdint_t y, lcduint_t w, lcduint_t h, const uint8_t *bitmap) {
-    xlateArea(x, y, w, h, [this, bitmap](auto x, auto y, auto w, auto h){
+    if (clip(x, y, w, h)) {
+        setState();
         _display.drawBitmap4(x, y, w, h, bitmap);
-    });
+    }
 };
 
 /**
@@ -149,9 +170,10 @@ void WindowImpl<D>::drawBitmap4(lcdint_t x, lcdint_t y, lcduint_t w, lcduint_t h
  */
 template<class D>
 void WindowImpl<D>::drawBitmap8(lcdint_t x, lcdint_t y, lcduint_t w, lcduint_t h, const uint8_t *bitmap) {
-    xlateArea(x, y, w, h, [this, bitmap](auto x, auto y, auto w, auto h){
+    if (clip(x, y, w, h)) {
+        setState();
         _display.drawBitmap8(x, y, w, h, bitmap);
-    });
+    }
 };
 
 /**
@@ -166,9 +188,10 @@ void WindowImpl<D>::drawBitmap8(lcdint_t x, lcdint_t y, lcduint_t w, lcduint_t h
  */
 template<class D>
 void WindowImpl<D>::drawBitmap16(lcdint_t xpos, lcdint_t ypos, lcduint_t w, lcduint_t h, const uint8_t *bitmap) {
-    xlateArea(xpos, ypos, w, h, [this, bitmap](auto xpos, auto ypos, auto w, auto h){
+    if (clip(xpos, ypos, w, h)) {
+        setState();
         _display.drawBitmap16(xpos, ypos, w, h, bitmap);
-    });
+    }
 };
 
 /**
@@ -189,9 +212,10 @@ void WindowImpl<D>::drawBitmap16(lcdint_t xpos, lcdint_t ypos, lcduint_t w, lcdu
  */
 template<class D>
 void WindowImpl<D>::drawBuffer1(lcdint_t x, lcdint_t y, lcduint_t w, lcduint_t h, const uint8_t *buffer) {
-    xlateArea(x, y, w, h, [this, buffer](auto x, auto y, auto w, auto h){
+    if (clip(x, y, w, h)) {
+        setState();
         _display.drawBuffer1(x, y, w, h, buffer);
-    });
+    }
 };
 
 /**
@@ -207,9 +231,10 @@ void WindowImpl<D>::drawBuffer1(lcdint_t x, lcdint_t y, lcduint_t w, lcduint_t h
  */
 template<class D>
 void WindowImpl<D>::drawBuffer4(lcdint_t x, lcdint_t y, lcduint_t w, lcduint_t h, const uint8_t *buffer) {
-    xlateArea(x, y, w, h, [this, buffer](auto x, auto y, auto w, auto h){
+    if (clip(x, y, w, h)) {
+        setState();
         _display.drawBuffer4(x, y, w, h, buffer);
-    });
+    }
 };
 
 /**
@@ -225,9 +250,10 @@ void WindowImpl<D>::drawBuffer4(lcdint_t x, lcdint_t y, lcduint_t w, lcduint_t h
  */
 template<class D>
 void WindowImpl<D>::drawBuffer8(lcdint_t x, lcdint_t y, lcduint_t w, lcduint_t h, const uint8_t *buffer) {
-    xlateArea(x, y, w, h, [this, buffer](auto x, auto y, auto w, auto h){
+    if (clip(x, y, w, h)) {
+        setState();
         _display.drawBuffer8(x, y, w, h, buffer);
-    });
+    }
 };
 
 /**
@@ -242,9 +268,10 @@ void WindowImpl<D>::drawBuffer8(lcdint_t x, lcdint_t y, lcduint_t w, lcduint_t h
  */
 template<class D>
 void WindowImpl<D>::drawBuffer16(lcdint_t xpos, lcdint_t ypos, lcduint_t w, lcduint_t h, const uint8_t *buffer) {
-    xlateArea(xpos, ypos, w, h, [this, buffer](auto xpos, auto ypos, auto w, auto h){
+    if (clip(xpos, ypos, w, h)) {
+        setState();
         _display.drawBuffer16(xpos, ypos, w, h, buffer);
-    });
+    }
 };
 
 /**
@@ -272,6 +299,7 @@ void WindowImpl<D>::fill(uint16_t color) {
  */
 template<class D>
 uint8_t WindowImpl<D>::printChar(uint8_t c) {
+    setState();
     return _display.printChar(c);
 };
 
@@ -281,6 +309,7 @@ uint8_t WindowImpl<D>::printChar(uint8_t c) {
  */
 template<class D>
 size_t WindowImpl<D>::write(uint8_t c) {
+    setState();
     return _display.write(c);
 };
 
@@ -296,8 +325,8 @@ size_t WindowImpl<D>::write(uint8_t c) {
  */
 template<class D>
 void WindowImpl<D>::printFixed(lcdint_t xpos, lcdint_t y, const char *ch, EFontStyle style) {
-    xlate(xpos, y, [this, ch, style](auto xpos, auto y, auto w, auto h){
-        _display.printFixed(xpos, y, ch, style);
+    printLines(xpos, y, ch, 0, [this, style](lcdint_t x, lcdint_t y, const char *line) {
+        _display.printFixed(x, y, line, style);
     });
 };
 
@@ -322,7 +351,62 @@ void WindowImpl<D>::printFixed(lcdint_t xpos, lcdint_t y, const char *ch, EFontS
  */
 template<class D>
 void WindowImpl<D>::printFixedN(lcdint_t xpos, lcdint_t y, const char *ch, EFontStyle style, uint8_t factor) {
-    xlate(xpos, y, [this, ch, style, factor](auto xpos, auto y, auto w, auto h){
-        _display.printFixedN(xpos, y, ch, style, factor);
+    printLines(xpos, y, ch, factor, [this, style, factor](lcdint_t x, lcdint_t y, const char *line) {
+        _display.printFixedN(x, y, line, style, factor);
     });
 };
+
+/**
+ * Prints text a line at a time, each line cut to the glyphs that fit across the window, so
+ * the display never wraps it. A line that does not fit the window's height is skipped, as a
+ * glyph's rows cannot be cut. A line that fits whole is passed on as it is; one that is cut
+ * is copied, to at most MAX_LINE characters.
+ *
+ * @param x - position X of the first line
+ * @param y - position Y of the first line
+ * @param ch - NULL-terminated text, lines separated by '\n'
+ * @param factor - glyphs are scaled by 2^factor
+ * @param print - called with each line's position, in display coordinates, and text
+ */
+template<class D>
+template<typename F>
+void WindowImpl<D>::printLines(lcdint_t x, lcdint_t y, const char *ch, uint8_t factor, F print) {
+    if (!m_font || !clip(x, y)) {
+        return;
+    }
+    // Fixed fonts: every glyph is the same size, so a line fits as many as the first does.
+    SCharInfo info;
+    m_font->getCharBitmap(' ', &info);
+    lcdint_t width = info.width << factor;
+    lcdint_t height = info.height << factor;
+    lcdint_t advance = (info.width + info.spacing) << factor;
+    if (advance <= 0) {
+        return;
+    }
+    lcdint_t room = right() - x;
+    size_t most = room < width ? 0 : min((size_t)((room - width) / advance + 1), MAX_LINE);
+    auto bottom = this->bottom();
+    char line[MAX_LINE + 1];
+    while (y + height <= bottom) {
+        auto start = ch;
+        while (*ch && *ch != '\n') {
+            ch++;
+        }
+        auto fits = min((size_t)(ch - start), most);
+        if (fits) {
+            setState();
+            if (fits == (size_t)(ch - start) && !*ch) {
+                print(x, y, start);
+                return;
+            }
+            memcpy(line, start, fits);
+            line[fits] = 0;
+            print(x, y, line);
+        }
+        if (!*ch) {
+            return;
+        }
+        ch++;
+        y += height;
+    }
+}
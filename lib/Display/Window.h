@@ -8,7 +8,7 @@
 #undef min
 #undef max
 
-#include <functional>
+#include <utility>
 
 class Window {
     public:
@@ -19,6 +19,13 @@ class Window {
          */
         void setOffset(lcdint_t ox, lcdint_t oy) { m_offset_x = ox; m_offset_y = oy; };
 
+        /**
+         * Sets size, from the offset. Drawing is clipped to it, and to the display.
+         * @param w - width in pixels
+         * @param h - height in pixels
+         */
+        void setSize(lcduint_t w, lcduint_t h) { m_w = w; m_h = h; }
+
         /**
          * Returns right-bottom point of the canvas in offset terms.
          * If offset is (0,0), then offsetEnd() will return (width-1,height-1).
@@ -175,8 +182,8 @@ class Window {
     protected:
         lcdint_t m_offset_x = 0;
         lcdint_t m_offset_y = 0;
-        lcdint_t m_w = 0;    ///< width of NanoCanvas area in pixels
-        lcdint_t m_h = 0;    ///< height of NanoCanvas area in pixels
+        lcdint_t m_w = 0;    ///< width of the window in pixels, from its offset
+        lcdint_t m_h = 0;    ///< height of the window in pixels, from its offset
         lcdint_t m_p = 0;    ///< number of bits, used by width value: 3 equals to 8 pixels width
         lcdint_t  m_cursorX = 0;  ///< current X cursor position for text output
         lcdint_t  m_cursorY = 0;  ///< current Y cursor position for text output
@@ -186,22 +193,6 @@ class Window {
         uint16_t  m_bgColor = 0x0000;  ///< current background color
         NanoFont *m_font = nullptr; ///< currently set font
 
-        void xlateArea(lcdint_t x, lcdint_t y, lcdint_t w, lcdint_t h, std::function<void (lcdint_t x, lcdint_t y, lcdint_t w, lcdint_t h)> fn) {
-            setState();
-            lcdint_t tx = max(m_offset_x, x + m_offset_x);
-            lcdint_t ty = max(m_offset_y, y + m_offset_y);
-            lcdint_t tw = max(0, min(w, (m_w - x)));
-            lcdint_t th = max(0, min(h, (m_h - y)));
-            fn(tx, ty, tw, th);
-        }
-        void xlate(lcdint_t x, lcdint_t y, std::function<void (lcdint_t x, lcdint_t y, lcdint_t w, lcdint_t h)> fn) {
-            xlateArea(x, y, m_w, m_h, fn);
-        }
-        void xlate2(lcdint_t x1, lcdint_t y1, lcdint_t x2, lcdint_t y2, std::function<void (lcdint_t x1, lcdint_t y1, lcdint_t x2, lcdint_t y2)> fn) {
-            setState();
-            fn(max(m_offset_x, x1 + m_offset_x), max(m_offset_y, y1 + m_offset_y), max(m_offset_x, x2 + m_offset_x), max(m_offset_y, y2 + m_offset_y));
-        }
-        virtual void setState() = 0;
 
     public:
         /**
@@ -240,6 +231,16 @@ class Window {
          */
         virtual void fillRect(lcdint_t x1, lcdint_t y1, lcdint_t x2, lcdint_t y2) __attribute__((noinline)) = 0;
 
+        /**
+         * Moves the pixels in a rectangle up or down. Pixels left uncovered get the background color.
+         * @param x1 - position X
+         * @param y1 - position Y
+         * @param x2 - position X
+         * @param y2 - position Y
+         * @param dy - pixels to move down; negative moves up
+         */
+        virtual void scroll(lcdint_t x1, lcdint_t y1, lcdint_t x2, lcdint_t y2, lcdint_t dy) = 0;
+
         /**
          * Draws bitmap, located in Flash, on the display
          * The bitmap should be in XBMP format
@@ -430,15 +431,94 @@ class Window {
     protected:
 };
 
+/**
+ * A Window drawing on a display of type D.
+ *
+ * Coordinates are translated by the offset and clipped to the window, the area from the
+ * offset to the window's size or the display's edge. Rectangles and lines are clipped exactly.
+ * Text and bitmaps must start within the window. Text is cut to the glyphs that fit across it,
+ * a line at a time, and a line that does not fit its height is skipped. Bitmaps are cut to the
+ * rows that fit, and one that runs past the right edge is skipped, as its rows cannot be cut.
+ *
+ * This is final, so calls through a WindowImpl<D> or D-typed template parameter bind
+ * directly rather than through the vtable. Font and colors are sent to the display only when
+ * they differ from what was last sent, so nothing else may set them on the same display.
+ */
 template<class D>
-class WindowImpl: public Window {
+class WindowImpl final: public Window {
     protected:
         D &_display;
-        void setState();
+        NanoFont *m_sent_font = nullptr;
+        uint16_t m_sent_color = 0;
+        uint16_t m_sent_bgColor = 0;
+        bool m_sent = false;
+
+        inline void setState() {
+            if (!m_sent || m_font != m_sent_font) {
+                if (m_font) {
+                    _display.setFont(*m_font);
+                }
+                m_sent_font = m_font;
+            }
+            if (!m_sent || m_color != m_sent_color) {
+                _display.setColor(m_color);
+                m_sent_color = m_color;
+            }
+            if (!m_sent || m_bgColor != m_sent_bgColor) {
+                _display.setBackground(m_bgColor);
+                m_sent_bgColor = m_bgColor;
+            }
+            m_sent = true;
+        }
+
+        // Longest line of text cut to fit the window, in characters.
+        static constexpr size_t MAX_LINE = 63;
+
+        // The window's right and bottom edges in display coordinates, just past its last pixels.
+        inline lcdint_t right() const { return min(m_offset_x + m_w, (lcdint_t)_display.width()); }
+        inline lcdint_t bottom() const { return min(m_offset_y + m_h, (lcdint_t)_display.height()); }
+
+        // Translate a rectangle to display coordinates and clip it to the window.
+        // Returns false if nothing is left.
+        inline bool clip(lcdint_t &x1, lcdint_t &y1, lcdint_t &x2, lcdint_t &y2) const {
+            if (x1 > x2) std::swap(x1, x2);
+            if (y1 > y2) std::swap(y1, y2);
+            x1 = max(x1 + m_offset_x, max(m_offset_x, 0));
+            y1 = max(y1 + m_offset_y, max(m_offset_y, 0));
+            x2 = min(x2 + m_offset_x, right() - 1);
+            y2 = min(y2 + m_offset_y, bottom() - 1);
+            return x1 <= x2 && y1 <= y2;
+        }
+
+        // Translate a point to display coordinates. Returns false if it is outside the window.
+        inline bool clip(lcdint_t &x, lcdint_t &y) const {
+            lcdint_t x2 = x;
+            lcdint_t y2 = y;
+            return clip(x, y, x2, y2);
+        }
+
+        // Translate a bitmap's position to display coordinates, and cut its height to the
+        // window. Returns false if it starts outside the window or runs past its right edge.
+        inline bool clip(lcdint_t &x, lcdint_t &y, lcduint_t w, lcduint_t &h) const {
+            if (!clip(x, y) || x + (lcdint_t)w > right()) {
+                return false;
+            }
+            h = min((lcdint_t)h, bottom() - y);
+            return true;
+        }
+
+        // Print text starting within the window a line at a time, each cut to the glyphs of
+        // 2^factor scale that fit across the window, with print(x, y, line).
+        template<typename F>
+        void printLines(lcdint_t x, lcdint_t y, const char *ch, uint8_t factor, F print);
+
     public:
-        void begin() { _display.begin(); }
+        void begin() { _display.begin(); m_sent = false; }
         void end() { _display.end(); }
-        WindowImpl(D &display): _display(display) {}
+        WindowImpl(D &display): _display(display) {
+            m_w = display.width();
+            m_h = display.height();
+        }
 
         operator D&() { return _display; }
 
@@ -478,6 +558,16 @@ class WindowImpl: public Window {
         */
         void fillRect(lcdint_t x1, lcdint_t y1, lcdint_t x2, lcdint_t y2);
 
+        /**
+         * Moves the pixels in a rectangle up or down. Pixels left uncovered get the background color.
+         * @param x1 - position X
+         * @param y1 - position Y
+         * @param x2 - position X
+         * @param y2 - position Y
+         * @param dy - pixels to move down; negative moves up
+         */
+        void scroll(lcdint_t x1, lcdint_t y1, lcdint_t x2, lcdint_t y2, lcdint_t dy);
+
         /**
          * Draws bitmap, located in Flash, on the display
          * The bitmap should be in XBMP format
@@ -5,5 +5,7 @@
 #pragma GCC diagnostic ignored "-Wsign-compare"
 #include "Window.h"
 #include "Window.cpp"
+#include "FrameBuffer.cpp"
 #include "DisplayMgr.h"
-template class WindowImpl<RawDisplay>;
+template class FrameBuffer<RawDisplay>;
+template class WindowImpl<FrameDisplay>;
@@ -0,0 +1,75 @@
+/**
+ * @copyright Copyright (c) 2021 Bob Kerns
+ * License: MIT
+ */
+// Lock-free single-producer/single-consumer ring, for handing events from interrupt level
+// to the main program without disabling interrupts.
+#pragma once
+#include <stdint.h>
+#include <atomic>
+
+// Fixed capacity, which must be a power of two, and no heap. Exactly one context may push
+// (e.g. the pin interrupt handlers, which the EIC never nests) and exactly one may pop.
+// Aligned 32-bit loads and stores are atomic on the Cortex-M0+, so the indices need no locking;
+// the acquire/release ordering makes the slot contents visible before the index that publishes them.
+template<typename T, uint32_t N>
+class EventRing {
+    static_assert(N >= 2 && (N & (N - 1)) == 0, "EventRing capacity must be a power of two");
+    private:
+        static const uint32_t MASK = N - 1;
+        T items[N];
+        // Free-running; the difference is the number of queued items.
+        std::atomic<uint32_t> head{0};
+        std::atomic<uint32_t> tail{0};
+        std::atomic<uint32_t> overflow_count{0};
+    public:
+        static const uint32_t capacity = N;
+
+        // Producer only. Returns false, and counts an overflow, if the ring is full.
+        bool push(const T &item) {
+            auto h = head.load(std::memory_order_relaxed);
+            if (h - tail.load(std::memory_order_acquire) >= N) {
+                overflow_count.store(overflow_count.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+                return false;
+            }
+            items[h & MASK] = item;
+            head.store(h + 1, std::memory_order_release);
+            return true;
+        }
+
+        // Consumer only. Returns false if the ring is empty.
+        bool pop(T &item) {
+            auto t = tail.load(std::memory_order_relaxed);
+            if (t == head.load(std::memory_order_acquire)) {
+                return false;
+            }
+            item = items[t & MASK];
+            tail.store(t + 1, std::memory_order_release);
+            return true;
+        }
+
+        // Consumer only. Pop every queued item, in order, passing each to fn.
+        template<typename F>
+        uint32_t drain(F fn) {
+            uint32_t n = 0;
+            T item;
+            while (pop(item)) {
+                fn(item);
+                n++;
+            }
+            return n;
+        }
+
+        bool empty() const {
+            return head.load(std::memory_order_acquire) == tail.load(std::memory_order_acquire);
+        }
+
+        uint32_t size() const {
+            return head.load(std::memory_order_acquire) - tail.load(std::memory_order_acquire);
+        }
+
+        // Number of pushes dropped because the ring was full.
+        uint32_t overflows() const {
+            return overflow_count.load(std::memory_order_relaxed);
+        }
+};
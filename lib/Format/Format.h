@@ -0,0 +1,133 @@
+/**
+ * @copyright Copyright (c) 2021 Bob Kerns
+ * License: MIT
+ */
+// Allocation-free text formatting into fixed-size buffers.
+#pragma once
+#include <stddef.h>
+#include <stdint.h>
+#include <array>
+
+// Note names with octave, as shown on the display: middle C (60) is "C3". Names with no
+// accidental are padded to line up with the sharps, e.g. "C3 " and "C#3".
+class NoteNames {
+    private:
+        static const size_t WIDTH = 5;
+        using Table = std::array<std::array<char, WIDTH>, 128>;
+        static constexpr Table make() {
+            const char names[12][3] = {"C", "C#", "D", "D#", "E", "F", "F#", "G", "G#", "A", "A#", "B"};
+            Table t = {};
+            for (int note = 0; note < 128; note++) {
+                auto name = names[note % 12];
+                int octave = note / 12 - 2;
+                size_t i = 0;
+                t[note][i++] = name[0];
+                if (name[1]) t[note][i++] = name[1];
+                if (octave < 0) {
+                    t[note][i++] = '-';
+                    octave = -octave;
+                }
+                t[note][i++] = '0' + octave;
+                if (!name[1]) t[note][i++] = ' ';
+                t[note][i] = '\0';
+            }
+            return t;
+        }
+        static const Table table;
+    public:
+        static constexpr const char *name(uint8_t note) {
+            return table[note & 0x7f].data();
+        }
+};
+
+inline constexpr NoteNames::Table NoteNames::table = NoteNames::make();
+
+/**
+ * Text built up in a char[N] on the stack. Appending never allocates; whatever does not fit
+ * is dropped, and the text is always terminated.
+ */
+template<size_t N>
+class Format {
+    static_assert(N >= 2, "Format buffer too small");
+    private:
+        char buf[N];
+        size_t len = 0;
+        inline void put(char c) {
+            if (len < N - 1) {
+                buf[len++] = c;
+            }
+        }
+        template<typename T>
+        Format &hexDigits(T val) {
+            static const char DIGITS[] = "0123456789abcdef";
+            for (int shift = sizeof(T) * 8 - 4; shift >= 0; shift -= 4) {
+                put(DIGITS[(val >> shift) & 0xf]);
+            }
+            buf[len] = '\0';
+            return *this;
+        }
+    public:
+        Format() {
+            buf[0] = '\0';
+        }
+        explicit Format(const char *str): Format() {
+            add(str);
+        }
+
+        Format &add(const char *str) {
+            while (*str) {
+                put(*str++);
+            }
+            buf[len] = '\0';
+            return *this;
+        }
+
+        Format &add(char c) {
+            put(c);
+            buf[len] = '\0';
+            return *this;
+        }
+
+        Format &add(long val) {
+            unsigned long mag = val < 0 ? 0ul - static_cast<unsigned long>(val) : val;
+            if (val < 0) {
+                put('-');
+            }
+            return add(mag);
+        }
+
+        Format &add(unsigned long val) {
+            char digits[20];
+            int n = 0;
+            do {
+                digits[n++] = '0' + val % 10;
+                val /= 10;
+            } while (val);
+            while (n) {
+                put(digits[--n]);
+            }
+            buf[len] = '\0';
+            return *this;
+        }
+
+        Format &add(int val) { return add(static_cast<long>(val)); }
+        Format &add(unsigned val) { return add(static_cast<unsigned long>(val)); }
+        Format &add(uint8_t val) { return add(static_cast<unsigned long>(val)); }
+
+        // Fixed-width lowercase hex: two digits per byte.
+        Format &hex(uint8_t val) { return hexDigits(val); }
+        Format &hex(uint16_t val) { return hexDigits(val); }
+        Format &hex(uint32_t val) { return hexDigits(val); }
+
+        Format &note(uint8_t note) { return add(NoteNames::name(note)); }
+
+        Format &clear() {
+            len = 0;
+            buf[0] = '\0';
+            return *this;
+        }
+
+        const char *c_str() const { return buf; }
+        size_t size() const { return len; }
+        static constexpr size_t capacity() { return N - 1; }
+};
@@ -3,20 +3,44 @@
  * License: MIT
  */
 #pragma once
-#include <functional>
+#include <stdint.h>
 
 class KeyTracker {
     private:
         static const uint8_t WIDTH = 32;
         static const uint8_t WORDS = 128/WIDTH;
         static const uint32_t MASK = 0xffffffff;
+        // Key i * WIDTH + j is bit (0x80000000 >> j) of word i, so leading zeros give j.
         uint32_t bitmap[WORDS];
+        // Number of bits set in bitmap.
+        uint8_t held = 0;
         uint8_t channel;
     public:
-        using keyMapper = std::function<bool(int)>;
         KeyTracker(uint8_t channel): bitmap(), channel(channel) {}
         void up(uint8_t key);
         void down(uint8_t key);
-        void doKeys(keyMapper mapper);
+        // Iterate over the keys that are down, in ascending order. Keys for which
+        // mapper(key) returns false are put up.
+        template<typename F>
+        void doKeys(F mapper);
         bool allUp() const;
+        // Number of keys down.
+        inline uint8_t count() const {
+            return held;
+        }
 };
+
+template<typename F>
+void KeyTracker::doKeys(F mapper) {
+    for (uint8_t i = 0; i < WORDS; i++) {
+        // Visit only the set bits, clearing each from a copy as we go.
+        for (auto b = bitmap[i]; b; ) {
+            uint8_t j = __builtin_clz(b);
+            b &= ~(0x80000000 >> j);
+            uint8_t key = i * WIDTH + j;
+            if (!mapper(key)) {
+                up(key);
+            }
+        }
+    }
+}
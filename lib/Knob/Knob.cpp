@@ -11,30 +11,91 @@
 
 unsigned int Knob::next_idx = 0;
 
-void Knob::localAttachInterrupt(int pin, ISR fn, int mode) {
-    attachInterrupt(digitalPinToInterrupt(pin), Callback::next(fn), mode);
-}
-
-// Update the state and count.
-void Knob::updateCount(void) {
-    rotate_millis = millis();
-    uint8_t s = state & 3;
-    if (digitalRead(dt)) s |= 4;
-    if (digitalRead(clk)) s |= 8;
-    switch (s) {
-        case 0: case 5: case 10: case 15:
-            break;
-        case 1: case 7: case 8: case 14:
-            count++; break;
-        case 2: case 4: case 11: case 13:
-            count--; break;
-        case 3: case 12:
-            count += 2; break;
-        default:
-            count -= 2; break;
+void Knob::localAttachInterrupt(int pin, callbackFn fn, int mode) {
+    if (fn) {
+        attachInterrupt(digitalPinToInterrupt(pin), fn, mode);
+    }
+}
+
+#ifdef ARDUINO_ARCH_SAMD
+static const volatile uint32_t *portIn(int pin) {
+    return &PORT->Group[g_APinDescription[pin].ulPort].IN.reg;
+}
+
+static uint32_t pinMask(int pin) {
+    return 1ul << g_APinDescription[pin].ulPin;
+}
+#endif
+
+inline uint8_t Knob::samplePins() const {
+#ifdef ARDUINO_ARCH_SAMD
+    if (clk_in == dt_in) {
+        uint32_t in = *clk_in;
+        return ((in & clk_mask) ? 8 : 0) | ((in & dt_mask) ? 4 : 0);
+    }
+    return ((*clk_in & clk_mask) ? 8 : 0) | ((*dt_in & dt_mask) ? 4 : 0);
+#else
+    return (digitalRead(clk) ? 8 : 0) | (digitalRead(dt) ? 4 : 0);
+#endif
+}
+
+// Change in count, indexed by (current clk, current dt, previous clk, previous dt).
+// A 2 means both pins changed at once (a missed edge); we assume it kept going the same way.
+static constexpr int8_t TRANSITIONS[16] = {
+     0,  1, -1,  2,
+    -1,  0, -2,  1,
+     1, -2,  0, -1,
+     2, -1,  1,  0
+};
+
+// Sample the encoder and return the change in count.
+int8_t Knob::sampleCount() {
+    uint8_t s = samplePins() | (state & 3);
+    state = s >> 2;
+    return TRANSITIONS[s];
+}
+
+// Interrupt level: queue the change for read().
+void Knob::updateCount() {
+    auto delta = sampleCount();
+    if (delta) {
+        events.push({KnobEvent::DELTA, delta, millis()});
     }
-    constrainCount();
-    state = (s >> 2);
+}
+
+// Main level: apply a change in count.
+void Knob::applyCount(int8_t delta, unsigned long ms) {
+    if (delta) {
+        rotate_millis = ms;
+        auto x = 4/count_precision;
+        auto before = count / x;
+        count += delta;
+        auto steps = count / x - before;
+        if (steps && accel.max_multiplier > 1) {
+            // Add whole user-level steps, so the position within a detent is unchanged.
+            count += (stepMultiplier(steps > 0 ? 1 : -1, ms) - 1) * steps * x;
+        }
+        constrainCount();
+    }
+}
+
+int32_t Knob::stepMultiplier(int8_t dir, unsigned long ms) {
+    auto interval = ms - step_millis;
+    auto reversed = dir != step_dir;
+    step_millis = ms;
+    step_dir = dir;
+    if (reversed || interval >= accel.slow_ms) {
+        return 1;
+    }
+    int32_t mult = interval <= accel.fast_ms
+        ? accel.max_multiplier
+        : 1 + (accel.max_multiplier - 1) * (accel.slow_ms - interval) / (accel.slow_ms - accel.fast_ms);
+    if (wrap) {
+        // Never go all the way around in one step.
+        int32_t size = (max_count - min_count + 1) / (4/count_precision);
+        mult = std::min(mult, std::max<int32_t>(size - 1, 1));
+    }
+    return mult;
 }
 
 void Knob::constrainCount() {
@@ -56,95 +117,63 @@ void Knob::constrainCount() {
     }
 }
 
-// This runs both at interrupt level and main program level
+// Interrupt level: queue the raw switch level for read() to debounce.
 void Knob::updateSwitch() {
     auto press = !digitalRead(sw);
-    // Transitions with 'M' in the I/M collumn must be handled at the main program level by checkSwitch/handlerSwitch
-    switch (sw_state) {
-        //  -  -   -  I T       ON    -- => PRESSED_DEBOUNCE
-        case IDLE:
-        if (press) {
-            sw_state = PRESSED_DEBOUNCE;
-            sw_state_ms = millis();
-        }
-        break;
-        //  1  -   1  I - TIME, ON    -- => PRESSED
-        //            I T TIME, OFF   -- => PRESSED_RELEASED_DEBOUNCE
-        case PRESSED_DEBOUNCE: {
-            auto now = millis();
-            if (sw_state_ms + debounce_ms < now) {
-                if (press) {
-                sw_state = PRESSED;
-                } else {
-                sw_state = PRESSED_RELEASED_DEBOUNCE;
-                sw_state_ms = now;
-                }
-            }
-            break;
-        }
-        //  1  -   -  M -       ON    P- => PRESSED_HANDLED
-        //            M T       OFF   P- => HANDLED_RELEASED_DEBOUNCE
-        //            I T       OFF   -- => PRESSED_RELEASED_DEBOUNCE
-        case PRESSED:
-            if (!press) {
-                sw_state = PRESSED_RELEASED_DEBOUNCE;
-                sw_state_ms = millis();
-            }
-            break;
-        //  -  -   -  I T       OFF   -- => HANDLED_RELEASED_DEBOUNCE
-        case PRESSED_HANDLED:
-            if (!press) {
-                sw_state = HANDLED_RELEASED_DEBOUNCE;
-                sw_state_ms = millis();
-            }
-            break;
-        //  -  1   1  I - TIME, OFF   -- => RELEASED
-        //            I T TIME, ON    -- => RELEASED_PRESSED_DEBOUNCE
-        case HANDLED_RELEASED_DEBOUNCE: {
-        auto now = millis();
-            if (sw_state_ms + debounce_ms < now) {
-                if (!press) {
-                    sw_state = RELEASED;
-                } else {
-                    sw_state = RELEASED_PRESSED_DEBOUNCE;
-                    sw_state_ms = now;
-                }
-            }
-            break;
-            }
-        //  -  1   -  M T       ON    R- => PRESSED_DEBOUNCE
-        //            M -       OFF   R- => IDLE
-        //            I T       ON    -- => RELEASED_PRESSED_DEBOUNCE
-        case RELEASED:
-            if (press) {
-                sw_state = RELEASED_PRESSED_DEBOUNCE;
-                sw_state_ms = millis();
-            }
-            break;
-        //  1   1  1  M -       -     R- -> PRESSED_DEBOUNCE
-        //            I - TIME  -     -- => RELEASED_PRESSED
-        case RELEASED_PRESSED_DEBOUNCE:
-            if (sw_state_ms + debounce_ms < millis()) {
-                sw_state = RELEASED_PRESSED;
-            }
-            break;
-        //  1   1  -  M -       -     RP => PRESSED => PRESSED_HANDLED *
-        case RELEASED_PRESSED:
-            break;
-        //  1   1  1  M -       -     P- => HANDLED_RELEASED_DEBOUNCE
-        //            I - TIME  -     -- => PRESSED_RELEASED
-        case PRESSED_RELEASED_DEBOUNCE: {
-            if (sw_state_ms + debounce_ms < millis()) {
-                sw_state = PRESSED_RELEASED;
-            }
-            break;
-        }
-        //  1   1  -  M -       ON    PR => PRESSED_HANDLED => IDLE *
-        case PRESSED_RELEASED:
-            break;
+    events.push({press ? KnobEvent::PRESS : KnobEvent::RELEASE, 0, millis()});
+}
+
+// Main level: a raw switch level seen at time ms. A change is reported immediately unless
+// we are still within debounce_ms of the last reported change.
+void Knob::applySwitch(bool pressed, unsigned long ms) {
+    sw_level = pressed;
+    if (pressed != sw_down && ms - sw_changed_ms > debounce_ms) {
+        setSwitch(pressed, ms);
+    }
+}
+
+// Main level: a change that was held off by debouncing is reported once the switch has settled.
+void Knob::settleSwitch(unsigned long now) {
+    if (sw_level != sw_down && now - sw_changed_ms > debounce_ms) {
+        setSwitch(sw_level, now);
+    }
+}
+
+void Knob::setSwitch(bool pressed, unsigned long ms) {
+    sw_down = pressed;
+    sw_changed_ms = ms;
+#ifdef KNOB_TRACE
+    if (idx == 0) {
+        static Overlay trace(4, 0, BODY_TOP, 128, BODY_HEIGHT);
+        static bool added = compositor.add(trace);
+        (void)added;
+        trace.showFor(1000, [this]{ display.printFixed(0, 16, switchState(), STYLE_NORMAL); });
+    }
+#endif
+    if (pressed) {
+        if (on_press) on_press(*this, true);
+    } else {
+        if (on_release) on_release(*this, false);
     }
 }
 
+// Main level: apply everything the interrupt handlers have queued, in order.
+void Knob::drain() {
+    events.drain([this](const KnobEvent &ev) {
+        switch (ev.kind) {
+            case KnobEvent::DELTA:
+                applyCount(ev.delta, ev.ms);
+                break;
+            case KnobEvent::PRESS:
+                applySwitch(true, ev.ms);
+                break;
+            case KnobEvent::RELEASE:
+                applySwitch(false, ev.ms);
+                break;
+        }
+    });
+}
+
 // Determine which pins support interrupts.
 int Knob::calculateInterrupts(int clk, int dt, int sw) {
     return (digitalPinToInterrupt(clk) != NOT_AN_INTERRUPT ? 1 : 0)
@@ -153,7 +182,11 @@ int Knob::calculateInterrupts(int clk, int dt, int sw) {
 }
 
 Knob::Knob(const char *name, int clk, int dt, int sw):
-    knob_name(name), clk(clk), dt(dt), sw(sw), idx(next_idx++), interruptFlags(calculateInterrupts(clk, dt, sw)) {
+    knob_name(name), clk(clk), dt(dt), sw(sw),
+#ifdef ARDUINO_ARCH_SAMD
+    clk_in(portIn(clk)), dt_in(portIn(dt)), clk_mask(pinMask(clk)), dt_mask(pinMask(dt)),
+#endif
+    idx(next_idx++), interruptFlags(calculateInterrupts(clk, dt, sw)) {
 }
 
 // Called during setup()
@@ -178,31 +211,77 @@ void Knob::start(PinMode modeClk, PinMode modeDt, PinMode modeSw) {
     if (sw >= 0) {
         setMode(sw, modeSw);
     }
-    delay(500);
+    settled = false;
+    settle_levels = pinLevels();
+    start_ms = settle_ms = millis();
+}
+
+uint8_t Knob::pinLevels() const {
+    return (digitalRead(clk) ? 1 : 0) | (digitalRead(dt) ? 2 : 0) | ((sw >= 0 && digitalRead(sw)) ? 4 : 0);
+}
+
+void Knob::settle(unsigned long now) {
+    auto levels = pinLevels();
+    if (levels != settle_levels) {
+        settle_levels = levels;
+        settle_ms = now;
+    }
+    if (now - settle_ms < KNOB_SETTLE_MS && now - start_ms < KNOB_SETTLE_LIMIT_MS) {
+        return;
+    }
+    settled = true;
     if (digitalRead(clk)) state |= 1;
     if (digitalRead(dt)) state |= 2;
-    auto update = [this]{ updateCount(); };
+    // Sampled before the handlers are attached: the event ring takes one producer, and once
+    // they are, that is the interrupt level.
+    applyCount(sampleCount(), now);
+    // Both encoder pins share one trampoline.
+    auto update = Callback::bind<&Knob::updateCount>(*this);
     localAttachInterrupt(clk, update, CHANGE);
     localAttachInterrupt(dt, update, CHANGE);
-    update();
     if (sw >= 0) {
-        updateSwitch();
-        localAttachInterrupt(
-            sw,
-            [this](void) -> void {
-                updateSwitch();
-            },
-            CHANGE);
+        sw_down = sw_level = !digitalRead(sw);
+        localAttachInterrupt(sw, Callback::bind<&Knob::updateSwitch>(*this), CHANGE);
     }
 }
 
 int Knob::read() {
-  auto resync = [this] {
+    auto now = millis();
+    if (!settled) {
+        settle(now);
+        if (!settled) {
+            return previous_count;
+        }
+    }
+    switch (interruptFlags & 0x3) {
+        case 0:
+            // Polled; no interrupt handler to share with.
+            applyCount(sampleCount(), now);
+            break;
+        case 1:
+        case 2: {
+            // Only one pin interrupts, so the main level samples too, and shares the
+            // quadrature state with the interrupt handler.
+            noInterrupts();
+            auto delta = sampleCount();
+            interrupts();
+            applyCount(delta, now);
+            break;
+        }
+        case 3:
+            break;
+    }
+    if (sw >= 0 && !(interruptFlags & 4)) {
+        applySwitch(!digitalRead(sw), now);
+    }
+    drain();
+    if (sw >= 0) {
+        settleSwitch(now);
+    }
     switch (count_precision) {
         case Precision::NORMAL:  {
             auto skew = count & 0x3;
             if (skew) {
-                unsigned long now = millis();
                 if (now - rotate_millis > ROTATE_GUARD_MS) {
                     // Round, unless TDC.
                     switch (skew) {
@@ -222,10 +301,8 @@ int Knob::read() {
         case Precision::DOUBLE: ;
         case Precision::QUAD: ;
     }
-  };
-  auto handleCount = [this](int32_t val){
     auto x = 4/count_precision;
-    auto user_count = (val) / x;
+    auto user_count = count / x;
     if (on_change) {
       if (user_count != previous_count) {
         on_change(*this, previous_count, user_count);
@@ -233,187 +310,33 @@ int Knob::read() {
       }
     }
     return user_count;
-  };
-  // The main program portion of the state machine. This runs while interrupts are locked,
-  // so the dispatch is performed again by handleSwitch to actually run the handlers.
-  auto checkSwitch = [this](SwitchState cur_state) -> SwitchState {
-    if (sw >= 0) {
-      switch (cur_state) {
-        //  1  -   -  M -       ON    P- => PRESSED_HANDLED
-        //            M T       OFF   P- => HANDLED_RELEASED_DEBOUNCE
-        //            I T       OFF   -- => PRESSED_RELEASED_DEBOUNCE
-        case PRESSED:
-          if (!digitalRead(sw)) {
-            sw_state = PRESSED_HANDLED;
-          } else {
-            sw_state = HANDLED_RELEASED_DEBOUNCE;
-            sw_state_ms = millis();
-          }
-          break;
-        //  -  1   -  M T       ON    R- => PRESSED_DEBOUNCE
-        //            M -       OFF   R- => IDLE
-        //            I T       ON    -- => RELEASED_PRESSED_DEBOUNCE
-        case RELEASED:
-          if (!digitalRead(sw)) {
-            sw_state = PRESSED_DEBOUNCE;
-            sw_state_ms = millis();
-          } else {
-            sw_state = IDLE;
-          }
-          break;
-        //  1   1  -  M -       -     RP => PRESSED => PRESSED_HANDLED *
-        case RELEASED_PRESSED:
-          sw_state = PRESSED_HANDLED;
-          break;
-        //  1   1  -  M -       ON    PR => PRESSED_HANDLED => IDLE *
-        case PRESSED_RELEASED:
-          sw_state = IDLE;
-          break;
-        //  1   1  1  M -       -     R- -> PRESSED_DEBOUNCE
-        //            I - TIME  -     -- => RELEASED_PRESSED
-        case RELEASED_PRESSED_DEBOUNCE:
-          sw_state = PRESSED_DEBOUNCE;
-          break;
-        //  1   1  1  M -       -     P- => HANDLED_RELEASED_DEBOUNCE
-        //            I - TIME  0     -- => PRESSED_RELEASED
-        case PRESSED_RELEASED_DEBOUNCE:
-          sw_state = HANDLED_RELEASED_DEBOUNCE;
-          break;
-        // Handled at interrupt level.
-        case PRESSED_DEBOUNCE:
-        case PRESSED_HANDLED:
-        case HANDLED_RELEASED_DEBOUNCE:
-        case IDLE:
-            break;
-      }
-#ifdef KNOB_TRACE
-     if (idx == 0) {
-        showBodyFor(1000, [this]{ display.printFixed(0, 16, switchState(), STYLE_NORMAL); });
-     }
-#endif
-    }
-    return cur_state;
-  };
-  // Run the switch handlers. The state changes are already performed by checkSwitch w/ interrupts locked.
-  // This runs with interrupts enabled.
-  auto handleSwitch = [this](SwitchState cur_state){
-    switch (cur_state) {
-        case PRESSED_RELEASED_DEBOUNCE:
-        case PRESSED:
-            if (on_press) on_press(*this, true);
-            break;
-        case RELEASED_PRESSED_DEBOUNCE:
-        case RELEASED:
-            if (on_release) on_release(*this, false);
-            break;
-        //  1   1  -  M -       -     RP => PRESSED => PRESSED_HANDLED *
-        case RELEASED_PRESSED:
-            if (on_release) on_release(*this, false);
-            if (on_press) on_press(*this, true);
-            break;
-        //  1   1  -  M -       ON    PR => PRESSED_HANDLED => IDLE *
-        case PRESSED_RELEASED:
-            if (on_press) on_press(*this, true);
-            if (on_release) on_release(*this, false);
-            break;
-
-        // Handled at interrupt level.
-        case PRESSED_DEBOUNCE:
-        case PRESSED_HANDLED:
-        case HANDLED_RELEASED_DEBOUNCE:
-        case IDLE:
-            break;
-    }
-  };
-    switch (interruptFlags & 0x3) {
-        case 0: {
-            // No need for synchronization
-            resync();
-            updateCount();
-            auto userCount = handleCount(count);
-            if (sw >= 0) {
-                updateSwitch(); // Interrupt-level portion
-                handleSwitch(checkSwitch(sw_state));  // main-level portion
-            }
-            return userCount;
-        }
-        case 1:
-        case 2:
-        // Need to synchronize and update
-            noInterrupts();
-            resync();
-            updateCount();
-            break;
-        case 3:
-            noInterrupts();
-            resync();
-    }
-    updateSwitch();
-    auto val = count;
-    // Pick up the current state, and if we're going to call, perform that transition while interrupts are locked.
-    auto cur_state = sw_state;
-    if (sw >= 0) {
-        checkSwitch(sw_state);
-    }
-    interrupts();
-    auto user_count = handleCount(val);
-    if (sw >= 0) {
-        handleSwitch(cur_state);
-    }
-    return user_count;
 }
 
 void Knob::write(int c) {
-    // Keeping as much of the code outside of the locked range of interrupts as possible.
-    auto now = millis();
-        if (now > rotate_millis + ROTATE_GUARD_MS) {
-        auto incr = 4/count_precision;
-        auto range = (max_count - min_count);
-        auto ncount = (c * incr - min_count) % range + min_count;
-        auto ncount_max = ((c + 1) * incr - min_count) % range + min_count;
-        // Don't set if it would not be an actual user-level change in the value.
-        if (ncount == ncount_max - 1) {
-            // Optimized case. Like normal, but anything not equal counts as new.
-            noInterrupts();
-            if (ncount != count) {
-                count = previous_count = c;
-                state = 0;
-            }
-            interrupts();
-        } else if (ncount < ncount_max) {
-            // Normal case; new counts are either smaller, or ncount_max or larger.
-            noInterrupts();
-            if (ncount < count || count >= ncount_max) {
-                count = previous_count = c;
-                state = 0;
-            }
-            interrupts();
-        } else {
-            // Max has wrapped around; anything less than our count is new.
-            noInterrupts();
-            if (count < ncount) {
-                count = previous_count = c;
-                state = 0;
-            }
-            interrupts();
-        }
+    // Apply motion already queued, so it does not land on top of the new value.
+    drain();
+    // A knob being turned keeps where the hand has put it.
+    if (rotate_millis && millis() - rotate_millis <= ROTATE_GUARD_MS) {
+        return;
+    }
+    auto x = 4/count_precision;
+    // Already within the step, the knob keeps its place in the detent.
+    if (count / x == c) {
+        return;
     }
+    count = c * x;
+    constrainCount();
+    previous_count = count / x;
 }
 
 Knob &Knob::minCount(int c) {
     auto x = 4/count_precision;
-    auto nval = c == NO_MINIMUM ? NO_MINIMUM : x * c;
-    noInterrupts();
-    min_count = nval;
-    interrupts();
+    min_count = c == NO_MINIMUM ? NO_MINIMUM : x * c;
     return *this;
 }
 Knob &Knob::maxCount(int c) {
     auto x = 4/count_precision;
-    auto nval = c == NO_MAXIMUM ? NO_MAXIMUM : x * c + count_precision - 1;
-    noInterrupts();
-    max_count = nval;
-    interrupts();
+    max_count = c == NO_MAXIMUM ? NO_MAXIMUM : x * c + x - 1;
     return *this;
 }
 
@@ -421,12 +344,10 @@ Knob &Knob::maxCount(int c) {
 Knob &Knob::range(int lowerBound, int upperBound, bool doWrap) {
     auto x = 4/count_precision;
     auto nLower = lowerBound == NO_MINIMUM ? NO_MINIMUM : lowerBound * x;
-    auto nUpper = upperBound == NO_MAXIMUM ? NO_MAXIMUM : upperBound * x + count_precision - 1;
-    noInterrupts();
+    auto nUpper = upperBound == NO_MAXIMUM ? NO_MAXIMUM : upperBound * x + x - 1;
     min_count = nLower;
     max_count = nUpper;
     wrap = doWrap;
-    interrupts();
     return *this;
 }
 
@@ -442,7 +363,7 @@ Knob &Knob::range(int lowerBound, bool wrap) {
 
 std::tuple<int32_t, int32_t, bool> Knob::getRange() const {
     auto x = 4/count_precision;
-    return std::make_tuple((min_count) / x, (max_count - count_precision + 1) / x, wrap);
+    return std::make_tuple((min_count) / x, (max_count - x + 1) / x, wrap);
 }
 
 std::tuple<int32_t, int32_t, bool> Knob::getRawRange() const {
@@ -464,6 +385,21 @@ Knob::Precision Knob::getPrecision() const {
     return count_precision;
 }
 
+Knob &Knob::acceleration(const KnobAcceleration &curve) {
+    accel = curve;
+    if (accel.max_multiplier < 1) {
+        accel.max_multiplier = 1;
+    }
+    if (accel.fast_ms >= accel.slow_ms) {
+        accel.fast_ms = accel.slow_ms ? accel.slow_ms - 1 : 0;
+    }
+    return *this;
+}
+
+const KnobAcceleration &Knob::getAcceleration() const {
+    return accel;
+}
+
 const char * Knob::getName() const {
     return knob_name;
 }
@@ -477,18 +413,6 @@ Knob &Knob::name(const char *newName) {
 
 #ifdef KNOB_TRACE
 const char *Knob::switchState() {
-    switch (sw_state) {
-        case IDLE: return "IDLE";
-        case PRESSED: return "PRESSED";
-        case PRESSED_DEBOUNCE: return "PRESSED_DEBOUNCE";
-        case PRESSED_HANDLED: return "PRESSED_HANDLED";
-        case HANDLED_RELEASED_DEBOUNCE: return "H-R-DEBOUNCE";
-        case RELEASED: return "RELEASED";
-        case RELEASED_PRESSED: return "RELEASED_PRESSED";
-        case PRESSED_RELEASED: return "PRESSED_RELEASED";
-        case RELEASED_PRESSED_DEBOUNCE: return "R-P-DEBOUNCE";
-        case PRESSED_RELEASED_DEBOUNCE: return "P-R-DEBOUNCE";
-        default: return ">>UNKNOWN<<";
-    }
+    return sw_down ? "PRESSED" : "RELEASED";
 }
 #endif
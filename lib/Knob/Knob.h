@@ -4,10 +4,47 @@
  */
 #pragma once
 #include <Callback.h>
+#include <EventRing.h>
 #include "Arduino.h"
 
+#ifndef KNOB_EVENT_RING_SIZE
+#define KNOB_EVENT_RING_SIZE 32
+#endif
+
+// After start(), how long the pins must hold their levels before the knob is read, in ms.
+// Pull-ups charge the lines in microseconds; this rides out contact bounce on a knob being handled.
+#ifndef KNOB_SETTLE_MS
+#define KNOB_SETTLE_MS 5
+#endif
+
+// Start reading anyway after this long, in ms, should a pin never stop changing.
+#ifndef KNOB_SETTLE_LIMIT_MS
+#define KNOB_SETTLE_LIMIT_MS 500
+#endif
+
 class Knob;
 
+// What the interrupt handlers saw, for the main level to act on.
+struct KnobEvent {
+    enum Kind: uint8_t {
+        DELTA,      // Encoder moved by delta counts
+        PRESS,      // Switch pin went to pressed (not yet debounced)
+        RELEASE     // Switch pin went to released (not yet debounced)
+    };
+    Kind kind;
+    int8_t delta;
+    unsigned long ms; // millis() when it happened
+};
+
+// Speed-dependent scaling of rotation. A step (one user-level count) taken slow_ms or more
+// after the previous one counts once; one taken fast_ms or less after counts max_multiplier
+// times, ramping linearly in between. Reversing direction always counts once.
+struct KnobAcceleration {
+    uint16_t slow_ms;
+    uint16_t fast_ms;
+    uint8_t max_multiplier;
+};
+
 using knobChangeHandler = std::function<void(Knob&, int, int)>;
 using knobPressHandler = std::function<void(Knob&, bool)>;
 
@@ -19,6 +56,9 @@ class Knob {
             DOUBLE = 2,
             QUAD = 4,
         };
+        static constexpr KnobAcceleration NO_ACCELERATION = {0, 0, 1};
+        // Suits menus: about 8 steps per detent when spun quickly.
+        static constexpr KnobAcceleration MENU_ACCELERATION = {120, 15, 8};
         enum PinMode {
             NOPULLUP,
             PULLUP,
@@ -32,58 +72,36 @@ class Knob {
         const int clk;
         const int dt;
         const int sw;
+#ifdef ARDUINO_ARCH_SAMD
+        // PORT IN registers and bit masks of the encoder pins, looked up once so the interrupt
+        // handler can sample without the pin map. Both pins in one load when they share a port.
+        const volatile uint32_t *const clk_in;
+        const volatile uint32_t *const dt_in;
+        const uint32_t clk_mask;
+        const uint32_t dt_mask;
+#endif
 
-        // States of the pushbutton debounce handling.
-        enum SwitchState {            // --PENDING- I
-                                    // ON OFF TIM M T CONDITION   HH TRANSITION TARGET
-                                    // == === === = = ==========  == =========================
-        IDLE,                       //  -  -   -  I T       ON    -- => PRESSED_DEBOUNCE
-        PRESSED_DEBOUNCE,           //  1  -   1  I - TIME, ON    -- => PRESSED
-                                    //            I T TIME, OFF   -- => PRESSED_RELEASED_DEBOUNCE
-        PRESSED,                    //  1  -   -  M -       ON    P- => PRESSED_HANDLED
-                                    //            M T       OFF   P- => HANDLED_RELEASED_DEBOUNCE
-                                    //            I T       OFF   -- => PRESSED_RELEASED_DEBOUNCE
-        PRESSED_HANDLED,            //  -  -   -  I T       OFF   -- => HANDLED_RELEASED_DEBOUNCE
-        HANDLED_RELEASED_DEBOUNCE,  //  -  1   1  I - TIME, OFF   -- => RELEASED
-                                    //            I T TIME, ON    -- => RELEASED_PRESSED_DEBOUNCE
-        RELEASED,                   //  -  1   -  M T       ON    R- => PRESSED_DEBOUNCE
-                                    //            M -       OFF   R- => IDLE
-                                    //            I T       ON    -- => RELEASED_PRESSED_DEBOUNCE
-        RELEASED_PRESSED_DEBOUNCE,  //  1   1  1  M -       -     R- -> PRESSED_DEBOUNCE
-                                    //            I - TIME  -     -- => RELEASED_PRESSED
-        RELEASED_PRESSED,           //  1   1  -  M -       -     RP => PRESSED => PRESSED_HANDLED *
-        PRESSED_RELEASED_DEBOUNCE,  //  1   1  1  M -       -     P- => HANDLED_RELEASED_DEBOUNCE
-                                    //            I - TIME  -     -- => PRESSED_RELEASED
-        PRESSED_RELEASED            //  1   1  -  M -       ON    PR => PRESSED_HANDLED => IDLE *
-        // PENDING columns:
-        //   ON  -- pressed event pending
-        //   OFF -- released event pending
-        //   TIM -- Timeout pending
-        // I/M column
-        //   I -- Can happen at Interrupt or Main level
-        //   M -- Only at Main level
-        // T column (Set Timer)
-        //   T if timer should be set taking this transition
-        // CONDITION column (all must be satisfied to transition)
-        //   ON   -- Switch state is on
-        //   OFF  -- Switch state is off
-        //   TIME -- Timeout expired
-        // HH: handler calls
-        //   P -- on_press
-        //   R -- on_release
-        //   * Two handler calls result in an immediate double transition.
-        // The interrupt handler is a partial state machine, omitting the transitions that can
-        // only be taken by the main level (i.e. by calling the handler).
-        };
         // State
-        volatile int32_t count = 0;
+        // The count and the debounced switch are only touched at the main level. The interrupt
+        // handlers just sample the pins and queue what they saw, so read() never has to lock them out.
+        int32_t count = 0;
         int32_t previous_count = 0;
-        // State of the rotatry encoder
+        // State of the rotatry encoder (previous pin levels); owned by whoever samples the pins.
         volatile uint16_t state = 0;
-        volatile unsigned long rotate_millis = 0;
-        // State of the pushbutton switch
-        volatile SwitchState sw_state = IDLE;
-        volatile unsigned long sw_state_ms = 0;
+        unsigned long rotate_millis = 0;
+        // State of the pushbutton switch. Debouncing is leading-edge: a change is reported at
+        // once, and further changes are held off for debounce_ms, then the settled level wins.
+        bool sw_down = false;          // Reported (debounced) state
+        bool sw_level = false;         // Latest raw state seen
+        unsigned long sw_changed_ms = 0;
+        // Between start() and the pins settling: their last levels, when they last changed,
+        // and when start() was called.
+        bool settled = true;
+        uint8_t settle_levels = 0;
+        unsigned long settle_ms = 0;
+        unsigned long start_ms = 0;
+        // Events from the interrupt handlers, drained by read().
+        EventRing<KnobEvent, KNOB_EVENT_RING_SIZE> events;
         // Sequential index of knobs.
         static unsigned int next_idx;
         // Index of this knob
@@ -98,20 +116,42 @@ class Knob {
         int32_t max_count = NO_MAXIMUM;
         bool wrap = false;
         Precision count_precision = QUAD;
+        // Acceleration, and the time and direction of the last user-level step.
+        KnobAcceleration accel = NO_ACCELERATION;
+        unsigned long step_millis = 0;
+        int8_t step_dir = 0;
 
         // Callbacks
         knobPressHandler on_press;
         knobPressHandler on_release;
         knobChangeHandler on_change;
 
-        // AttachInterrupt but accepts closures, etc.
-        static void localAttachInterrupt(int pin, ISR fn, int mode);
-        // Update the quadrature state and count.
+        // AttachInterrupt, if there is a function to attach.
+        static void localAttachInterrupt(int pin, callbackFn fn, int mode);
+        // Read both encoder pins, as bit 3 (clk) and bit 2 (dt).
+        inline uint8_t samplePins() const;
+        // Sample the encoder pins; returns the change in count since the last sample.
+        int8_t sampleCount();
+        // Interrupt level: sample the encoder and queue the change.
         void updateCount();
-        // Update the switch state (debounce, etc.)
+        // Interrupt level: sample the switch and queue the change.
         void updateSwitch();
+        // Main level: apply a change in count or a raw switch level seen at time ms.
+        void applyCount(int8_t delta, unsigned long ms);
+        void applySwitch(bool pressed, unsigned long ms);
+        // Main level: how many steps a step in direction dir at time ms counts for.
+        int32_t stepMultiplier(int8_t dir, unsigned long ms);
+        // Main level: report the switch once it has settled at a new level.
+        void settleSwitch(unsigned long now);
+        void setSwitch(bool pressed, unsigned long ms);
+        // Main level: apply everything the interrupt handlers have queued.
+        void drain();
         // Determine which pins support interrupts.
         static int calculateInterrupts(int pin1, int pin2, int sw);
+        // Main level, until settled: watch the pins, and take their levels and attach the
+        // interrupt handlers once they hold still.
+        void settle(unsigned long now);
+        uint8_t pinLevels() const;
 
         // Constrain the count to be within the range.
         void constrainCount();
@@ -120,10 +160,13 @@ class Knob {
 
     public:
         Knob(const char *name, int clk, int dt, int sw = -1);
-        // Called during setup()
+        // Called during setup(). Returns at once; the knob is read once its pins have settled.
         void start(PinMode mode1 = NOPULLUP, PinMode mode2 = NOPULLUP, PinMode modeSw = NOPULLUP);
+        // Whether the pins have settled since start(), so turns and presses are seen.
+        inline bool ready() const { return settled; }
         int read();
         inline void poll() { read(); }
+        // Move to step c, kept within the range. Ignored while the knob is being turned.
         void write(int c);
         Knob &minCount(int c = NO_MINIMUM);
         Knob &maxCount(int c = NO_MAXIMUM);
@@ -142,6 +185,11 @@ class Knob {
         Knob &precision(Precision p);
         Precision getPrecision() const;
 
+        // Scale rotation by speed. Steps are counted in whole user-level units, so precision
+        // and the range (including wrapping) apply as usual.
+        Knob &acceleration(const KnobAcceleration &curve = MENU_ACCELERATION);
+        const KnobAcceleration &getAcceleration() const;
+
         const char * getName() const;
         Knob &name(const char *newName);
 
@@ -161,6 +209,11 @@ class Knob {
         return *this;
         }
 
+        // Events dropped because read() did not keep up with the interrupt handlers.
+        inline uint32_t overflows() const {
+            return events.overflows();
+        }
+
 #ifdef KNOB_TRACE
     const char *switchState();
 #endif
@@ -5,14 +5,11 @@
 #include "Menu.h"
 
 template<class T>
-Menu<T>::Menu(uint8_t count, const char * const *items): Menu(count, 0, items) {}
-
-template<class T>
-Menu<T>::Menu(uint8_t count, uint8_t selection, const char* const*items): count(count), items(items), selection(selection) {
+Menu<T>::Menu(const NamePool &items, uint16_t selection): count(items.count), items(items), selection(selection) {
 }
 
 template<class T>
-Menu<T> &Menu<T>::select(uint8_t i) {
+Menu<T> &Menu<T>::select(uint16_t i) {
     if (i < count) {
         selection = i;
     } else {
@@ -22,40 +19,102 @@ Menu<T> &Menu<T>::select(uint8_t i) {
 }
 
 template<class T>
-void Menu<T>::draw(T &display) {
-    auto first = wrap_items
-        ? selection - 1
-        : selection == 0
-            ? 0
-            : selection == count - 1
-                ? count < 4
-                ? 0
-                : selection - 2
-            : selection - 1;
-    auto selected = wrap_items
-        ? count > 1
-            ? 1 : 0
-        : selection == 0
-            ? 0
-            : selection == count - 1
-            ? 2 : 1;
-    auto show = [this, &display, first, selected](uint8_t i) {
-        auto idx = first + i;
-        auto item = idx < 0
-            ? items[count + idx]
-            : idx >= count
-            ? items[idx - count]
-            : items[idx];
-        if (i == selected) {
-            display.invertColors();
-            display.printFixed(left, top + i * 16, "> ", STYLE_NORMAL);
-            display.printFixed(left + 12, top + i * 16, item, STYLE_BOLD);
-            display.invertColors();
-        } else {
-            display.printFixed(left, top + i * 16, item, STYLE_NORMAL);
+Menu<T> &Menu<T>::setItems(const NamePool &newItems) {
+    count = newItems.count;
+    items = newItems;
+    if (selection >= count) {
+        selection = count ? count - 1 : 0;
+    }
+    return invalidate();
+}
+
+template<class T>
+void Menu<T>::drawRow(T &display, uint8_t row, uint16_t idx, bool selected) {
+    auto y = top + row * row_height;
+    display.invertColors();
+    display.fillRect(left, y, left + width - 1, y + row_height - 1);
+    display.invertColors();
+    if (selected) {
+        display.invertColors();
+        display.printFixed(left, y, "> ", STYLE_NORMAL);
+        display.printFixed(left + 12, y, item(idx), STYLE_BOLD);
+        display.invertColors();
+    } else {
+        display.printFixed(left, y, item(idx), STYLE_NORMAL);
+    }
+}
+
+// Draw every row, with the selection in the middle row unless at an end of an unwrapped list.
+template<class T>
+void Menu<T>::drawAll(T &display) {
+    auto n = shown();
+    int first = selection - (n > 1 ? 1 : 0);
+    if (wrap_items) {
+        first = (first + count) % count;
+    } else {
+        first = first < 0 ? 0 : first > count - n ? count - n : first;
+    }
+    for (uint8_t row = 0; row < n; row++) {
+        auto idx = (first + row) % count;
+        drawRow(display, row, idx, idx == selection);
+    }
+    drawn = true;
+    drawn_first = first;
+    drawn_selection = selection;
+    scrolling = 0;
+}
+
+template<class T>
+bool Menu<T>::draw(T &display) {
+    if (!incremental_draw || !drawn) {
+        drawAll(display);
+        return false;
+    }
+    auto n = shown();
+    if (scrolling) {
+        if (selection != drawn_selection) {
+            // Moved again before the scroll finished.
+            drawAll(display);
+            return false;
+        }
+        int8_t step = scrolling > 0 ? scrolling : -scrolling;
+        if (scroll_step && scroll_step < step) {
+            step = scroll_step;
         }
-    };
-    show(0);
-    show(1);
-    show(2);
+        int8_t dy = scrolling > 0 ? step : -step;
+        display.scroll(left, top, left + width - 1, top + n * row_height - 1, dy);
+        scrolling -= dy;
+        if (scrolling) {
+            return true;
+        }
+        drawRow(display, dy > 0 ? 0 : n - 1, selection, true);
+        return false;
+    }
+    if (selection == drawn_selection) {
+        return false;
+    }
+    uint16_t old_row = (drawn_selection - drawn_first + count) % count;
+    int pos = wrap_items ? (selection - drawn_first + count) % count : selection - drawn_first;
+    if (pos >= 0 && pos < n) {
+        drawRow(display, old_row, drawn_selection, false);
+        drawRow(display, pos, selection, true);
+        drawn_selection = selection;
+        return false;
+    }
+    // One step past the first or last row scrolls; anything further redraws.
+    int8_t dir = 0;
+    if (old_row == n - 1 && pos == n) {
+        dir = -1;
+    } else if (old_row == 0 && (pos == -1 || (wrap_items && pos == count - 1))) {
+        dir = 1;
+    }
+    if (!dir) {
+        drawAll(display);
+        return false;
+    }
+    drawRow(display, old_row, drawn_selection, false);
+    drawn_first = (drawn_first - dir + count) % count;
+    drawn_selection = selection;
+    scrolling = dir * row_height;
+    return draw(display);
 }
@@ -5,32 +5,96 @@
 #pragma once
 
 #include "lcdgfx.h"
+#include "NamePool.h"
 
+/**
+ * A list to choose from with a knob, shown a few rows at a time. Drawing reads just the rows
+ * shown, and moving the selection is a store, so neither costs more for a longer list.
+ */
 template<class T>
 class Menu {
-    public:
-        const uint8_t count;
     private:
-        const char * const * items;
-        uint8_t selection;
+        uint16_t count;
+        NamePool items;
+        uint16_t selection;
         bool wrap_items = false;;
         static const uint8_t top = 0;
         static const uint8_t left = 0;
         static const uint8_t width = 128;
         static const uint8_t height = 64 - top;
+        static const uint8_t rows = 3;
+        static const uint8_t row_height = 16;
+        // Incremental drawing: what the rows show as of the last draw(), and any scroll
+        // still to be animated.
+        bool incremental_draw = false;
+        uint8_t scroll_step = 0;
+        bool drawn = false;
+        uint16_t drawn_first = 0;
+        uint16_t drawn_selection = 0;
+        int8_t scrolling = 0;
+        inline uint8_t shown() const {
+            return count < rows ? count : rows;
+        }
+        void drawRow(T &display, uint8_t row, uint16_t idx, bool selected);
+        void drawAll(T &display);
     public:
-        Menu(uint8_t count, const char * const *items);
-        Menu(uint8_t count, uint8_t selection, const char* const*items);
-        Menu &select(uint8_t i);
-        void draw(T &display);
+        Menu(const NamePool &items, uint16_t selection = 0);
+        Menu &select(uint16_t i);
+        /**
+         * Replace the items. The selection is kept if it is still in range, and the next
+         * draw() draws everything. The names are not copied.
+         */
+        Menu &setItems(const NamePool &items);
+        /**
+         * Draw the menu. In incremental mode, this draws only what changed since the last
+         * draw(): a move within the rows redraws the two rows whose highlight changed, and a
+         * move past the first or last row scrolls the others and draws the one uncovered.
+         * @returns true if a scroll is still being animated, and draw() should be called again.
+         */
+        bool draw(T &display);
         inline Menu &wrap(bool wrapItems = true) {
             wrap_items = wrapItems;
+            drawn = false;
+            return *this;
+        }
+        /**
+         * Draw incrementally, keeping the rows in place and moving the highlight until the
+         * selection leaves them. The rows must still show what draw() last drew; after
+         * anything else draws there, call invalidate().
+         */
+        inline Menu &incremental(bool on = true) {
+            incremental_draw = on;
+            drawn = false;
             return *this;
         }
-        inline uint8_t size() const {
+        /**
+         * Animate scrolls, moving the rows step pixels per draw(). 0 scrolls a whole row at once.
+         */
+        inline Menu &smooth(uint8_t step) {
+            scroll_step = step;
+            return *this;
+        }
+        /**
+         * Make the next draw() draw everything.
+         */
+        inline Menu &invalidate() {
+            drawn = false;
+            scrolling = 0;
+            return *this;
+        }
+        inline uint16_t size() const {
             return count;
         }
-        inline const char *item(uint8_t idx) const {
-            return items[idx];
+        inline const char *item(uint16_t idx) const {
+            return items.item(idx);
+        }
+        /**
+         * What to send to select an item.
+         */
+        inline Patch patch(uint16_t idx) const {
+            return items.patch(idx);
+        }
+        inline int32_t find(uint8_t msb, uint8_t lsb, uint8_t program) const {
+            return items.find(msb, lsb, program);
         }
 };
@@ -0,0 +1,66 @@
+/**
+ * @copyright Copyright (c) 2021 Bob Kerns
+ * License: MIT
+ */
+// A list of names packed into one block of characters, found through a table of offsets.
+#pragma once
+#include <stdint.h>
+
+/**
+ * Where an entry is on the synth: a program, and for a list with banks, the bank select
+ * MSB and LSB (CC 0 and CC 32) to send before it.
+ */
+struct Patch {
+    bool banked;
+    uint8_t msb;
+    uint8_t lsb;
+    uint8_t program;
+};
+
+/**
+ * Names, each a NUL-terminated string within names, found by a 16-bit offset: two bytes per
+ * name in place of a pointer, and no more than a name's characters and its terminator.
+ * Names that are identical, or the end of another name, are stored once.
+ *
+ * Without patches, an entry's index is its program number. With them, each entry has three
+ * bytes there, MSB, LSB and program, so a list can span banks and hold thousands of entries.
+ *
+ * The names are used where they lie, in flash for the generated lists, so item() is one load
+ * and the string it returns stays valid as long as the pool does. See tools/patchlists.py.
+ */
+struct NamePool {
+    uint16_t count;
+    const uint16_t *offsets;
+    const char *names;
+    const uint8_t *patches = nullptr;
+
+    inline const char *item(uint16_t i) const {
+        return names + offsets[i];
+    }
+
+    inline Patch patch(uint16_t i) const {
+        if (patches) {
+            auto p = patches + 3 * i;
+            return {true, p[0], p[1], p[2]};
+        }
+        return {false, 0, 0, static_cast<uint8_t>(i & 0x7f)};
+    }
+
+    /**
+     * The entry for a program in a bank, ignoring the bank in a list without banks.
+     * With banks, this searches the list, so it is for incoming program changes, not navigation.
+     * @returns -1 if there is none.
+     */
+    int32_t find(uint8_t msb, uint8_t lsb, uint8_t program) const {
+        if (!patches) {
+            return program < count ? program : -1;
+        }
+        for (uint16_t i = 0; i < count; i++) {
+            auto p = patches + 3 * i;
+            if (p[2] == program && p[0] == msb && p[1] == lsb) {
+                return i;
+            }
+        }
+        return -1;
+    }
+};
@@ -0,0 +1,28 @@
+/**
+ * @copyright Copyright (c) 2021 Bob Kerns
+ * License: MIT
+ */
+#include "NameTable.h"
+
+void NameTable::clear() {
+    m_used = m_start = 0;
+    m_count = 0;
+    m_full = false;
+}
+
+bool NameTable::add(char c) {
+    if (m_full) {
+        return false;
+    }
+    // Leave room to end the name, and for its entry.
+    if (m_used + (c ? 2 : 1) > MENU_NAME_POOL || (m_used == m_start && m_count == MENU_MAX_ITEMS)) {
+        m_full = true;
+        return false;
+    }
+    m_names[m_used++] = c;
+    if (!c) {
+        m_offsets[m_count++] = m_start;
+        m_start = m_used;
+    }
+    return true;
+}
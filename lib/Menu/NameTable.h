@@ -0,0 +1,55 @@
+/**
+ * @copyright Copyright (c) 2021 Bob Kerns
+ * License: MIT
+ */
+// Menu items held in RAM, for menus replaced while running.
+#pragma once
+#include <stddef.h>
+#include <stdint.h>
+#include "NamePool.h"
+
+// Bytes of names, including their terminators, one table can hold.
+#ifndef MENU_NAME_POOL
+#define MENU_NAME_POOL 384
+#endif
+
+// Items one table can hold.
+#ifndef MENU_MAX_ITEMS
+#define MENU_MAX_ITEMS 48
+#endif
+
+/**
+ * A NamePool in RAM, built a character at a time as the names arrive.
+ */
+class NameTable {
+    public:
+        void clear();
+
+        /**
+         * Append a character to the name being built; 0 ends it.
+         * @returns false if the table is full. It then stays full until cleared.
+         */
+        bool add(char c);
+
+        /**
+         * End the name being built, if any.
+         * @returns false if the table is full.
+         */
+        bool finish() { return m_used == m_start || add(0); }
+
+        bool full() const { return m_full; }
+        uint8_t count() const { return m_count; }
+
+        /**
+         * The names, valid until the table is next changed.
+         */
+        NamePool pool() const { return {m_count, m_offsets, m_names}; }
+
+    private:
+        char m_names[MENU_NAME_POOL];
+        uint16_t m_offsets[MENU_MAX_ITEMS];
+        uint16_t m_used = 0;
+        uint16_t m_start = 0; ///< where the name being built begins
+        uint8_t m_count = 0;
+        bool m_full = false;
+};
@@ -0,0 +1,53 @@
+/**
+ * @copyright Copyright (c) 2021 Bob Kerns
+ * License: MIT
+ */
+#include "MidiClock.h"
+#include <algorithm>
+
+uint32_t MidiClock::tempo() const {
+    uint8_t stamps = std::min<uint8_t>(m_count, WINDOW + 1);
+    if (stamps < MIN_INTERVALS + 1) {
+        return 0;
+    }
+    uint8_t n = stamps - 1;
+    uint8_t first = m_count - stamps;
+    uint32_t intervals[WINDOW];
+    uint32_t sorted[WINDOW];
+    for (uint8_t i = 0; i < n; i++) {
+        intervals[i] = sorted[i] = m_stamps[(first + i + 1) & MASK] - m_stamps[(first + i) & MASK];
+    }
+    std::nth_element(sorted, sorted + n / 2, sorted + n);
+    auto median = sorted[n / 2];
+    if (!median) {
+        return 0;
+    }
+    // Fit arrival = start + period * tick, numbering the ticks by how many medians apart they
+    // are. Jitter can stretch one interval to half as long again as the median and squeeze the
+    // next to half, so a gap counts as a lost tick only from 1.75 medians, and any gap counts
+    // for at least one tick; but a tick within a quarter of a median of the last is taken for a
+    // duplicate, and left out of the fit.
+    int64_t sx = 0, sy = 0, sxx = 0, sxy = 0;
+    int64_t points = 1; // the first tick, at (0, 0)
+    uint32_t x = 0, y = 0;
+    for (uint8_t i = 0; i < n; i++) {
+        y += intervals[i];
+        if (intervals[i] < median / 4) {
+            continue;
+        }
+        auto ticks = std::max<uint32_t>(1, (intervals[i] + median / 4) / median);
+        x += ticks;
+        sx += x;
+        sy += y;
+        sxx += (int64_t)x * x;
+        sxy += (int64_t)x * y;
+        points++;
+    }
+    auto den = points * sxx - sx * sx;
+    auto num = points * sxy - sx * sy; // the period in microseconds, times den
+    if (den <= 0 || num <= 0) {
+        return 0;
+    }
+    // Hundredths of a beat per minute: 100 * 60e6 / (period * PPQN).
+    return (6000000000LL / PPQN * den + num / 2) / num;
+}
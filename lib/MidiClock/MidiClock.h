@@ -0,0 +1,94 @@
+/**
+ * @copyright Copyright (c) 2021 Bob Kerns
+ * License: MIT
+ */
+// Following the MIDI clock: tempo, transport, and song position.
+#pragma once
+#include <stdint.h>
+
+// A gap between ticks longer than this, in milliseconds, means the clock stopped; the tempo
+// is then forgotten, and measured afresh when ticks resume.
+#ifndef MIDI_CLOCK_TIMEOUT_MS
+#define MIDI_CLOCK_TIMEOUT_MS 500
+#endif
+
+/**
+ * Tracks the real-time messages of a MIDI clock source.
+ *
+ * tick() only records when the tick arrived, so it costs the same at any tempo. The tempo is
+ * worked out from the recorded times when asked for, which need be no oftener than it is shown.
+ * It is a least-squares fit over the last two beats of ticks, with each tick placed by the median
+ * interval: a tick lost or doubled on the way shifts the fit by a tick, rather than skewing it,
+ * and the jitter of individual ticks mostly averages out.
+ */
+class MidiClock {
+    public:
+        static const uint8_t PPQN = 24; ///< ticks per quarter note
+        static const uint8_t TICKS_PER_STEP = 6; ///< ticks per sixteenth, the unit of song position
+        static const uint8_t WINDOW = 2 * PPQN; ///< intervals the tempo is measured over
+        static const uint8_t MIN_INTERVALS = PPQN / 4; ///< intervals needed before there is a tempo
+
+        /**
+         * A timing clock (0xF8) arrived at us microseconds.
+         */
+        void tick(uint32_t us) {
+            if (m_count && us - m_stamps[(m_count - 1) & MASK] > MIDI_CLOCK_TIMEOUT_MS * 1000) {
+                m_count = 0;
+            }
+            m_stamps[m_count++ & MASK] = us;
+            if (m_count == 2 * RING) {
+                m_count = RING; // keep the count bounded without losing the last RING stamps
+            }
+            if (m_running) {
+                m_position++;
+            }
+        }
+
+        /**
+         * Start (0xFA): play from the top of the song.
+         */
+        void start() { m_position = 0; m_running = true; }
+
+        /**
+         * Continue (0xFB): play on from the current position.
+         */
+        void resume() { m_running = true; }
+
+        /**
+         * Stop (0xFC). The position stays put, for a continue or a new song position.
+         */
+        void stop() { m_running = false; }
+
+        /**
+         * Song Position Pointer (0xF2), in sixteenths since the top of the song.
+         */
+        void songPosition(uint16_t sixteenths) { m_position = (uint32_t)sixteenths * TICKS_PER_STEP; }
+
+        bool running() const { return m_running; }
+
+        /**
+         * Ticks played since the top of the song.
+         */
+        uint32_t position() const { return m_position; }
+
+        /**
+         * Whether a tick has arrived within MIDI_CLOCK_TIMEOUT_MS before now, in microseconds.
+         */
+        bool receiving(uint32_t now) const {
+            return m_count && now - m_stamps[(m_count - 1) & MASK] <= MIDI_CLOCK_TIMEOUT_MS * 1000;
+        }
+
+        /**
+         * The tempo, in hundredths of a beat per minute, or 0 until enough ticks have arrived.
+         */
+        uint32_t tempo() const;
+
+    private:
+        static const uint8_t RING = 64; ///< power of two, more than WINDOW
+        static const uint8_t MASK = RING - 1;
+        static_assert(RING > WINDOW, "MidiClock ring must hold a window of intervals");
+        uint32_t m_stamps[RING]; ///< arrival of each tick, in microseconds
+        uint8_t m_count = 0; ///< ticks recorded since the clock last started
+        bool m_running = false;
+        uint32_t m_position = 0;
+};
@@ -0,0 +1,23 @@
+/**
+ * @copyright Copyright (c) 2021 Bob Kerns
+ * License: MIT
+ */
+// Generated by tools/patchlists.py from patches/kits.csv, patches/programs.csv. Do not edit.
+#include <Arduino.h>
+#include "Patches.h"
+
+static const char names[] PROGMEM =
+    "Orch+Piano\0" "Percussion\0" "Tuned Perc\0" "Orchestra\0" "Orch+Pad\0" "Strings\0"
+    "Flutes\0" "Solo 1\0" "Solo 2\0" "Solo 3\0" "Solo 4\0" "Brass\0" "Lead\0" "Reed\0" "C#4\0"
+    "F#4\0" "Off\0" "C4\0" "E4\0" "F4\0" "FX\0" "B\0";
+
+static const uint16_t kits_offsets[] PROGMEM = {
+    11, 22, 126, 129, 115, 67, 74, 81, 88, 132
+};
+const NamePool kits = {10, kits_offsets, names};
+
+static const uint16_t programs_offsets[] PROGMEM = {
+    119, 101, 5, 0, 33, 43, 48, 106, 60, 95, 52, 135, 123, 111, 11, 22,
+    126, 129, 115, 67, 74, 81, 88, 132
+};
+const NamePool programs = {24, programs_offsets, names};
@@ -0,0 +1,12 @@
+/**
+ * @copyright Copyright (c) 2021 Bob Kerns
+ * License: MIT
+ */
+// Generated by tools/patchlists.py from patches/kits.csv, patches/programs.csv. Do not edit.
+#pragma once
+#include <NamePool.h>
+
+// 10 names, from kits.csv.
+extern const NamePool kits;
+// 24 names, from programs.csv.
+extern const NamePool programs;
@@ -0,0 +1,34 @@
+/**
+ * @copyright Copyright (c) 2021 Bob Kerns
+ * License: MIT
+ */
+// The flash set aside for presets, as the SAMD21's NVM controller sees it: erased a row at a
+// time, to all ones, and written a page at a time. Writes and erases are started here and
+// run on their own; check busy() before starting the next.
+#pragma once
+#include <stddef.h>
+#include <stdint.h>
+
+#ifndef PRESET_FLASH_ROWS
+#define PRESET_FLASH_ROWS 4
+#endif
+
+namespace flash {
+    const size_t PAGE_SIZE = 64;
+    const size_t ROW_PAGES = 4;
+    const size_t ROW_SIZE = PAGE_SIZE * ROW_PAGES;
+    const size_t ROWS = PRESET_FLASH_ROWS;
+    const size_t PAGES = ROWS * ROW_PAGES;
+
+    // Whether an erase or write is still in progress.
+    bool busy();
+
+    // Copy len bytes from the start of a page.
+    void read(size_t page, void *data, size_t len);
+
+    // Start erasing a row.
+    void erase(size_t row);
+
+    // Start writing PAGE_SIZE bytes to an erased page.
+    void write(size_t page, const void *data);
+}
@@ -0,0 +1,53 @@
+/**
+ * @copyright Copyright (c) 2021 Bob Kerns
+ * License: MIT
+ */
+// The preset flash on the SAMD21, kept in an array in the program's own flash. Uploading new
+// firmware clears it, since the array is part of the image.
+#ifdef ARDUINO_ARCH_SAMD
+#include <Arduino.h>
+#include <string.h>
+#include "Flash.h"
+
+namespace {
+    // Row-aligned so erasing a row touches nothing else.
+    __attribute__((__aligned__(flash::ROW_SIZE)))
+    const volatile uint8_t area[flash::ROWS * flash::ROW_SIZE] = {};
+
+    inline void command(uint32_t address, uint32_t cmd) {
+        // ADDR is in 16-bit words.
+        NVMCTRL->ADDR.reg = address / 2;
+        NVMCTRL->CTRLA.reg = NVMCTRL_CTRLA_CMDEX_KEY | cmd;
+    }
+}
+
+bool flash::busy() {
+    return !NVMCTRL->INTFLAG.bit.READY;
+}
+
+void flash::read(size_t page, void *data, size_t len) {
+    auto src = area + page * PAGE_SIZE;
+    auto dst = static_cast<uint8_t *>(data);
+    for (size_t i = 0; i < len; i++) {
+        dst[i] = src[i];
+    }
+}
+
+void flash::erase(size_t row) {
+    command(reinterpret_cast<uint32_t>(area + row * ROW_SIZE), NVMCTRL_CTRLA_CMD_ER);
+}
+
+void flash::write(size_t page, const void *data) {
+    auto dst = reinterpret_cast<volatile uint32_t *>(const_cast<uint8_t *>(area + page * PAGE_SIZE));
+    // Manual write: fill the page buffer, then commit it with one command.
+    NVMCTRL->CTRLB.bit.MANW = 1;
+    command(reinterpret_cast<uint32_t>(dst), NVMCTRL_CTRLA_CMD_PBC);
+    while (busy()) {}
+    uint32_t word;
+    for (size_t i = 0; i < PAGE_SIZE / 4; i++) {
+        memcpy(&word, static_cast<const uint8_t *>(data) + i * 4, 4);
+        dst[i] = word;
+    }
+    command(reinterpret_cast<uint32_t>(dst), NVMCTRL_CTRLA_CMD_WP);
+}
+#endif
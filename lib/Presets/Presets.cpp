@@ -0,0 +1,120 @@
+/**
+ * @copyright Copyright (c) 2021 Bob Kerns
+ * License: MIT
+ */
+#include "Presets.h"
+#include <stddef.h>
+#include <string.h>
+
+PresetStore presets;
+
+// How soon to look again while flash is busy, in milliseconds.
+static const uint32_t busy_retry = 1;
+
+// CRC-32 (IEEE), a nibble at a time to keep the table small.
+uint32_t PresetStore::crc(const Record &record) {
+    static const uint32_t table[16] = {
+        0x00000000, 0x1db71064, 0x3b6e20c8, 0x26d930ac, 0x76dc4190, 0x6b6b51f4, 0x4db26158, 0x5005713c,
+        0xedb88320, 0xf00f9344, 0xd6d6a3e8, 0xcb61b38c, 0x9b64c2b0, 0x86d3d2d4, 0xa00ae278, 0xbdbdf21c
+    };
+    auto bytes = reinterpret_cast<const uint8_t *>(&record);
+    uint32_t c = 0xffffffff;
+    for (size_t i = 0; i < offsetof(Record, crc); i++) {
+        c = table[(c ^ bytes[i]) & 0x0f] ^ (c >> 4);
+        c = table[(c ^ (bytes[i] >> 4)) & 0x0f] ^ (c >> 4);
+    }
+    return ~c;
+}
+
+bool PresetStore::blank(size_t page) {
+    uint8_t data[flash::PAGE_SIZE];
+    flash::read(page, data, sizeof(data));
+    for (auto b : data) {
+        if (b != 0xff) {
+            return false;
+        }
+    }
+    return true;
+}
+
+bool PresetStore::scan(Record &newest) {
+    bool found = false;
+    size_t newest_page = 0;
+    for (size_t page = 0; page < flash::PAGES; page++) {
+        Record record;
+        flash::read(page, &record, sizeof(record));
+        if (record.magic == MAGIC && record.crc == crc(record)
+            && (!found || (int32_t)(record.sequence - newest.sequence) > 0)) {
+            newest = record;
+            newest_page = page;
+            found = true;
+        }
+    }
+    // Pages after the newest record in its row were erased with it; a new row is erased first.
+    next_page = found ? (newest_page + 1) % flash::PAGES : 0;
+    sequence = found ? newest.sequence + 1 : 0;
+    scanned = true;
+    return found;
+}
+
+bool PresetStore::restore(Preset &preset) {
+    Record newest;
+    if (!scan(newest)) {
+        return false;
+    }
+    preset = newest.preset;
+    return true;
+}
+
+void PresetStore::save(const Preset &preset) {
+    queued = preset;
+    if (state == IDLE) {
+        if (!scanned) {
+            Record newest;
+            scan(newest);
+        }
+        // A page left part-written by a reset cannot be written again until its row is erased,
+        // so skip to the next row.
+        if (next_page % flash::ROW_PAGES != 0 && !blank(next_page)) {
+            next_page = (next_page / flash::ROW_PAGES + 1) * flash::ROW_PAGES % flash::PAGES;
+        }
+        state = next_page % flash::ROW_PAGES == 0 ? ERASE : WRITE;
+        scheduler.scheduleIn(step_timer, 0);
+    }
+}
+
+void PresetStore::step(void *store) {
+    static_cast<PresetStore *>(store)->step();
+}
+
+void PresetStore::step() {
+    if (flash::busy()) {
+        scheduler.scheduleIn(step_timer, busy_retry);
+        return;
+    }
+    switch (state) {
+        case ERASE:
+            flash::erase(next_page / flash::ROW_PAGES);
+            state = WRITE;
+            scheduler.scheduleIn(step_timer, busy_retry);
+            break;
+        case WRITE: {
+            uint8_t page[flash::PAGE_SIZE];
+            memset(page, 0xff, sizeof(page));
+            Record record;
+            memset(&record, 0, sizeof(record));
+            record.magic = MAGIC;
+            record.sequence = sequence++;
+            record.preset = queued;
+            record.crc = crc(record);
+            memcpy(page, &record, sizeof(record));
+            flash::write(next_page, page);
+            next_page = (next_page + 1) % flash::PAGES;
+            written++;
+            state = IDLE;
+            break;
+        }
+        case IDLE:
+            break;
+    }
+}
@@ -0,0 +1,84 @@
+/**
+ * @copyright Copyright (c) 2021 Bob Kerns
+ * License: MIT
+ */
+// Presets kept in flash across power cycles.
+#pragma once
+#include <stdint.h>
+#include <Scheduler.h>
+#include "Flash.h"
+
+/**
+ * What is restored at power-up: each channel's program, as an entry in its menu, and which
+ * channels are off. The masks have one bit per channel, channel 1 in bit 0.
+ */
+struct Preset {
+    uint16_t program[16];
+    uint16_t known; ///< channels with a program worth restoring
+    uint16_t off;
+};
+
+/**
+ * A log of Preset records in flash, one per page, written round-robin through the rows so
+ * every row wears equally. Each record carries a sequence number and a CRC; the newest that
+ * checks out is the current preset, so a write cut short by power loss leaves the previous one.
+ *
+ * save() returns at once; the write is done from the scheduler in steps of one flash command,
+ * each started only once the last has finished, so loop() keeps servicing MIDI between them.
+ * While a command runs, code executing from flash stalls: about 6 ms for an erase, which
+ * happens once per ROW_PAGES saves, and 2.5 ms for a page write.
+ */
+class PresetStore {
+    public:
+        PresetStore(): step_timer(step, this) {}
+
+        /**
+         * Find the newest valid preset.
+         * @returns false if there is none.
+         */
+        bool restore(Preset &preset);
+
+        /**
+         * Queue preset to be written. A save queued while one is in progress replaces it.
+         */
+        void save(const Preset &preset);
+
+        /**
+         * Whether a save has yet to finish.
+         */
+        bool saving() const { return state != IDLE; }
+
+        /**
+         * Records written since boot.
+         */
+        uint32_t writes() const { return written; }
+
+    private:
+        static const uint16_t MAGIC = 0x5042; // changes with the layout of Preset
+        struct Record {
+            uint16_t magic;
+            uint16_t reserved;
+            uint32_t sequence;
+            Preset preset;
+            uint32_t crc;
+        };
+        static_assert(sizeof(Record) <= flash::PAGE_SIZE, "a record must fit in a page");
+
+        enum State: uint8_t {IDLE, ERASE, WRITE};
+        State state = IDLE;
+        bool scanned = false;
+        size_t next_page = 0;
+        uint32_t sequence = 0;
+        uint32_t written = 0;
+        Preset queued;
+        Timer step_timer;
+
+        static uint32_t crc(const Record &record);
+        static bool blank(size_t page);
+        // Find the newest record, and where the next goes.
+        bool scan(Record &newest);
+        static void step(void *store);
+        void step();
+};
+
+extern PresetStore presets;
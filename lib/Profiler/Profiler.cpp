@@ -0,0 +1,27 @@
+/**
+ * @copyright Copyright (c) 2021 Bob Kerns
+ * License: MIT
+ */
+#include "Profiler.h"
+
+void StageStats::reset() {
+    *this = StageStats();
+}
+
+uint32_t StageStats::percentile(uint8_t pct) const {
+    if (!n) {
+        return 0;
+    }
+    // Rank of the sample we want, counting from 1.
+    uint32_t rank = (static_cast<uint64_t>(n) * pct + 99) / 100;
+    if (rank < 1) rank = 1;
+    uint32_t seen = 0;
+    for (uint8_t b = 0; b < BUCKETS; b++) {
+        seen += buckets[b];
+        if (seen >= rank) {
+            uint32_t upper = b ? (b < BUCKETS - 1 ? (1ul << b) - 1 : hi) : 0;
+            return upper < lo ? lo : upper > hi ? hi : upper;
+        }
+    }
+    return hi;
+}
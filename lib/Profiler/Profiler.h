@@ -0,0 +1,55 @@
+/**
+ * @copyright Copyright (c) 2021 Bob Kerns
+ * License: MIT
+ */
+// Lightweight timing of program stages: scoped timers feeding log2-bucketed histograms
+// in static storage.
+#pragma once
+#include <Arduino.h>
+#include <stdint.h>
+
+// Durations of one stage, in microseconds.
+class StageStats {
+    public:
+        // Bucket 0 holds 0 us; bucket b holds [2^(b-1), 2^b) us; the last also holds anything longer.
+        static const uint8_t BUCKETS = 20;
+
+        void record(uint32_t us) {
+            uint8_t b = us ? 32 - __builtin_clz(us) : 0;
+            buckets[b < BUCKETS ? b : BUCKETS - 1]++;
+            n++;
+            if (us < lo) lo = us;
+            if (us > hi) hi = us;
+        }
+
+        void reset();
+
+        uint32_t count() const { return n; }
+        uint32_t min() const { return n ? lo : 0; }
+        uint32_t max() const { return hi; }
+        // The pct'th percentile, as the upper bound of its bucket, within [min, max].
+        uint32_t percentile(uint8_t pct) const;
+        uint32_t bucket(uint8_t b) const { return buckets[b]; }
+
+    private:
+        uint32_t n = 0;
+        uint32_t lo = UINT32_MAX;
+        uint32_t hi = 0;
+        uint32_t buckets[BUCKETS] = {};
+};
+
+// Records the time from construction to destruction.
+class ScopedTimer {
+    public:
+        explicit ScopedTimer(StageStats &stats): stats(stats), start(micros()) {}
+        ~ScopedTimer() {
+            stats.record(micros() - start);
+        }
+        ScopedTimer(const ScopedTimer &) = delete;
+        ScopedTimer &operator=(const ScopedTimer &) = delete;
+        // micros() when timing began.
+        uint32_t started() const { return start; }
+    private:
+        StageStats &stats;
+        const uint32_t start;
+};
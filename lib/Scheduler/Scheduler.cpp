@@ -0,0 +1,97 @@
+/**
+ * @copyright Copyright (c) 2021 Bob Kerns
+ * License: MIT
+ */
+#include <Arduino.h>
+#include "Scheduler.h"
+
+Scheduler scheduler;
+
+void Scheduler::place(uint8_t i, Timer *t) {
+    heap[i] = t;
+    t->slot = i;
+}
+
+void Scheduler::siftUp(uint8_t i) {
+    auto t = heap[i];
+    while (i > 0) {
+        uint8_t parent = (i - 1) / 2;
+        if (!before(t->due, heap[parent]->due)) {
+            break;
+        }
+        place(i, heap[parent]);
+        i = parent;
+    }
+    place(i, t);
+}
+
+void Scheduler::siftDown(uint8_t i) {
+    auto t = heap[i];
+    while (true) {
+        uint8_t child = 2 * i + 1;
+        if (child >= size) {
+            break;
+        }
+        if (child + 1 < size && before(heap[child + 1]->due, heap[child]->due)) {
+            child++;
+        }
+        if (!before(heap[child]->due, t->due)) {
+            break;
+        }
+        place(i, heap[child]);
+        i = child;
+    }
+    place(i, t);
+}
+
+// Take the timer at heap position i out of the heap.
+void Scheduler::remove(uint8_t i) {
+    heap[i]->slot = Timer::NONE;
+    if (i != --size) {
+        place(i, heap[size]);
+        siftDown(i);
+        siftUp(heap[i]->slot);
+    }
+}
+
+bool Scheduler::schedule(Timer &timer, uint32_t due) {
+    if (timer.pending()) {
+        timer.due = due;
+        siftDown(timer.slot);
+        siftUp(timer.slot);
+        return true;
+    }
+    if (size >= CAPACITY) {
+        return false;
+    }
+    timer.due = due;
+    place(size, &timer);
+    siftUp(size++);
+    return true;
+}
+
+bool Scheduler::scheduleIn(Timer &timer, uint32_t ms) {
+    return schedule(timer, millis() + ms);
+}
+
+void Scheduler::cancel(Timer &timer) {
+    if (timer.pending()) {
+        remove(timer.slot);
+    }
+}
+
+void Scheduler::service(uint32_t now) {
+    if (now - window_start >= 1000) {
+        per_second = window_count;
+        window_count = 0;
+        window_start = now;
+    }
+    while (size && !before(now, heap[0]->due)) {
+        auto t = heap[0];
+        remove(0);
+        total++;
+        window_count++;
+        // Unscheduled before running, so the timer may schedule itself again.
+        t->fn(t->context);
+    }
+}
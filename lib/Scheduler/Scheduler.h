@@ -0,0 +1,85 @@
+/**
+ * @copyright Copyright (c) 2021 Bob Kerns
+ * License: MIT
+ */
+// Deadline scheduler: one-shot timers kept in a fixed-size min-heap, so the main loop can
+// find out whether anything is due with a single comparison.
+#pragma once
+#include <stdint.h>
+
+// A timer takes one place however often it is rescheduled, so this need only be as many
+// timers as can be pending at once. AltoidMidi.cpp checks it against the firmware's timers.
+#ifndef SCHEDULER_CAPACITY
+#define SCHEDULER_CAPACITY 32
+#endif
+
+using timerFn = void(*)(void *context);
+
+// A one-shot timer. Owned by the client, which must keep it alive while it is scheduled.
+class Timer {
+    friend class Scheduler;
+    private:
+        timerFn fn;
+        void *context;
+        uint32_t due = 0;
+        // Position in the scheduler's heap, or NONE if not scheduled.
+        static const uint8_t NONE = 0xff;
+        uint8_t slot = NONE;
+    public:
+        Timer(timerFn fn, void *context = nullptr): fn(fn), context(context) {}
+        Timer(const Timer &) = delete;
+        Timer &operator=(const Timer &) = delete;
+        inline bool pending() const {
+            return slot != NONE;
+        }
+        // Time it is due, in millis(); meaningful only while pending.
+        inline uint32_t dueAt() const {
+            return due;
+        }
+};
+
+class Scheduler {
+    private:
+        static const uint8_t CAPACITY = SCHEDULER_CAPACITY;
+        static_assert(SCHEDULER_CAPACITY < 0xff, "SCHEDULER_CAPACITY is too large");
+        Timer *heap[CAPACITY];
+        uint8_t size = 0;
+        // Counts of timers fired, in total, in the second now accumulating, and in the last full second.
+        uint32_t total = 0;
+        uint32_t window_count = 0;
+        uint32_t window_start = 0;
+        uint32_t per_second = 0;
+
+        // Times compare by signed difference, so millis() wrapping around is harmless.
+        static inline bool before(uint32_t a, uint32_t b) {
+            return static_cast<int32_t>(a - b) < 0;
+        }
+        void place(uint8_t i, Timer *t);
+        void siftUp(uint8_t i);
+        void siftDown(uint8_t i);
+        void remove(uint8_t i);
+    public:
+        // Run timer at time due (in millis()), replacing any earlier schedule for it.
+        // Returns false if the scheduler is full.
+        bool schedule(Timer &timer, uint32_t due);
+        // Run timer ms milliseconds from now.
+        bool scheduleIn(Timer &timer, uint32_t ms);
+        // Unschedule timer, if it is pending.
+        void cancel(Timer &timer);
+        // Called from loop(): run every timer that is due, earliest first. Cheap when nothing is due.
+        void service(uint32_t now);
+        // Number of timers pending.
+        inline uint8_t pending() const {
+            return size;
+        }
+        // Timers fired during the last full second.
+        inline uint32_t servicedPerSecond() const {
+            return per_second;
+        }
+        // Timers fired since startup.
+        inline uint32_t serviced() const {
+            return total;
+        }
+};
+
+extern Scheduler scheduler;
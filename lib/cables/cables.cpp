@@ -6,5 +6,49 @@
 
 // Cable definitions
 USBMIDI_CREATE_INSTANCE(0, CABLE1);
-//USBMIDI_CREATE_INSTANCE(1, CABLE2);
-//USBMIDI_CREATE_INSTANCE(2, CABLE3);
\ No newline at end of file
+USBMIDI_CREATE_INSTANCE(1, CABLE2);
+USBMIDI_CREATE_INSTANCE(2, CABLE3);
+
+MidiCable *const CABLES[NUM_CABLES] = {&CABLE1, &CABLE2, &CABLE3};
+
+Router router;
+
+static inline bool valid(uint8_t cable, uint8_t channel) {
+    return cable >= 1 && cable <= NUM_CABLES && channel >= 1 && channel <= 16;
+}
+
+Router &Router::route(uint8_t srcCable, uint8_t srcChannel, uint8_t dstCable, uint8_t dstChannel) {
+    if (valid(srcCable, srcChannel) && valid(dstCable, dstChannel)) {
+        auto &r = routes[srcCable - 1][srcChannel - 1];
+        r.cables |= 1 << (dstCable - 1);
+        r.channel[dstCable - 1] = dstChannel;
+    }
+    return *this;
+}
+
+Router &Router::route(uint8_t srcCable, uint8_t dstCable) {
+    for (uint8_t channel = 1; channel <= 16; channel++) {
+        route(srcCable, channel, dstCable, channel);
+    }
+    return *this;
+}
+
+Router &Router::unroute(uint8_t srcCable, uint8_t srcChannel, uint8_t dstCable) {
+    if (valid(srcCable, srcChannel) && valid(dstCable, 1)) {
+        routes[srcCable - 1][srcChannel - 1].cables &= ~(1 << (dstCable - 1));
+    }
+    return *this;
+}
+
+Router &Router::clear() {
+    for (auto &cable : routes) {
+        for (auto &r : cable) {
+            r.cables = 0;
+        }
+    }
+    return *this;
+}
+
+uint8_t Router::destinations(uint8_t srcCable, uint8_t srcChannel) const {
+    return valid(srcCable, srcChannel) ? routes[srcCable - 1][srcChannel - 1].cables : 0;
+}
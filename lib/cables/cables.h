@@ -5,7 +5,52 @@
 #pragma once
 #include <USB-MIDI.h>
 
+using MidiCable = midi::MidiInterface<usbMidi::usbMidiTransport>;
+
 // Define our virtual cables.
-extern midi::MidiInterface<usbMidi::usbMidiTransport> CABLE1;
-extern midi::MidiInterface<usbMidi::usbMidiTransport> CABLE2;
-extern midi::MidiInterface<usbMidi::usbMidiTransport> CABLE3;
+extern MidiCable CABLE1;
+extern MidiCable CABLE2;
+extern MidiCable CABLE3;
+
+const uint8_t NUM_CABLES = 3;
+// The cables, indexed by cable number - 1.
+extern MidiCable *const CABLES[NUM_CABLES];
+
+/**
+ * Forwarding of channel messages between the cables, so the box can act as a hub.
+ *
+ * For each source cable and channel, the table holds a bitmask of destination cables and the
+ * channel to use on each, so forwarding a message is a table load and one send per set bit.
+ * Cables and channels are numbered from 1, as in the handlers.
+ */
+class Router {
+    private:
+        struct Route {
+            uint8_t cables;                 // Bit n set: forward to cable n + 1
+            uint8_t channel[NUM_CABLES];    // Destination channel (1-16) on each cable
+        };
+        Route routes[NUM_CABLES][16] = {};
+    public:
+        // Forward messages on srcCable/srcChannel to dstCable/dstChannel, in addition to any
+        // other destinations. A source has at most one destination channel per cable.
+        Router &route(uint8_t srcCable, uint8_t srcChannel, uint8_t dstCable, uint8_t dstChannel);
+        // Forward every channel of srcCable to the same channel on dstCable.
+        Router &route(uint8_t srcCable, uint8_t dstCable);
+        // Stop forwarding srcCable/srcChannel to dstCable.
+        Router &unroute(uint8_t srcCable, uint8_t srcChannel, uint8_t dstCable);
+        // Forward nothing.
+        Router &clear();
+        // Bitmask of cables (bit n for cable n + 1) that srcCable/srcChannel forwards to.
+        uint8_t destinations(uint8_t srcCable, uint8_t srcChannel) const;
+
+        // Send a channel message received on cable to its destinations.
+        inline void forward(uint8_t cable, midi::MidiType type, byte channel, byte d1, byte d2 = 0) const {
+            auto &r = routes[cable - 1][(channel - 1) & 0x0f];
+            for (uint8_t m = r.cables; m; m &= m - 1) {
+                auto dst = __builtin_ctz(m);
+                CABLES[dst]->send(type, d1, d2, r.channel[dst]);
+            }
+        }
+};
+
+extern Router router;
@@ -4,32 +4,74 @@
  */
 #include "debug.h"
 #include <Arduino.h>
+#include <EventRing.h>
+#include <Format.h>
 
-void debug_internal(const std::string &msg) {
-    Serial.println(msg.c_str());
+// Only a token ring when debugging is off.
+static EventRing<LogRecord, DEBUG ? DEBUG_LOG_SIZE : 2> log_ring;
+// Drops already reported.
+static uint32_t reported_drops = 0;
+
+void debug_internal(const LogRecord &rec) {
+    auto r = rec;
+    r.us = micros();
+    log_ring.push(r);
+}
+
+uint32_t debugDropped() {
+    return log_ring.overflows();
 }
 
-const char * const DIGITS = "0123456789abcdef";
+// Longest line, with CRLF. It fits in one USB CDC packet, so printing it cannot block
+// once availableForWrite() says there is room.
+static const int LINE = 62;
 
-std::string hex(uint8_t val) {
-    if (DEBUG) {
-        char buf[3];
-        buf[0] = DIGITS[(val & 0xf0) >> 4];
-        buf[1] = DIGITS[val & 0x0f];
-        buf[2] = '\0';
-        return std::string(buf);
-    } else {
-        // Minimize code footprint, assuming compiler optimizations
-        return "";
+static void print(const LogRecord &r) {
+    Format<LINE - 1> out;
+    out.add(r.us / 1000).add('.').add((r.us / 100) % 10).add(' ');
+    switch (r.source) {
+        case LogSource::TEXT:
+            out.add(r.text ? r.text : "");
+            break;
+        case LogSource::NOTE_ON:
+            out.add("ON ").add(r.a).add(' ').add(r.b);
+            break;
+        case LogSource::NOTE:
+            out.add(r.a).add('!').add(r.b).add(':').add(r.text).add(' ').note(r.c).add('@').add(r.d);
+            break;
+        case LogSource::PROGRAM:
+            out.add(r.a).add('!').add(r.b).add(":PGM #").add(r.c);
+            break;
+        case LogSource::KEY_DOWN:
+        case LogSource::KEY_UP:
+            out.add(r.source == LogSource::KEY_DOWN ? "ON KEY " : "OFF KEY ")
+                .add(r.a).add(' ').add(r.b).add(' ').add(r.c).add(' ').hex(r.value);
+            break;
+        case LogSource::ALL_UP:
+            out.add(r.a ? "ALLUP YES" : "ALLUP NO");
+            break;
     }
+    Serial.println(out.c_str());
 }
 
-std::string hex(uint16_t val) {
-    return hex(static_cast<uint8_t>((val & 0xff00) >> 8))
-        + hex(static_cast<uint8_t>(val & 0x00ff));
+void debugDrain(uint32_t loop_start) {
+    if (!DEBUG) {
+        return;
+    }
+    LogRecord r;
+    while (micros() - loop_start < DEBUG_LOOP_BUDGET_US && Serial.availableForWrite() >= LINE) {
+        if (log_ring.pop(r)) {
+            print(r);
+            continue;
+        }
+        // Report drops once caught up, after the records that filled the ring.
+        auto dropped = log_ring.overflows();
+        if (dropped != reported_drops) {
+            Format<LINE - 1> out("... ");
+            out.add(dropped - reported_drops).add(" log records dropped");
+            Serial.println(out.c_str());
+            reported_drops = dropped;
+        }
+        break;
+    }
 }
-
-std::string hex(uint32_t val) {
-    return hex(static_cast<uint16_t>((val & 0xffff0000) >> 16))
-        + hex(static_cast<uint16_t>(val & 0x0000ffff));
-}
\ No newline at end of file
@@ -3,7 +3,7 @@
  * License: MIT
  */
 #pragma once
-#include <string>
+#include <stdint.h>
 
 // Debugging support.
 
@@ -23,14 +23,55 @@ const bool DEBUG_MAIN = false;
 
 const bool DEBUG = DEBUG_KEYTRACKER || DEBUG_MAIN;
 
-extern void debug_internal(const std::string &msg);
+// Debug output is deferred: handlers append fixed-size binary records to a ring in constant
+// time, and loop() formats and prints them with debugDrain() when it has time to spare, so
+// logging neither blocks on the serial port nor shifts the timing being debugged.
 
-inline void debug(const std::string &msg) {
+#ifndef DEBUG_LOG_SIZE
+#define DEBUG_LOG_SIZE 64
+#endif
+
+// Longest debugDrain() may keep loop() busy, in microseconds.
+#ifndef DEBUG_LOOP_BUDGET_US
+#define DEBUG_LOOP_BUDGET_US 1000
+#endif
+
+// What a record describes, which determines how its payload is shown.
+enum class LogSource: uint8_t {
+    TEXT,       // text
+    NOTE_ON,    // a: channel, b: note
+    NOTE,       // text: " ON"/"OFF", a: cable, b: channel, c: note, d: velocity
+    PROGRAM,    // a: cable, b: channel, c: program
+    KEY_DOWN,   // a: channel, b: key, c: word, value: that word of the bitmap after
+    KEY_UP,     // a: channel, b: key, c: word, value: that word of the bitmap after
+    ALL_UP      // a: result
+};
+
+struct LogRecord {
+    uint32_t us;            // micros() when logged
+    LogSource source;
+    uint8_t a, b, c, d;
+    uint32_t value;
+    const char *text;       // must be static, e.g. a literal
+};
+
+extern void debug_internal(const LogRecord &rec);
+
+inline void debugLog(LogSource source, uint8_t a = 0, uint8_t b = 0, uint8_t c = 0, uint8_t d = 0,
+                     uint32_t value = 0, const char *text = nullptr) {
     if (DEBUG) {
-        debug_internal(msg);
+        debug_internal({0, source, a, b, c, d, value, text});
     }
 }
 
-extern std::string hex(uint8_t val);
-extern std::string hex(uint16_t val);
-extern std::string hex(uint32_t val);
\ No newline at end of file
+// Log a static message, such as a literal.
+inline void debug(const char *msg) {
+    debugLog(LogSource::TEXT, 0, 0, 0, 0, 0, msg);
+}
+
+// Called at the end of loop(): print queued records until the loop, which started at
+// loop_start (micros()), has used DEBUG_LOOP_BUDGET_US, or the serial port would block.
+extern void debugDrain(uint32_t loop_start);
+
+// Records dropped because the ring was full.
+extern uint32_t debugDropped();
@@ -0,0 +1,99 @@
+/**
+ * @copyright Copyright (c) 2021 Bob Kerns
+ * License: MIT
+ */
+// Host-side stand-in for the Arduino core, used by the native build.
+// Only what the firmware actually uses is provided. Time is virtual; see NativeHAL.h.
+#pragma once
+#include <cstdint>
+#include <cstddef>
+#include <cstring>
+#include <cstdlib>
+#include <algorithm>
+#include <string>
+
+// The firmware #undef's these and expects functions to remain.
+using std::min;
+using std::max;
+
+typedef uint8_t byte;
+typedef bool boolean;
+
+#define PROGMEM
+
+#define LOW 0
+#define HIGH 1
+
+// Pin modes
+#define INPUT 0x0
+#define OUTPUT 0x1
+#define INPUT_PULLUP 0x2
+#define INPUT_PULLDOWN 0x3
+
+// Interrupt modes
+#define CHANGE 2
+#define FALLING 3
+#define RISING 4
+
+#define NOT_AN_INTERRUPT -1
+
+// Seeeduino XIAO pin numbering.
+#define A0 0
+#define A1 1
+#define A2 2
+#define A3 3
+#define A4 4
+#define A5 5
+#define A6 6
+#define A7 7
+#define A8 8
+#define A9 9
+#define A10 10
+#define PIN_LED_13 13
+#define LED_BUILTIN PIN_LED_13
+#define NUM_DIGITAL_PINS 20
+
+extern unsigned long millis();
+extern unsigned long micros();
+extern void delay(unsigned long ms);
+extern void delayMicroseconds(unsigned int us);
+
+extern void pinMode(uint32_t pin, uint32_t mode);
+extern void digitalWrite(uint32_t pin, uint32_t val);
+extern int digitalRead(uint32_t pin);
+
+typedef void (*voidFuncPtr)(void);
+
+inline int digitalPinToInterrupt(int pin) {
+    return pin >= 0 && pin <= A10 ? pin : NOT_AN_INTERRUPT;
+}
+extern void attachInterrupt(uint32_t interrupt, voidFuncPtr callback, uint32_t mode);
+extern void detachInterrupt(uint32_t interrupt);
+extern void noInterrupts();
+extern void interrupts();
+
+// The USB device; the host has always finished enumerating it.
+class USBDeviceClass {
+    public:
+        bool configured() { return true; }
+};
+extern USBDeviceClass USBDevice;
+
+// USB CDC serial port; output goes to stdout.
+class Serial_ {
+    public:
+        void begin(unsigned long baud) { (void)baud; }
+        void end() {}
+        operator bool() const { return true; }
+        int availableForWrite() const { return 64; }
+        void flush();
+        size_t write(uint8_t c);
+        size_t print(const char *str);
+        size_t println(const char *str);
+        size_t println();
+};
+extern Serial_ Serial;
+
+// Provided by the sketch.
+extern void setup();
+extern void loop();
@@ -0,0 +1,61 @@
+/**
+ * @copyright Copyright (c) 2021 Bob Kerns
+ * License: MIT
+ */
+// Menus whose lists span banks, from native/patches/banked.csv: an incoming bank select and
+// program change must find their entry, a program the list lacks must leave the channel alone,
+// and choosing an entry must send its bank select, MSB then LSB, ahead of the program change.
+#include "Checks.h"
+#include "NativeHAL.h"
+#include <AltoidMidi.h>
+#include "FixturePatches.h"
+
+namespace {
+    const uint8_t CHANNEL = 5;
+    DMenu bankedMenu(banked);
+
+    void programChange(uint8_t msb, uint8_t lsb, uint8_t program) {
+        const uint8_t cc = 0xB0 | (CHANNEL - 1);
+        checks::receive(1, {cc, 0, msb, cc, 32, lsb, uint8_t(0xC0 | (CHANNEL - 1)), program});
+    }
+
+    bool entry(FILE *out, const char *what, const ChannelState &state, uint16_t expected) {
+        auto ok = state.program == expected && std::string(state.programName) == bankedMenu.item(expected);
+        std::fprintf(out, "  %-40s entry %2u, %s%s\n", what, state.program, state.programName, ok ? "" : "  WRONG");
+        return ok;
+    }
+}
+
+bool checks::banks(FILE *out) {
+    auto ok = true;
+    boot();
+    auto &state = ChannelState::currentState[CHANNEL - 1];
+    state.menu = &bankedMenu;
+
+    programChange(8, 2, 4);
+    ok &= entry(out, "bank 8/2, program 4", state, 4);
+    programChange(0, 0, 48);
+    ok &= entry(out, "bank 0/0, program 48", state, 8);
+    // Entry 5 is bank 0/0 program 4, nothing to do with program 5.
+    programChange(0, 0, 5);
+    ok &= entry(out, "bank 0/0, program 5, not in the list", state, 8);
+    programChange(121, 1, 0);
+    ok &= entry(out, "bank 121/1, program 0", state, 10);
+
+    // Chosen as the knob would: the bank goes first.
+    hal::clearMidiOut(0);
+    state.queueProgramChange(9, bankedMenu.item(9));
+    idle(1000);
+    auto expected = std::string("\xB4\x00\x79\xB4\x20\x00\xC4\x00", 8);
+    auto sent = hal::midiOut(0) == expected;
+    std::fprintf(out, "  %-40s %s\n", "choosing GM Piano sends", sent ? "B4 00 79, B4 20 00, C4 00" : "WRONG");
+    ok &= sent;
+
+    // Without banks, a program past the list is still found by position.
+    auto &plain = ChannelState::currentState[0];
+    receive(1, {0xC0, uint8_t(programMenu.size() + 3)});
+    auto wrapped = plain.program == 3;
+    std::fprintf(out, "  %-40s entry %2u%s\n", "program list, program past its end", plain.program, wrapped ? "" : "  WRONG");
+    ok &= wrapped;
+    return ok;
+}
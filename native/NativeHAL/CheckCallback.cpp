@@ -0,0 +1,87 @@
+/**
+ * @copyright Copyright (c) 2021 Bob Kerns
+ * License: MIT
+ */
+// Callback dispatch: what a call through a trampoline from bind() or next() costs, against the
+// std::function table they replaced, and that bound slots run, fill up and free as they should.
+#include "Checks.h"
+#include <Callback.h>
+#include <chrono>
+
+namespace {
+    using Clock = std::chrono::steady_clock;
+
+    struct Target {
+        uint32_t hits = 0;
+        void hit() { hits++; }
+    };
+
+    // The dispatch Callback::next() used before: a std::function per slot, called by a
+    // hand-written trampoline.
+    std::function<void()> table[NUMBER_OF_CALLBACKS];
+
+    // Call fn calls times through a pointer the compiler cannot see through.
+    double dispatchNs(callbackFn fn, uint32_t calls) {
+        callbackFn volatile call = fn;
+        auto begin = Clock::now();
+        for (uint32_t i = 0; i < calls; i++) {
+            call();
+        }
+        auto ns = std::chrono::duration_cast<std::chrono::nanoseconds>(Clock::now() - begin).count();
+        return (double)ns / calls;
+    }
+
+    bool timing(FILE *out, const char *label, callbackFn fn, const uint32_t &hits, uint32_t calls) {
+        auto before = hits;
+        auto ns = dispatchNs(fn, calls);
+        auto ok = hits - before == calls;
+        std::fprintf(out, "  %-38s %5.2f ns per call%s\n", label, ns, ok ? "" : ", MISSED CALLS");
+        return ok;
+    }
+}
+
+bool checks::callback(FILE *out) {
+    auto ok = true;
+    const uint32_t CALLS = 20000000;
+    Target target;
+
+    auto bound = Callback::bind<&Target::hit>(target);
+    ok &= timing(out, "bind<&Target::hit>", bound, target.hits, CALLS);
+    auto wrapped = Callback::next([&target] { target.hit(); });
+    ok &= timing(out, "next(std::function)", wrapped, target.hits, CALLS);
+    table[0] = [&target] { target.hit(); };
+    ok &= timing(out, "std::function table (before)", [] { table[0](); }, target.hits, CALLS);
+    ok &= Callback::unbind<&Target::hit>(bound) && Callback::release(wrapped);
+
+    // Past the old limit of 64: every slot calls its own object, a full table refuses, and
+    // a freed slot can be claimed again.
+    const size_t SLOTS = 100;
+    static Target targets[SLOTS];
+    callbackFn fns[SLOTS];
+    for (size_t i = 0; i < SLOTS; i++) {
+        fns[i] = Callback::bind<&Target::hit, SLOTS>(targets[i]);
+        ok &= fns[i] != nullptr;
+    }
+    for (size_t i = 0; i < SLOTS; i++) {
+        for (size_t n = 0; n <= i && fns[i]; n++) {
+            fns[i]();
+        }
+    }
+    auto each = true;
+    for (size_t i = 0; i < SLOTS; i++) {
+        each &= targets[i].hits == i + 1;
+    }
+    Target extra;
+    auto full = Callback::bind<&Target::hit, SLOTS>(extra) == nullptr;
+    auto freed = Callback::unbind<&Target::hit, SLOTS>(fns[SLOTS / 2]);
+    auto again = Callback::bind<&Target::hit, SLOTS>(extra);
+    if (again) {
+        again();
+    }
+    auto reused = again == fns[SLOTS / 2] && extra.hits == 1;
+    std::fprintf(out, "  %zu slots: %s, %s when full, %s after unbind\n", SLOTS,
+        each ? "each calls its own object" : "WRONG OBJECTS CALLED",
+        full ? "refused" : "NOT REFUSED", reused ? "reused" : "NOT REUSED");
+    ok &= each && full && freed && reused;
+    return ok;
+}
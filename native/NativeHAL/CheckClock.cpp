@@ -0,0 +1,127 @@
+/**
+ * @copyright Copyright (c) 2021 Bob Kerns
+ * License: MIT
+ */
+// The tempo MidiClock reads from a clock stream as it arrives over USB: each tick late or early
+// by up to a millisecond or two, some lost, some doubled. The tempo must settle within half a
+// percent in two beats, and stay there.
+#include "Checks.h"
+#include <MidiClock.h>
+#include <chrono>
+#include <cmath>
+#include <random>
+
+namespace {
+    const double SETTLED = 0.005;
+    const uint32_t SETTLE_TICKS = 2 * MidiClock::PPQN;
+
+    double error(const MidiClock &clock, double bpm) {
+        auto tempo = clock.tempo();
+        return tempo ? std::fabs(tempo / 100.0 - bpm) / bpm : 1;
+    }
+
+    // Forty beats at bpm, each tick moved by up to jitter_us either way, a fraction lost of them
+    // dropped, and every thirtieth followed closely by a copy if doubled.
+    bool steady(FILE *out, const char *label, double bpm, double jitter_us, double lost, bool doubled = false) {
+        MidiClock clock;
+        std::mt19937 rng(42);
+        std::uniform_real_distribution<double> jitter(-jitter_us, jitter_us), chance(0, 1);
+        auto period = 60e6 / bpm / MidiClock::PPQN;
+        double t = 1000;
+        int32_t settled = -1;
+        double worst = 0;
+        for (uint32_t i = 0; i < 40 * MidiClock::PPQN; i++) {
+            t += period;
+            if (chance(rng) < lost) {
+                continue;
+            }
+            auto at = t + jitter(rng);
+            clock.tick(at);
+            if (doubled && i % 30 == 5) {
+                clock.tick(at + 500);
+            }
+            auto err = error(clock, bpm);
+            if (settled < 0 && err < SETTLED) {
+                settled = i;
+            }
+            if (settled >= 0 && i > settled + SETTLE_TICKS) {
+                worst = std::max(worst, err);
+            }
+        }
+        auto ok = settled >= 0 && uint32_t(settled) <= SETTLE_TICKS && worst < SETTLED;
+        if (settled < 0) {
+            std::fprintf(out, "  %-26s %5.0f BPM: never within 0.5%%\n", label, bpm);
+            return false;
+        }
+        std::fprintf(out, "  %-26s %5.0f BPM: within 0.5%% after %4.2f beats, then within %5.3f%%%s\n",
+            label, bpm, settled / double(MidiClock::PPQN), worst * 100, ok ? "" : "  TOO SLOW OR INACCURATE");
+        return ok;
+    }
+
+    // Eight beats at one tempo, then at another, with a millisecond of jitter: the new tempo
+    // must be followed within 1% in two beats.
+    bool step(FILE *out, double from, double to) {
+        MidiClock clock;
+        std::mt19937 rng(1);
+        std::uniform_real_distribution<double> jitter(-1000, 1000);
+        double t = 0;
+        for (uint32_t i = 0; i < 8 * MidiClock::PPQN; i++) {
+            t += 60e6 / from / MidiClock::PPQN;
+            clock.tick(t + jitter(rng));
+        }
+        uint32_t ticks = 0;
+        while (ticks < 8 * MidiClock::PPQN) {
+            t += 60e6 / to / MidiClock::PPQN;
+            clock.tick(t + jitter(rng));
+            ticks++;
+            if (error(clock, to) < 0.01) {
+                break;
+            }
+        }
+        auto ok = ticks <= SETTLE_TICKS;
+        std::fprintf(out, "  %3.0f to %3.0f BPM: within 1%% after %4.2f beats%s\n",
+            from, to, ticks / double(MidiClock::PPQN), ok ? "" : "  TOO SLOW");
+        return ok;
+    }
+}
+
+bool checks::clock(FILE *out) {
+    auto ok = true;
+    for (auto bpm : {30.0, 60.0, 120.0, 174.0, 300.0}) {
+        ok &= steady(out, "clean", bpm, 0, 0);
+        ok &= steady(out, "jitter 1 ms", bpm, 1000, 0);
+        // A gap of two medians less jitter is still a lost tick: this fails if the 1.75-median
+        // threshold for a lost tick is raised toward 2.
+        ok &= steady(out, "jitter 1 ms, 2% lost", bpm, 1000, 0.02);
+    }
+    // An interval stretched by jitter is still one tick: at 300 BPM, 2 ms of jitter stretches
+    // one by nearly half, and this fails if the threshold is lowered toward 1.5.
+    ok &= steady(out, "jitter 2 ms", 120, 2000, 0);
+    ok &= steady(out, "jitter 2 ms", 300, 2000, 0);
+    // A tick within a quarter of a median of the last is a duplicate, and left out.
+    ok &= steady(out, "doubled", 120, 0, 0, true);
+    ok &= steady(out, "jitter 1 ms, doubled", 174, 1000, 0, true);
+    ok &= step(out, 120, 128);
+    ok &= step(out, 120, 60);
+    ok &= step(out, 60, 300);
+
+    // What tick() costs in the MIDI handler, and tempo() when the tempo is shown.
+    MidiClock clock;
+    const uint32_t TICKS = 10000000;
+    auto begin = std::chrono::steady_clock::now();
+    uint32_t t = 0;
+    for (uint32_t i = 0; i < TICKS; i++) {
+        t += 8333;
+        clock.tick(t);
+    }
+    auto tick_ns = std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - begin).count() / TICKS;
+    const uint32_t TEMPOS = 100000;
+    volatile uint32_t tempo = 0;
+    begin = std::chrono::steady_clock::now();
+    for (uint32_t i = 0; i < TEMPOS; i++) {
+        tempo = tempo + clock.tempo();
+    }
+    auto tempo_ns = std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - begin).count() / TEMPOS;
+    std::fprintf(out, "  tick() %.1f ns, tempo() %.0f ns\n", tick_ns, tempo_ns);
+    return ok;
+}
@@ -0,0 +1,336 @@
+/**
+ * @copyright Copyright (c) 2021 Bob Kerns
+ * License: MIT
+ */
+// Knob interrupt handling: what updateCount() costs per edge, and how many steps are lost
+// when the knob turns faster than the main loop drains its events, beside the decoder it
+// replaced; and the acceleration curve.
+#include "Checks.h"
+#include "NativeHAL.h"
+#include <Knob.h>
+#include <chrono>
+
+namespace {
+    using Clock = std::chrono::steady_clock;
+
+    // Spare pins: setup() is not run, so nothing else is attached to them. The knobs are static,
+    // as their interrupt handlers stay attached.
+    const int CLK = A4;
+    const int DT = A5;
+    const int BARE = A10;
+    const int ACCEL_CLK = A0;
+    const int ACCEL_DT = A6;
+    const uint32_t SPEEDS[] = {20, 100, 300, 1000, 4000};
+    const uint32_t READS[] = {1000, 23000};
+
+    int64_t wallNs(Clock::time_point since) {
+        return std::chrono::duration_cast<std::chrono::nanoseconds>(Clock::now() - since).count();
+    }
+
+    // The encoder as updateCount() decoded it before the transition table: each pin through
+    // digitalRead(), a switch on the old and new levels, and a std::function callback slot.
+    // Its changes go through a ring like the knob's, and read() just adds them up.
+    class SwitchDecoder {
+        public:
+            void start() {
+                state = (digitalRead(CLK) ? 2 : 0) | (digitalRead(DT) ? 1 : 0);
+                isr = Callback::next([this] { update(); });
+                attachInterrupt(digitalPinToInterrupt(CLK), isr, CHANGE);
+                attachInterrupt(digitalPinToInterrupt(DT), isr, CHANGE);
+            }
+
+            void stop() {
+                detachInterrupt(digitalPinToInterrupt(CLK));
+                detachInterrupt(digitalPinToInterrupt(DT));
+                Callback::release(isr);
+            }
+
+            int read() {
+                events.drain([this](const KnobEvent &ev) { count += ev.delta; });
+                return count;
+            }
+
+            uint32_t overflows() const {
+                return events.overflows();
+            }
+
+        private:
+            volatile uint16_t state = 0;
+            int32_t count = 0;
+            EventRing<KnobEvent, KNOB_EVENT_RING_SIZE> events;
+            callbackFn isr = nullptr;
+
+            int8_t sampleCount() {
+                uint8_t s = state & 3;
+                if (digitalRead(DT)) s |= 4;
+                if (digitalRead(CLK)) s |= 8;
+                state = (s >> 2);
+                switch (s) {
+                    case 0: case 5: case 10: case 15:
+                        return 0;
+                    case 1: case 7: case 8: case 14:
+                        return 1;
+                    case 2: case 4: case 11: case 13:
+                        return -1;
+                    case 3: case 12:
+                        return 2;
+                    default:
+                        return -2;
+                }
+            }
+
+            void update() {
+                auto delta = sampleCount();
+                if (delta) {
+                    events.push({KnobEvent::DELTA, delta, millis()});
+                }
+            }
+    };
+
+    // What a decoder costs, and what it missed at each speed.
+    struct Run {
+        double edge_ns;
+        double read_ns;
+        bool counted;
+        uint32_t edges[std::size(READS)][std::size(SPEEDS)];
+        uint32_t missed[std::size(READS)][std::size(SPEEDS)];
+    };
+
+    // Drive edges through a decoder a half-ring at a time, reading between, timing each part.
+    template<typename K>
+    bool edges(K &knob, uint32_t count, Run &run) {
+        const uint32_t BATCH = KNOB_EVENT_RING_SIZE / 2;
+        auto isrs = hal::isrCount();
+        auto start = knob.read();
+        auto overflows = knob.overflows();
+        int64_t edge_ns = 0;
+        int64_t read_ns = 0;
+        for (uint32_t i = 0; i < count; i += BATCH) {
+            auto begin = Clock::now();
+            checks::turn(CLK, DT, BATCH);
+            edge_ns += wallNs(begin);
+            begin = Clock::now();
+            knob.read();
+            read_ns += wallNs(begin);
+        }
+        run.edge_ns = (double)edge_ns / count;
+        run.read_ns = (double)read_ns / count;
+        return hal::isrCount() - isrs == count && knob.read() - start == (int)count && knob.overflows() == overflows;
+    }
+
+    // Turn at detents_per_s, with the main loop calling read() every read_us (microseconds of
+    // virtual time), for one virtual second. The count must be off by exactly the overflows,
+    // and nothing may be missed if the ring can hold what arrives between reads.
+    template<typename K>
+    bool rotate(K &knob, uint32_t detents_per_s, uint32_t read_us, uint32_t &edges, uint32_t &missed) {
+        auto edge_us = 1000000.0 / (detents_per_s * 4.0);
+        auto start = knob.read();
+        auto overflows = knob.overflows();
+        edges = 0;
+        double next_edge = 0;
+        uint32_t next_read = read_us;
+        uint64_t t = 0;
+        while (t < 1000000) {
+            if (next_edge < next_read) {
+                auto at = (uint64_t)next_edge;
+                hal::advance(at - t);
+                t = at;
+                checks::turn(CLK, DT, 1);
+                edges++;
+                next_edge += edge_us;
+            } else {
+                hal::advance(next_read - t);
+                t = next_read;
+                knob.read();
+                next_read += read_us;
+            }
+        }
+        auto lost = knob.overflows() - overflows;
+        missed = edges - (knob.read() - start);
+        auto per_read = edges * (double)read_us / t;
+        return missed == lost && (per_read > KNOB_EVENT_RING_SIZE - 1 || missed == 0);
+    }
+
+    // Edges, then every speed at each read interval.
+    template<typename K>
+    bool bench(K &knob, uint32_t count, Run &run) {
+        auto ok = edges(knob, count, run);
+        for (size_t r = 0; r < std::size(READS); r++) {
+            for (size_t i = 0; i < std::size(SPEEDS); i++) {
+                ok &= rotate(knob, SPEEDS[i], READS[r], run.edges[r][i], run.missed[r][i]);
+            }
+        }
+        run.counted = ok;
+        return ok;
+    }
+}
+
+bool checks::knob(FILE *out) {
+    auto ok = true;
+    hal::setPin(CLK, HIGH);
+    hal::setPin(DT, HIGH);
+
+    // The simulated pin and interrupt dispatch, with a handler that does nothing, is the
+    // baseline to take from the cost of an edge through each decoder.
+    const uint32_t EDGES = 2000000;
+    attachInterrupt(digitalPinToInterrupt(BARE), [] {}, CHANGE);
+    auto begin = Clock::now();
+    for (uint32_t i = 0; i < EDGES; i++) {
+        hal::setPin(BARE, i & 1);
+    }
+    auto bare_ns = (double)wallNs(begin) / EDGES;
+
+    // The old decoder first, on the same pins, then the knob takes them over.
+    static SwitchDecoder old;
+    Run before, after;
+    old.start();
+    ok &= bench(old, EDGES, before);
+    old.stop();
+
+    static Knob knob("bench", CLK, DT);
+    knob.start(Knob::PULLUP, Knob::PULLUP);
+    knob.precision(Knob::QUAD).range(-100000000, 100000000, false);
+    hal::advance(2000 * KNOB_SETTLE_MS);
+    knob.read();
+    ok &= bench(knob, EDGES, after);
+
+    // Natively both sample through digitalRead(); the PORT reads are only on the SAMD.
+    std::fprintf(out, "  %u edges, %.1f ns each with an empty handler, and in the handler:\n", EDGES, bare_ns);
+    std::fprintf(out, "    switch decoder (before)     %5.1f ns%s\n", before.edge_ns - bare_ns,
+        before.counted ? "" : "  NOT ALL COUNTED");
+    std::fprintf(out, "    transition table (after)    %5.1f ns%s\n", after.edge_ns - bare_ns,
+        after.counted ? "" : "  NOT ALL COUNTED");
+    std::fprintf(out, "  the knob's read() applies them at %.1f ns per event\n", after.read_ns);
+
+    // From a slow turn to faster than any hand, with the loop keeping up, and with it blocked
+    // by a full-screen flush over 400 kHz I2C (1024 bytes at 22.5 us). Both decoders lose
+    // steps only when the ring is full.
+    std::fprintf(out, "  steps missed, by the switch decoder and by the transition table:\n");
+    for (size_t r = 0; r < std::size(READS); r++) {
+        for (size_t i = 0; i < std::size(SPEEDS); i++) {
+            auto edges = after.edges[r][i];
+            std::fprintf(out, "  %5u detents/s, read every %5u us: %6u edges, %6.1f per read, %6u (%5.1f%%), %6u (%5.1f%%)\n",
+                SPEEDS[i], READS[r], edges, edges * (double)READS[r] / 1000000,
+                before.missed[r][i], 100.0 * before.missed[r][i] / before.edges[r][i],
+                after.missed[r][i], 100.0 * after.missed[r][i] / edges);
+        }
+    }
+    return ok;
+}
+
+namespace {
+    // One step of the acceleration check: wait_ms after the last, turn by counts, and the knob
+    // should then read expect.
+    struct TimedStep {
+        uint32_t wait_ms;
+        int counts;
+        int expect;
+        const char *what;
+    };
+
+    bool steps(FILE *out, Knob &knob, const TimedStep *begin, const TimedStep *end) {
+        auto ok = true;
+        for (auto s = begin; s != end; s++) {
+            hal::advance(s->wait_ms * 1000);
+            auto before = knob.read();
+            checks::turn(ACCEL_CLK, ACCEL_DT, s->counts);
+            auto after = knob.read();
+            std::fprintf(out, "  %-34s %4u ms, %2d counts: %4d -> %4d, expected %4d%s\n",
+                s->what, s->wait_ms, s->counts, before, after, s->expect, after == s->expect ? "" : "  WRONG");
+            ok &= after == s->expect;
+        }
+        return ok;
+    }
+
+    // Set the knob to value, once it has been still long enough to take it.
+    void reset(Knob &knob, int value) {
+        hal::advance((knob.ROTATE_GUARD_MS + 100) * 1000);
+        knob.read();
+        knob.write(value);
+    }
+}
+
+bool checks::acceleration(FILE *out) {
+    auto ok = true;
+    hal::setPin(ACCEL_CLK, HIGH);
+    hal::setPin(ACCEL_DT, HIGH);
+    static Knob knob("accel", ACCEL_CLK, ACCEL_DT);
+    knob.start(Knob::PULLUP, Knob::PULLUP);
+    // Steps of 120 ms or more count once, of 15 ms or less eight times; 50 ms is 1 + 7 * 70/105,
+    // and 90 ms 1 + 7 * 30/105, rounded down.
+    knob.precision(Knob::QUAD).range(-1000, 1000, false).acceleration({120, 15, 8});
+    hal::advance(2000 * KNOB_SETTLE_MS);
+    knob.read();
+
+    static const TimedStep RAMP[] = {
+        {500, 1, 1, "first step"},
+        {200, 1, 2, "slow"},
+        {120, 1, 3, "at slow_ms"},
+        {10, 1, 11, "fast"},
+        {15, 1, 19, "at fast_ms"},
+        {50, 1, 24, "mid-ramp"},
+        {90, 1, 27, "mid-ramp"},
+        {10, -1, 26, "fast, but reversed"},
+        {10, -1, 18, "fast, in the new direction"},
+        {10, 2, 27, "two counts: reversed, then fast"},
+    };
+    ok &= steps(out, knob, std::begin(RAMP), std::end(RAMP));
+
+    // Wrapping around five values, a step never goes all the way around.
+    knob.range(0, 4, true);
+    reset(knob, 1);
+    static const TimedStep WRAP[] = {
+        {500, 1, 2, "wrapping, slow"},
+        {10, 1, 1, "wrapping, fast: 4 at most"},
+        {10, 1, 0, "wrapping, fast"},
+        {10, -1, 4, "wrapping, reversed past the start"},
+    };
+    ok &= steps(out, knob, std::begin(WRAP), std::end(WRAP));
+
+    // Without wrapping, a fast step stops at the end of the range.
+    knob.range(0, 20, false);
+    reset(knob, 17);
+    static const TimedStep CLAMP[] = {
+        {500, 1, 18, "clamped, slow"},
+        {10, 1, 20, "clamped, fast: stops at the top"},
+        {10, 1, 20, "clamped, fast, at the top"},
+    };
+    ok &= steps(out, knob, std::begin(CLAMP), std::end(CLAMP));
+
+    // With four counts to a detent, a fast detent moves eight.
+    knob.precision(Knob::NORMAL).range(-100, 100, false);
+    reset(knob, 0);
+    static const TimedStep DETENTS[] = {
+        {500, 4, 1, "detents, slow"},
+        {10, 4, 9, "detents, fast"},
+        {50, 4, 14, "detents, mid-ramp"},
+    };
+    ok &= steps(out, knob, std::begin(DETENTS), std::end(DETENTS));
+
+    // The top of a range is padded by a whole step: a detent at NORMAL, one count at QUAD.
+    knob.range(0, 10, false);
+    reset(knob, 9);
+    static const TimedStep TOP_NORMAL[] = {
+        {500, 4, 10, "detents, to the top"},
+        {500, 2, 10, "detents, half past the top"},
+        {500, -2, 10, "detents, back to the top"},
+        {500, -4, 9, "detents, back one"},
+    };
+    ok &= steps(out, knob, std::begin(TOP_NORMAL), std::end(TOP_NORMAL));
+    knob.range(0, 10, true);
+    reset(knob, 9);
+    static const TimedStep WRAP_NORMAL[] = {
+        {500, 4, 10, "detents, wrapping, to the top"},
+        {500, 4, 0, "detents, wrapping past the top"},
+    };
+    ok &= steps(out, knob, std::begin(WRAP_NORMAL), std::end(WRAP_NORMAL));
+    knob.precision(Knob::QUAD).range(0, 10, false);
+    reset(knob, 9);
+    static const TimedStep TOP_QUAD[] = {
+        {500, 1, 10, "counts, to the top"},
+        {500, 1, 10, "counts, past the top"},
+        {500, -1, 9, "counts, back one"},
+    };
+    ok &= steps(out, knob, std::begin(TOP_QUAD), std::end(TOP_QUAD));
+    return ok;
+}
@@ -0,0 +1,65 @@
+/**
+ * @copyright Copyright (c) 2021 Bob Kerns
+ * License: MIT
+ */
+// MIDI latency while the display is sent over a slow I2C bus: doDisplay() sends a page or so
+// per pass of loop(), so a note never waits behind a whole frame.
+#include "Checks.h"
+#include "NativeHAL.h"
+#include <USB-MIDI.h>
+#include <DisplayMgr.h>
+
+namespace {
+    // 400 kHz I2C: nine bit times per byte.
+    const uint32_t I2C_BYTE_NS = 22500;
+
+    // A note arrives before each pass of loop(), for passes passes, while the whole panel is
+    // sent afresh. Each note must be taken in the pass it arrived before; the longest pass is
+    // how long one arriving just too late for a pass waits for the next.
+    bool redraw(FILE *out, const char *label, uint32_t budget_us, uint32_t passes, uint64_t limit_us) {
+        setDisplayBudget(budget_us);
+        // Its contents unknown, the panel is sent every page.
+        frameBuffer.begin();
+        auto input = usbMidi::usbMidiTransport::cables[0];
+        auto bytes = frameBuffer.totalBytes();
+        uint64_t longest = 0;
+        uint32_t late = 0;
+        uint32_t flushing = 0;
+        for (uint32_t i = 0; i < passes; i++) {
+            uint8_t note[] = {uint8_t(i & 1 ? 0x80 : 0x90), uint8_t(48 + (i >> 1) % 24), 100};
+            hal::midiIn(0, note, sizeof note);
+            flushing += frameBuffer.pending();
+            auto start = hal::now();
+            loop();
+            longest = std::max(longest, hal::now() - start);
+            if (!input->input.empty()) {
+                late++;
+                while (!input->input.empty()) {
+                    loop();
+                }
+            }
+            hal::advance(100);
+        }
+        bytes = frameBuffer.totalBytes() - bytes;
+        auto ok = !late && longest <= limit_us;
+        std::fprintf(out, "  %-22s %5u bytes over %4u passes; longest pass %6.2f ms (limit %6.2f), %u notes late\n",
+            label, bytes, flushing, longest / 1e3, limit_us / 1e3, late);
+        return ok;
+    }
+}
+
+bool checks::latency(FILE *out) {
+    auto ok = true;
+    boot();
+    hal::setI2cByteTime(I2C_BYTE_NS);
+    // A page is a row of 128 bytes, and a few commands to address it.
+    auto page_us = (FrameDisplay::WIDTH + 16) * I2C_BYTE_NS / 1000;
+    ok &= redraw(out, "a page per pass", 0, 400, page_us);
+    ok &= redraw(out, "6 ms per pass", 6000, 400, 6000 + page_us);
+    // As before flushFor(): the whole frame in one pass, which a note waits behind. Reported,
+    // not judged.
+    redraw(out, "all at once", 1000000, 400, 1000000);
+    setDisplayBudget(DISPLAY_BUDGET_US);
+    hal::setI2cByteTime(0);
+    return ok;
+}
@@ -0,0 +1,167 @@
+/**
+ * @copyright Copyright (c) 2021 Bob Kerns
+ * License: MIT
+ */
+// Presets across power cycles: what a knob chose before a restart must be sent, shown and
+// turned on from afterward; a record whose CRC fails is passed over for the one before it; and
+// a save after a page left part-written goes on to a fresh row instead of writing over it.
+#include "Checks.h"
+#include "NativeHAL.h"
+#include <AltoidMidi.h>
+#include <ChannelState.h>
+#include <Flash.h>
+#include <functional>
+#include <sys/wait.h>
+#include <unistd.h>
+
+namespace {
+    // Knob B chooses programs for channel 1, which go out on the first cable.
+    const int CLK = A1;
+    const int DT = A2;
+    const int SW = A3;
+    const uint8_t CHANNEL = 1;
+
+    // Run a power cycle of the firmware, in a process of its own, with the flash kept in path.
+    bool powerCycle(FILE *out, const std::string &path, const char *what, const std::function<bool()> &run) {
+        std::fprintf(out, "  %s\n", what);
+        std::fflush(out);
+        auto pid = fork();
+        if (pid == 0) {
+            hal::setFlashFile(path);
+            hal::clearMidiOut(0);
+            auto ok = run();
+            std::fflush(out);
+            _exit(ok ? 0 : 1);
+        }
+        int status = 1;
+        return pid > 0 && waitpid(pid, &status, 0) == pid && WIFEXITED(status) && !WEXITSTATUS(status);
+    }
+
+    // Turn one detent at a time, slowly enough not to accelerate, and wait out the save.
+    void detents(int n) {
+        for (int i = 0; i < n; i++) {
+            checks::turn(CLK, DT, 4);
+            checks::idle(200);
+        }
+        checks::idle(4000);
+    }
+
+    void click() {
+        hal::setPin(SW, LOW);
+        checks::idle(100);
+        hal::setPin(SW, HIGH);
+        checks::idle(4000);
+    }
+
+    // The program changes sent on the first cable for the channel since the last clearMidiOut().
+    std::string programChanges() {
+        std::string sent;
+        auto &bytes = hal::midiOut(0);
+        for (size_t i = 0; i + 1 < bytes.size(); i++) {
+            if (uint8_t(bytes[i]) == (0xC0 | (CHANNEL - 1))) {
+                sent += " " + std::to_string(uint8_t(bytes[i + 1]));
+            }
+        }
+        return sent;
+    }
+
+    bool expect(FILE *out, const char *what, const std::string &got, const std::string &expected) {
+        auto ok = got == expected;
+        std::fprintf(out, "    %-34s%s%s\n", what, got.c_str(), ok ? "" : ("  EXPECTED" + expected).c_str());
+        return ok;
+    }
+
+    bool expect(FILE *out, const char *what, int got, int expected) {
+        return expect(out, what, " " + std::to_string(got), " " + std::to_string(expected));
+    }
+
+    // The last page holding anything.
+    size_t lastWritten() {
+        size_t last = 0;
+        for (size_t page = 0; page < flash::PAGES; page++) {
+            uint8_t data[flash::PAGE_SIZE];
+            flash::read(page, data, sizeof(data));
+            for (auto b : data) {
+                if (b != 0xff) {
+                    last = page;
+                    break;
+                }
+            }
+        }
+        return last;
+    }
+}
+
+bool checks::presets(FILE *out) {
+    auto ok = true;
+    char path[] = "/tmp/altoid-presets-XXXXXX";
+    auto fd = mkstemp(path);
+    if (fd < 0) {
+        std::fprintf(out, "  no temporary file for the flash\n");
+        return false;
+    }
+    close(fd);
+    unlink(path);
+
+    ok &= powerCycle(out, path, "knob B turned five detents, from blank flash", [out] {
+        auto ok = true;
+        boot();
+        detents(5);
+        ok &= expect(out, "program changes sent:", programChanges(), " 5");
+        ok &= expect(out, "knob B at:", knobB.read(), 5);
+        ok &= expect(out, "records written:", ::presets.writes(), 1);
+        return ok;
+    });
+    ok &= powerCycle(out, path, "restarted, turned a detent, and switched off", [out] {
+        auto ok = true;
+        boot();
+        ok &= expect(out, "program changes sent at boot:", programChanges(), " 5");
+        ok &= expect(out, "knob B at:", knobB.read(), 5);
+        hal::clearMidiOut(0);
+        detents(1);
+        ok &= expect(out, "one detent on sends:", programChanges(), " 6");
+        hal::clearMidiOut(0);
+        click();
+        ok &= expect(out, "switching off sends:", programChanges(), " 0");
+        ok &= expect(out, "records written:", ::presets.writes(), 2);
+        return ok;
+    });
+    ok &= powerCycle(out, path, "restarted while switched off", [out] {
+        auto ok = true;
+        boot();
+        ok &= expect(out, "program changes sent at boot:", programChanges(), " 0");
+        ok &= expect(out, "knob B at:", knobB.read(), 6);
+        ok &= expect(out, "channel switched on:", ChannelState::currentState[CHANNEL - 1].on, 0);
+        return ok;
+    });
+
+    // Clearing bits of the newest record, as a write cut short would, fails its CRC.
+    hal::setFlashFile(path);
+    auto newest = lastWritten();
+    uint8_t page[flash::PAGE_SIZE];
+    flash::read(newest, page, sizeof(page));
+    page[8] = 0; // the low byte of channel 1's program
+    flash::write(newest, page);
+    ok &= powerCycle(out, path, "restarted with the newest record damaged", [out] {
+        auto ok = true;
+        boot();
+        ok &= expect(out, "program changes sent at boot:", programChanges(), " 6");
+        ok &= expect(out, "knob B at:", knobB.read(), 6);
+        hal::clearMidiOut(0);
+        detents(1);
+        ok &= expect(out, "one detent on sends:", programChanges(), " 7");
+        return ok;
+    });
+    // The next page after the last good record is the damaged one, so that save went on to
+    // the next row, and is the one restored.
+    hal::setFlashFile(path);
+    auto moved = lastWritten();
+    std::fprintf(out, "  damaged record on page %zu, next saved on page %zu\n", newest, moved);
+    ok &= moved == (newest / flash::ROW_PAGES + 1) * flash::ROW_PAGES;
+    ok &= powerCycle(out, path, "restarted again", [out] {
+        boot();
+        return expect(out, "program changes sent at boot:", programChanges(), " 7");
+    });
+    unlink(path);
+    return ok;
+}
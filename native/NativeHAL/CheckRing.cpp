@@ -0,0 +1,89 @@
+/**
+ * @copyright Copyright (c) 2021 Bob Kerns
+ * License: MIT
+ */
+// EventRing stress: a thread standing in for the interrupt handlers pushes sequence numbers,
+// while the main thread drains them, as Knob::read() does.
+#include "Checks.h"
+#include <EventRing.h>
+#include <atomic>
+#include <chrono>
+#include <thread>
+
+namespace {
+    using Clock = std::chrono::steady_clock;
+
+    // Push events sequence numbers through a ring of N. With retry, the producer pushes a
+    // refused event again until it goes in, so everything must arrive; otherwise it moves on.
+    // It yields after every burst events, like edges spaced in time (0: only when refused).
+    // The consumer pauses nap_us after every nap_every events it takes (0: never). What arrives
+    // must be in order, and every refused push must be counted as an overflow, and vice versa.
+    // Both threads yield rather than spin while waiting, so this also runs on a single core.
+    template<uint32_t N>
+    bool hammer(FILE *out, const char *label, uint32_t events, bool retry, uint32_t burst,
+                uint32_t nap_every, uint32_t nap_us) {
+        EventRing<uint32_t, N> ring;
+        std::atomic<bool> go{false};
+        std::atomic<bool> done{false};
+        uint32_t refused = 0;
+        std::thread producer([&] {
+            while (!go.load(std::memory_order_acquire)) {
+                std::this_thread::yield();
+            }
+            for (uint32_t i = 0; i < events; i++) {
+                while (!ring.push(i)) {
+                    refused++;
+                    if (!retry) {
+                        break;
+                    }
+                    std::this_thread::yield();
+                }
+                if (burst && (i + 1) % burst == 0) {
+                    std::this_thread::yield();
+                }
+            }
+            done.store(true, std::memory_order_release);
+        });
+        uint32_t received = 0;
+        uint32_t last = 0;
+        bool ordered = true;
+        auto take = [&](uint32_t seq) {
+            if (received && seq <= last) {
+                ordered = false;
+            }
+            last = seq;
+            received++;
+            if (nap_every && received % nap_every == 0) {
+                std::this_thread::sleep_for(std::chrono::microseconds(nap_us));
+            }
+        };
+        auto start = Clock::now();
+        go.store(true, std::memory_order_release);
+        while (!done.load(std::memory_order_acquire)) {
+            if (!ring.drain(take)) {
+                std::this_thread::yield();
+            }
+        }
+        producer.join();
+        ring.drain(take);
+        auto ns = std::chrono::duration_cast<std::chrono::nanoseconds>(Clock::now() - start).count();
+        auto lost = events - received;
+        auto ok = ordered && ring.empty() && refused == ring.overflows()
+            && (retry ? lost == 0 : lost == refused);
+        std::fprintf(out, "  %-8s capacity %4u: %8u pushed, %8u received, %8u overflows, %6.1f ns/event, %s%s\n",
+            label, N, events, received, ring.overflows(), (double)ns / events,
+            ordered ? "in order" : "OUT OF ORDER", refused == ring.overflows() ? "" : ", MISCOUNTED");
+        return ok;
+    }
+}
+
+bool checks::ring(FILE *out) {
+    auto ok = true;
+    // Every event delivered, with the ring full much of the time.
+    ok &= hammer<32>(out, "lossless", 5000000, true, 0, 0, 0);
+    ok &= hammer<2>(out, "lossless", 2000000, true, 0, 0, 0);
+    // A consumer that keeps stalling, so events are dropped.
+    ok &= hammer<32>(out, "stalls", 1000000, false, 16, 256, 200);
+    ok &= hammer<1024>(out, "stalls", 1000000, false, 16, 4096, 2000);
+    return ok;
+}
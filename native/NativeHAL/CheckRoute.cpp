@@ -0,0 +1,113 @@
+/**
+ * @copyright Copyright (c) 2021 Bob Kerns
+ * License: MIT
+ */
+// Routing between the cables, set up over SysEx as a host would: what comes in on a routed
+// cable must go out on its destination, message for message, and nothing else may.
+#include "Checks.h"
+#include "NativeHAL.h"
+#include <USB-MIDI.h>
+#include <chrono>
+
+namespace {
+    // A SysEx command to the box.
+    std::vector<uint8_t> command(uint8_t cmd, std::initializer_list<uint8_t> args) {
+        std::vector<uint8_t> msg = {0xF0, 0x7D, 0x41, 0x4D, cmd};
+        for (auto arg : args) {
+            msg.push_back(arg);
+        }
+        msg.push_back(0xF7);
+        return msg;
+    }
+
+    // Send a command on cable 1; the box should reply with status.
+    bool configure(FILE *out, const char *what, uint8_t cmd, std::initializer_list<uint8_t> args, uint8_t status) {
+        hal::clearMidiOut(0);
+        checks::receive(1, command(cmd, args));
+        auto reply = hal::midiOut(0);
+        auto expected = std::string("\xF0\x7D\x41\x4D", 4) + char(cmd) + char(status) + '\xF7';
+        auto ok = reply == expected;
+        std::fprintf(out, "  %-44s %s%s\n", what, status ? "refused" : "done", ok ? "" : ", WRONG REPLY");
+        return ok;
+    }
+
+    // The channel messages of a stream, each with its status byte, as the box sends them.
+    std::string channelMessages(const std::vector<uint8_t> &bytes) {
+        std::string msgs;
+        uint8_t status = 0;
+        uint8_t need = 0;
+        uint8_t have = 0;
+        for (auto b : bytes) {
+            if (b >= 0xF8) {
+                continue;
+            }
+            if (b & 0x80) {
+                status = b < 0xF0 ? b : 0;
+                have = 0;
+                need = (b & 0xE0) == 0xC0 ? 1 : 2;
+                continue;
+            }
+            if (!status) {
+                continue;
+            }
+            if (!have) {
+                msgs += char(status);
+            }
+            msgs += char(b);
+            if (++have == need) {
+                have = 0;
+            }
+        }
+        return msgs;
+    }
+
+    bool forwarded(FILE *out, const char *what, uint8_t dst, const std::string &got, const std::string &expected) {
+        auto ok = got == expected;
+        size_t same = 0;
+        while (same < got.size() && same < expected.size() && got[same] == expected[same]) {
+            same++;
+        }
+        std::fprintf(out, "  %-44s %7zu bytes on cable %u, expected %7zu%s\n", what, got.size(), dst, expected.size(),
+            ok ? "" : (", DIFFERENT FROM BYTE " + std::to_string(same)).c_str());
+        return ok;
+    }
+}
+
+bool checks::route(FILE *out) {
+    auto ok = true;
+    boot();
+    for (uint8_t cable = 0; cable < 3; cable++) {
+        hal::clearMidiOut(cable);
+    }
+
+    // Everything on cable 2 to cable 3, as it came, with the handlers timed.
+    ok &= configure(out, "route cable 2, every channel, to cable 3", 0x14, {2, 0, 3, 0}, 0);
+    for (auto name : {"chords", "controllers"}) {
+        auto fixture = hal::midiFixture(name);
+        hal::clearMidiOut(2);
+        hal::replayStart();
+        auto begin = std::chrono::steady_clock::now();
+        receive(2, fixture);
+        auto ns = std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - begin).count();
+        ok &= forwarded(out, name, 3, hal::midiOut(2), channelMessages(fixture));
+        hal::replayReport(out, ns);
+    }
+
+    // One channel to another, on another cable, leaving the rest alone.
+    ok &= configure(out, "route cable 1, channel 5, to cable 2 channel 9", 0x14, {1, 5, 2, 9}, 0);
+    hal::clearMidiOut(1);
+    std::vector<uint8_t> notes = {0x94, 60, 100, 0x95, 62, 100, 0xB4, 7, 90, 0x84, 60, 0};
+    receive(1, notes);
+    ok &= forwarded(out, "channel 5 only, as channel 9", 2, hal::midiOut(1),
+        channelMessages({0x98, 60, 100, 0xB8, 7, 90, 0x88, 60, 0}));
+
+    // Unrouted, nothing more goes through; out of range, nothing changes.
+    ok &= configure(out, "unroute cable 2, every channel, from cable 3", 0x15, {2, 0, 3}, 0);
+    hal::clearMidiOut(2);
+    receive(2, notes);
+    ok &= forwarded(out, "after unrouting", 3, hal::midiOut(2), "");
+    ok &= configure(out, "route cable 4", 0x14, {4, 0, 1, 0}, 1);
+    ok &= configure(out, "route channel 17", 0x14, {1, 17, 2, 0}, 1);
+    ok &= configure(out, "route with too few arguments", 0x14, {1, 1, 2}, 1);
+    return ok;
+}
@@ -0,0 +1,168 @@
+/**
+ * @copyright Copyright (c) 2021 Bob Kerns
+ * License: MIT
+ */
+// Knobs as controllers, swept over their whole range: how many messages a sweep costs for each
+// kind of controller, how many sending only the LSB saves, and that the receiver ends up with
+// every value sent.
+#include "Checks.h"
+#include "NativeHAL.h"
+#include <Controller.h>
+
+namespace {
+    const char *const KINDS[] = {"CC", "CC14", "NRPN"};
+    const uint8_t CHANNEL = 1;
+    const uint16_t NUMBERS[] = {7, 1, 1234};
+
+    // A receiver of the first cable's controllers, as a synthesizer keeps them: an MSB clears
+    // its LSB, and data entry goes to the NRPN last selected.
+    class Receiver {
+        public:
+            uint32_t messages = 0;
+
+            void feed() {
+                auto bytes = hal::midiOut(0);
+                for (; m_next + 2 < bytes.size(); m_next += 3) {
+                    uint8_t status = bytes[m_next];
+                    uint8_t n = bytes[m_next + 1];
+                    uint8_t v = bytes[m_next + 2];
+                    if (status != (0xB0 | (CHANNEL - 1))) {
+                        continue;
+                    }
+                    messages++;
+                    m_cc[n] = v;
+                    if (n < 32) {
+                        m_cc[n + 32] = 0;
+                    }
+                    if (n == 6) {
+                        m_nrpn = v << 7;
+                    } else if (n == 38) {
+                        m_nrpn = (m_nrpn & ~0x7f) | v;
+                    }
+                }
+            }
+
+            uint16_t value(ControlKind kind, uint16_t number) const {
+                switch (kind) {
+                    case ControlKind::CC:
+                        return m_cc[number];
+                    case ControlKind::CC14:
+                        return m_cc[number] << 7 | m_cc[number + 32];
+                    default:
+                        return ((m_cc[99] << 7 | m_cc[98]) == number) ? m_nrpn : ControlEncoder::NONE;
+                }
+            }
+
+        private:
+            size_t m_next = 0;
+            uint8_t m_cc[128] = {};
+            uint16_t m_nrpn = 0;
+    };
+
+    // Every step of a sweep sent, with the value sent before it or, as before the LSB-only
+    // sends, with NONE. The receiver must have each value as it is sent.
+    bool encoderSweep(FILE *out, ControlKind kind, uint16_t step, bool lsbOnly, uint32_t &messages) {
+        auto number = NUMBERS[uint8_t(kind)];
+        auto max = kind == ControlKind::CC ? 127 : 16383;
+        ControlEncoder encoder(CABLE1);
+        Receiver receiver;
+        hal::clearMidiOut(0);
+        uint32_t wrong = 0;
+        uint16_t previous = ControlEncoder::NONE;
+        uint32_t sends = 0;
+        for (int32_t value = 0; value <= max; value += step) {
+            encoder.send(kind, CHANNEL, number, value, lsbOnly ? previous : ControlEncoder::NONE);
+            previous = value;
+            sends++;
+            receiver.feed();
+            wrong += receiver.value(kind, number) != value;
+        }
+        messages = encoder.messages();
+        std::fprintf(out, "  %-4s %-12s %5u sends, %5u messages, %4.2f per send%s\n",
+            KINDS[uint8_t(kind)], kind == ControlKind::CC ? "" : lsbOnly ? "LSB only" : "MSB and LSB",
+            sends, messages, double(messages) / sends, wrong ? "  RECEIVER WRONG" : "");
+        return !wrong && receiver.messages == messages;
+    }
+
+    // As a knob turns: a change every millisecond through ControlOutput, from 0 to the top in
+    // sweep_ms, thinned to one send per CONTROL_INTERVAL_MS. The last value must arrive.
+    bool knobSweep(FILE *out, ControlKind kind, uint32_t sweep_ms) {
+        auto number = NUMBERS[uint8_t(kind)];
+        ControlOutput output(controlEncoder);
+        output.configure(kind, CHANNEL, number);
+        auto max = output.maxValue();
+        Receiver receiver;
+        hal::clearMidiOut(0);
+        controlEncoder.forget();
+        auto before = controlEncoder.messages();
+        for (uint32_t ms = 0; ms <= sweep_ms; ms++) {
+            output.change(max * ms / sweep_ms);
+            checks::idle(1);
+        }
+        checks::idle(CONTROL_SETTLE_MS * 2);
+        receiver.feed();
+        auto messages = controlEncoder.messages() - before;
+        auto got = receiver.value(kind, number);
+        std::fprintf(out, "  %-4s turned over %2u s:  %5u messages; receiver at %5u of %5u%s\n",
+            KINDS[uint8_t(kind)], sweep_ms / 1000, messages, got, max, got == max ? "" : "  WRONG");
+        output.disable();
+        return got == max;
+    }
+
+    // Turned slowly, a step at a time, with a threshold the steps stay under: nothing is sent
+    // while the knob moves, and the last value once it has rested for CONTROL_SETTLE_MS.
+    bool restingSweep(FILE *out, uint16_t threshold, uint32_t step_ms) {
+        ControlOutput output(controlEncoder);
+        output.configure(ControlKind::CC, CHANNEL, NUMBERS[0], threshold);
+        Receiver receiver;
+        hal::clearMidiOut(0);
+        controlEncoder.forget();
+        output.change(64);
+        checks::idle(CONTROL_SETTLE_MS * 2);
+        receiver.feed();
+        auto before = receiver.messages;
+        const uint16_t STEPS = 20;
+        for (uint16_t i = 1; i <= STEPS; i++) {
+            output.change(64 + i % threshold);
+            checks::idle(step_ms);
+        }
+        receiver.feed();
+        auto moving = receiver.messages - before;
+        checks::idle(CONTROL_SETTLE_MS * 2);
+        receiver.feed();
+        auto rested = receiver.messages - before - moving;
+        auto got = receiver.value(ControlKind::CC, NUMBERS[0]);
+        auto expected = 64 + STEPS % threshold;
+        auto ok = !moving && rested == 1 && got == expected;
+        std::fprintf(out, "  CC   %2u steps under %u, %3u ms apart: %u sent moving, %u at rest, receiver at %u%s\n",
+            STEPS, threshold, step_ms, moving, rested, got, ok ? "" : "  WRONG");
+        output.disable();
+        return ok;
+    }
+}
+
+bool checks::sweep(FILE *out) {
+    auto ok = true;
+    boot();
+    // A 14-bit sweep in steps of 16 changes the MSB every eighth step.
+    for (auto kind : {ControlKind::CC, ControlKind::CC14, ControlKind::NRPN}) {
+        auto step = kind == ControlKind::CC ? 1 : 16;
+        uint32_t full = 0;
+        uint32_t lsb = 0;
+        ok &= encoderSweep(out, kind, step, false, full);
+        if (kind != ControlKind::CC) {
+            ok &= encoderSweep(out, kind, step, true, lsb);
+            std::fprintf(out, "  %-4s LSB only saves %.0f%% of the messages\n",
+                KINDS[uint8_t(kind)], 100.0 * (full - lsb) / full);
+        }
+    }
+    // Turned slowly, a 14-bit knob's sends mostly stay within an MSB.
+    for (auto sweep_ms : {1000, 10000}) {
+        for (auto kind : {ControlKind::CC, ControlKind::CC14, ControlKind::NRPN}) {
+            ok &= knobSweep(out, kind, sweep_ms);
+        }
+    }
+    // Small changes wait for the knob to rest, not for the first of them to age.
+    ok &= restingSweep(out, 8, CONTROL_SETTLE_MS / 2);
+    return ok;
+}
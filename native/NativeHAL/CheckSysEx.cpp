@@ -0,0 +1,150 @@
+/**
+ * @copyright Copyright (c) 2021 Bob Kerns
+ * License: MIT
+ */
+// The SysEx parser, fed as the MIDI library delivers a message too long for its buffer: the
+// first piece F0 ... F0, the middle ones F7 ... F0, and the last F7 ... F7, with the rest of
+// the stream going on in between. Each command must be answered once, from the whole message,
+// and the MIDI in between handled as it arrives. Then a knob bound over SysEx, or moved by a
+// program change, must turn on from the program it shows.
+#include "Checks.h"
+#include "NativeHAL.h"
+#include <AltoidMidi.h>
+#include <SysEx.h>
+
+namespace {
+    // Knob B, bound to channel 3 here.
+    const int CLK = A1;
+    const int DT = A2;
+    const uint8_t CHANNEL = 3;
+    const uint8_t NOTE = 60;
+
+    std::vector<uint8_t> command(uint8_t cmd, const std::vector<uint8_t> &args) {
+        std::vector<uint8_t> msg = {0xF0, sysex::MANUFACTURER, sysex::ID1, sysex::ID2, cmd};
+        for (auto arg : args) {
+            msg.push_back(arg);
+        }
+        msg.push_back(0xF7);
+        return msg;
+    }
+
+    std::string reply(uint8_t cmd, const std::string &status) {
+        return std::string("\xF0\x7D\x41\x4D", 4) + char(cmd) + status + '\xF7';
+    }
+
+    // Deliver msg on a cable in pieces of size data bytes, as the MIDI library does, with a note
+    // on and off received between each piece and the next. Each note must be taken as it
+    // arrives, whatever part of the SysEx has come.
+    bool split(const std::vector<uint8_t> &msg, uint8_t cable, size_t size, uint32_t &pieces) {
+        auto ok = true;
+        auto &keys = ChannelState::currentState[CHANNEL - 1].keys;
+        std::vector<uint8_t> data(msg.begin() + 1, msg.end() - 1);
+        pieces = 0;
+        for (size_t at = 0; at < data.size(); at += size) {
+            auto last = at + size >= data.size();
+            std::vector<uint8_t> piece = {uint8_t(at == 0 ? 0xF0 : 0xF7)};
+            piece.insert(piece.end(), data.begin() + at, data.begin() + std::min(at + size, data.size()));
+            piece.push_back(last ? 0xF7 : 0xF0);
+            onSysEx(cable, piece.data(), piece.size());
+            pieces++;
+            if (!last) {
+                checks::receive(cable, {uint8_t(0x90 | (CHANNEL - 1)), NOTE, 100});
+                ok &= keys.count() == 1;
+                checks::receive(cable, {uint8_t(0x80 | (CHANNEL - 1)), NOTE, 0});
+                ok &= keys.allUp();
+            }
+        }
+        return ok;
+    }
+
+    // Send a command in pieces; the reply must come once, on the same cable, after the last.
+    bool configure(FILE *out, const char *what, uint8_t cable, size_t size, uint8_t cmd,
+                   const std::vector<uint8_t> &args, const std::string &status) {
+        hal::clearMidiOut(cable - 1);
+        uint32_t pieces;
+        auto notes = split(command(cmd, args), cable, size, pieces);
+        auto ok = notes && hal::midiOut(cable - 1) == reply(cmd, status);
+        std::fprintf(out, "  %-44s %u pieces, reply %02x%s%s\n", what, pieces,
+            hal::midiOut(cable - 1).size() > 5 ? uint8_t(hal::midiOut(cable - 1)[5]) : 0xff,
+            notes ? "" : ", NOTES LOST", ok ? "" : ", WRONG REPLY");
+        return ok;
+    }
+
+    // Names for a menu, and the MENU_ITEMS arguments that set them.
+    std::vector<uint8_t> items(uint8_t menu, uint8_t count, char tag) {
+        std::vector<uint8_t> args = {menu};
+        for (uint8_t i = 0; i < count; i++) {
+            for (auto c : std::string("Kit ") + tag + char('A' + i / 26) + char('a' + i % 26)) {
+                args.push_back(c);
+            }
+            args.push_back(0);
+        }
+        return args;
+    }
+
+    // The program change sent on the first cable for the channel since the last clearMidiOut().
+    int programSent() {
+        auto &bytes = hal::midiOut(0);
+        for (size_t i = 0; i + 1 < bytes.size(); i++) {
+            if (uint8_t(bytes[i]) == (0xC0 | (CHANNEL - 1))) {
+                return uint8_t(bytes[i + 1]);
+            }
+        }
+        return -1;
+    }
+
+    // One detent on knob B, slowly, and the program it sends.
+    bool detent(FILE *out, const char *what, int expected) {
+        hal::clearMidiOut(0);
+        checks::turn(CLK, DT, 4);
+        checks::idle(1000);
+        auto sent = programSent();
+        std::fprintf(out, "  %-44s program %d%s\n", what, sent, sent == expected ? "" : "  WRONG");
+        return sent == expected;
+    }
+}
+
+bool checks::sysex(FILE *out) {
+    auto ok = true;
+    boot();
+    const std::string OK(1, char(sysex::OK));
+    const std::string BAD(1, char(sysex::BAD_ARGUMENTS));
+
+    // Commands of a few bytes, a byte or two to a piece.
+    ok &= configure(out, "bind knob B to channel 3, 1-byte pieces", 1, 1, sysex::KNOB_BIND, {1, CHANNEL, 0}, OK);
+    ok &= configure(out, "bind with too few arguments, 2-byte pieces", 1, 2, sysex::KNOB_BIND, {1, CHANNEL}, BAD);
+
+    // 40 names, 320 characters, in the library's 128-byte pieces.
+    auto kits = items(1, 40, 'x');
+    ok &= configure(out, "40 kit names, 128-byte pieces", 2, 126, sysex::MENU_ITEMS, kits, OK + char(40));
+    auto named = std::string(kitMenu.item(39)) == "Kit xBn";
+    std::fprintf(out, "  %-44s %s%s\n", "last kit name", kitMenu.item(39), named ? "" : "  WRONG");
+    ok &= named;
+
+    // An upload on cable 1 taken over by one on cable 2 before it ends.
+    hal::clearMidiOut(0);
+    hal::clearMidiOut(1);
+    auto first = command(sysex::MENU_ITEMS, items(1, 10, 'y'));
+    auto second = command(sysex::MENU_ITEMS, items(1, 5, 'z'));
+    std::vector<uint8_t> start = {first.begin(), first.begin() + 20};
+    start.push_back(0xF0);
+    onSysEx(1, start.data(), start.size());
+    onSysEx(2, second.data(), second.size());
+    std::vector<uint8_t> rest = {0xF7};
+    rest.insert(rest.end(), first.begin() + 20, first.end());
+    onSysEx(1, rest.data(), rest.size());
+    auto taken = hal::midiOut(0) == reply(sysex::MENU_ITEMS, std::string(1, char(sysex::BUSY)) + char(0))
+        && hal::midiOut(1) == reply(sysex::MENU_ITEMS, OK + char(5))
+        && std::string(kitMenu.item(4)) == "Kit zAe" && kitMenu.size() == 5;
+    std::fprintf(out, "  %-44s %s\n", "upload taken over by another cable", taken ? "first busy, second done" : "WRONG");
+    ok &= taken;
+
+    // Bound, the knob starts from the channel's program; a program change received moves it.
+    receive(1, {uint8_t(0xC0 | (CHANNEL - 1)), 9});
+    ok &= configure(out, "rebind after program 9 arrived", 1, 64, sysex::KNOB_BIND, {1, CHANNEL, 0}, OK);
+    ok &= detent(out, "one detent after binding", 10);
+    checks::idle(1000);
+    receive(1, {uint8_t(0xC0 | (CHANNEL - 1)), 20});
+    ok &= detent(out, "one detent after program 20 arrived", 21);
+    return ok;
+}
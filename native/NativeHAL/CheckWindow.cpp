@@ -0,0 +1,281 @@
+/**
+ * @copyright Copyright (c) 2021 Bob Kerns
+ * License: MIT
+ */
+// Window drawing primitives: what each costs through Window&, as the widgets call them, both in
+// the window itself (over a display that only counts calls) and all the way into the frame
+// buffer, beside the std::function translation it replaced; and that they clip to the window
+// and send the drawing state only when it changes.
+#include "Checks.h"
+#include <DisplayMgr.h>
+#include <Widget.h>
+#include "Window.cpp"
+#include <chrono>
+#include <functional>
+
+namespace {
+    using Clock = std::chrono::steady_clock;
+
+    // Counts what the window asks of it, and keeps the last rectangle and text.
+    class CountingDisplay {
+        public:
+            uint32_t calls = 0;
+            uint32_t state = 0;
+            lcdint_t x1 = 0, y1 = 0, x2 = 0, y2 = 0;
+            std::string text;
+
+            lcduint_t width() const { return 128; }
+            lcduint_t height() const { return 64; }
+            void begin() {}
+            void end() {}
+            void setFont(NanoFont &) { state++; }
+            void setColor(uint16_t) { state++; }
+            void setBackground(uint16_t) { state++; }
+
+            void putPixel(lcdint_t x, lcdint_t y) { rect(x, y, x, y); }
+            void drawVLine(lcdint_t x, lcdint_t y1, lcdint_t y2) { rect(x, y1, x, y2); }
+            void drawHLine(lcdint_t x1, lcdint_t y, lcdint_t x2) { rect(x1, y, x2, y); }
+            void fillRect(lcdint_t x1, lcdint_t y1, lcdint_t x2, lcdint_t y2) { rect(x1, y1, x2, y2); }
+            void scroll(lcdint_t x1, lcdint_t y1, lcdint_t x2, lcdint_t y2, lcdint_t) { rect(x1, y1, x2, y2); }
+            void drawXBitmap(lcdint_t x, lcdint_t y, lcduint_t w, lcduint_t h, const uint8_t *) { area(x, y, w, h); }
+            void drawBitmap1(lcdint_t x, lcdint_t y, lcduint_t w, lcduint_t h, const uint8_t *) { area(x, y, w, h); }
+            void gfx_drawMonoBitmap(lcdint_t x, lcdint_t y, lcduint_t w, lcduint_t h, const uint8_t *) { area(x, y, w, h); }
+            void drawBitmap4(lcdint_t x, lcdint_t y, lcduint_t w, lcduint_t h, const uint8_t *) { area(x, y, w, h); }
+            void drawBitmap8(lcdint_t x, lcdint_t y, lcduint_t w, lcduint_t h, const uint8_t *) { area(x, y, w, h); }
+            void drawBitmap16(lcdint_t x, lcdint_t y, lcduint_t w, lcduint_t h, const uint8_t *) { area(x, y, w, h); }
+            void drawBuffer1(lcdint_t x, lcdint_t y, lcduint_t w, lcduint_t h, const uint8_t *) { area(x, y, w, h); }
+            void drawBuffer4(lcdint_t x, lcdint_t y, lcduint_t w, lcduint_t h, const uint8_t *) { area(x, y, w, h); }
+            void drawBuffer8(lcdint_t x, lcdint_t y, lcduint_t w, lcduint_t h, const uint8_t *) { area(x, y, w, h); }
+            void drawBuffer16(lcdint_t x, lcdint_t y, lcduint_t w, lcduint_t h, const uint8_t *) { area(x, y, w, h); }
+            void clear() { calls++; }
+            void fill(uint16_t) { calls++; }
+            uint8_t printChar(uint8_t) { calls++; return 1; }
+            size_t write(uint8_t) { calls++; return 1; }
+            void printFixed(lcdint_t x, lcdint_t y, const char *ch, EFontStyle) { rect(x, y, x, y); text = ch; }
+            void printFixedN(lcdint_t x, lcdint_t y, const char *ch, EFontStyle, uint8_t) { rect(x, y, x, y); text = ch; }
+
+        private:
+            void rect(lcdint_t a, lcdint_t b, lcdint_t c, lcdint_t d) { calls++; x1 = a; y1 = b; x2 = c; y2 = d; }
+            void area(lcdint_t x, lcdint_t y, lcduint_t w, lcduint_t h) { rect(x, y, x + w - 1, y + h - 1); }
+    };
+
+    // The window as it was: virtual primitives, each wrapping its display call in a
+    // std::function for xlate() or xlate2() to translate, which sent the font and both colors
+    // every time. Only the primitives timed here.
+    class OldWindow {
+        public:
+            virtual ~OldWindow() = default;
+            virtual void putPixel(lcdint_t x, lcdint_t y) = 0;
+            virtual void drawVLine(lcdint_t x1, lcdint_t y1, lcdint_t y2) = 0;
+            virtual void drawHLine(lcdint_t x1, lcdint_t y1, lcdint_t x2) = 0;
+            virtual void fillRect(lcdint_t x1, lcdint_t y1, lcdint_t x2, lcdint_t y2) = 0;
+            virtual void scroll(lcdint_t x1, lcdint_t y1, lcdint_t x2, lcdint_t y2, lcdint_t dy) = 0;
+            virtual void drawBitmap1(lcdint_t x, lcdint_t y, lcduint_t w, lcduint_t h, const uint8_t *bitmap) = 0;
+            virtual void printFixed(lcdint_t x, lcdint_t y, const char *ch, EFontStyle style) = 0;
+
+        protected:
+            lcdint_t m_offset_x = 0;
+            lcdint_t m_offset_y = 0;
+            lcdint_t m_w = 128;
+            lcdint_t m_h = 64;
+
+            void xlateArea(lcdint_t x, lcdint_t y, lcdint_t w, lcdint_t h, std::function<void (lcdint_t x, lcdint_t y, lcdint_t w, lcdint_t h)> fn) {
+                setState();
+                lcdint_t tx = max(m_offset_x, x + m_offset_x);
+                lcdint_t ty = max(m_offset_y, y + m_offset_y);
+                lcdint_t tw = max(0, min(w, (m_w - x)));
+                lcdint_t th = max(0, min(h, (m_h - y)));
+                fn(tx, ty, tw, th);
+            }
+            void xlate(lcdint_t x, lcdint_t y, std::function<void (lcdint_t x, lcdint_t y, lcdint_t w, lcdint_t h)> fn) {
+                xlateArea(x, y, m_w, m_h, fn);
+            }
+            void xlate2(lcdint_t x1, lcdint_t y1, lcdint_t x2, lcdint_t y2, std::function<void (lcdint_t x1, lcdint_t y1, lcdint_t x2, lcdint_t y2)> fn) {
+                setState();
+                fn(max(m_offset_x, x1 + m_offset_x), max(m_offset_y, y1 + m_offset_y), max(m_offset_x, x2 + m_offset_x), max(m_offset_y, y2 + m_offset_y));
+            }
+            virtual void setState() = 0;
+    };
+
+    class OldWindowImpl: public OldWindow {
+        public:
+            OldWindowImpl(CountingDisplay &display): _display(display) {}
+
+            void putPixel(lcdint_t x, lcdint_t y) {
+                xlate(x, y, [this](auto x, auto y, auto, auto) { _display.putPixel(x, y); });
+            }
+            void drawVLine(lcdint_t x1, lcdint_t y1, lcdint_t y2) {
+                xlate2(x1, y1, x1, y2, [this](auto x1, auto y1, auto, auto y2) { _display.drawVLine(x1, y1, y2); });
+            }
+            void drawHLine(lcdint_t x1, lcdint_t y1, lcdint_t x2) {
+                xlate2(x1, y1, x2, y1, [this](auto x1, auto y1, auto x2, auto) { _display.drawHLine(x1, y1, x2); });
+            }
+            void fillRect(lcdint_t x1, lcdint_t y1, lcdint_t x2, lcdint_t y2) {
+                xlate2(x1, y1, x2, y2, [this](auto x1, auto y1, auto x2, auto y2) { _display.fillRect(x1, y1, x2, y2); });
+            }
+            void scroll(lcdint_t x1, lcdint_t y1, lcdint_t x2, lcdint_t y2, lcdint_t dy) {
+                xlate2(x1, y1, x2, y2, [this, dy](auto x1, auto y1, auto x2, auto y2) { _display.scroll(x1, y1, x2, y2, dy); });
+            }
+            void drawBitmap1(lcdint_t x, lcdint_t y, lcduint_t w, lcduint_t h, const uint8_t *bitmap) {
+                xlateArea(x, y, w, h, [this, bitmap](auto x, auto y, auto w, auto h) { _display.drawBitmap1(x, y, w, h, bitmap); });
+            }
+            void printFixed(lcdint_t x, lcdint_t y, const char *ch, EFontStyle style) {
+                xlate(x, y, [this, ch, style](auto x, auto y, auto, auto) { _display.printFixed(x, y, ch, style); });
+            }
+
+        private:
+            CountingDisplay &_display;
+            NanoFont m_font;
+
+            void setState() {
+                _display.setFont(m_font);
+                _display.setColor(0xffff);
+                _display.setBackground(0);
+            }
+    };
+
+    const uint8_t BITMAP[16] = {0xff, 0x81, 0x81, 0x81, 0x81, 0x81, 0x81, 0xff,
+                                0xff, 0x81, 0x81, 0x81, 0x81, 0x81, 0x81, 0xff};
+
+    struct Primitive {
+        const char *name;
+        void (*draw)(Window &w, uint32_t i);
+        void (*before)(OldWindow &w, uint32_t i);
+    };
+
+    // The same call through both windows.
+#define PRIMITIVE(name, call) {name, [](Window &w, uint32_t i) { call; }, [](OldWindow &w, uint32_t i) { call; }}
+
+    // Each varies a little from call to call, as drawing does, and stays within the screen.
+    const Primitive PRIMITIVES[] = {
+        PRIMITIVE("putPixel", w.putPixel(i & 63, 5)),
+        PRIMITIVE("drawHLine", w.drawHLine(i & 7, 5, 60)),
+        PRIMITIVE("drawVLine", w.drawVLine(i & 63, 0, 15)),
+        PRIMITIVE("fillRect 16x8", w.fillRect(i & 7, 8, (i & 7) + 15, 15)),
+        PRIMITIVE("drawBitmap1 8x16", w.drawBitmap1(i & 63, 0, 8, 16, BITMAP)),
+        PRIMITIVE("scroll 64x16", w.scroll(0, 0, 63, 15, i & 1 ? 1 : -1)),
+        PRIMITIVE("printFixed 8 chars", w.printFixed(i & 7, 0, "Piano 12", STYLE_NORMAL)),
+    };
+
+#undef PRIMITIVE
+
+    template<typename W>
+    double timeNs(W &w, void (*draw)(W &w, uint32_t i), uint32_t calls) {
+        auto begin = Clock::now();
+        for (uint32_t i = 0; i < calls; i++) {
+            draw(w, i);
+        }
+        auto ns = std::chrono::duration_cast<std::chrono::nanoseconds>(Clock::now() - begin).count();
+        return (double)ns / calls;
+    }
+
+    bool clipped(FILE *out, CountingDisplay &counter, const char *what,
+                 lcdint_t x1, lcdint_t y1, lcdint_t x2, lcdint_t y2) {
+        auto ok = counter.x1 == x1 && counter.y1 == y1 && counter.x2 == x2 && counter.y2 == y2;
+        std::fprintf(out, "  %-40s (%d,%d)-(%d,%d)%s\n", what, counter.x1, counter.y1, counter.x2, counter.y2,
+            ok ? "" : "  WRONG");
+        return ok;
+    }
+
+    bool printed(FILE *out, CountingDisplay &counter, const char *what, lcdint_t x, lcdint_t y, const char *text) {
+        auto ok = counter.x1 == x && counter.y1 == y && counter.text == text;
+        std::fprintf(out, "  %-40s (%d,%d) \"%s\"%s\n", what, counter.x1, counter.y1, counter.text.c_str(),
+            ok ? "" : "  WRONG");
+        return ok;
+    }
+}
+
+template class WindowImpl<CountingDisplay>;
+
+bool checks::window(FILE *out) {
+    auto ok = true;
+    const uint32_t CALLS = 2000000;
+    static CountingDisplay counter;
+    static WindowImpl<CountingDisplay> counted(counter);
+    static OldWindowImpl old(counter);
+    counted.setFixedFont(ssd1306xled_font6x8);
+    display.setFixedFont(ssd1306xled_font6x8);
+    Window &window = counted;
+    Window &drawn = display;
+
+    // Before is the old window over the counting display; its state sends are three a call.
+    std::fprintf(out, "  %-20s %12s %12s %12s %12s %12s\n", "ns per call", "before", "in Window", "to pixels",
+        "state before", "state now");
+    for (auto &p : PRIMITIVES) {
+        auto state = counter.state;
+        auto before = timeNs(static_cast<OldWindow &>(old), p.before, CALLS);
+        auto state_before = counter.state - state;
+        state = counter.state;
+        auto calls = counter.calls;
+        auto in_window = timeNs(window, p.draw, CALLS);
+        auto all = timeNs(drawn, p.draw, CALLS / 10);
+        auto sent = counter.calls - calls;
+        std::fprintf(out, "  %-20s %12.1f %12.1f %12.1f %12u %12u\n", p.name, before, in_window, all,
+            state_before, counter.state - state);
+        ok &= sent == CALLS;
+    }
+
+    // The state goes once, and again only for what changed.
+    auto state = counter.state;
+    window.setColor(0);
+    window.fillRect(0, 0, 1, 1);
+    window.fillRect(0, 0, 1, 1);
+    window.setColor(0xffff);
+    window.fillRect(0, 0, 1, 1);
+    std::fprintf(out, "  %u state sends for two color changes over three fills\n", counter.state - state);
+    ok &= counter.state - state == 2;
+
+    // A widget's window, at (100, 20) on the 128x64 display, clips to both ends of each axis.
+    window.setOffset(100, 20);
+    window.fillRect(0, 0, 50, 50);
+    ok &= clipped(out, counter, "fillRect past the right and bottom", 100, 20, 127, 63);
+    window.fillRect(-10, -10, 5, 5);
+    ok &= clipped(out, counter, "fillRect before the left and top", 100, 20, 105, 25);
+    window.drawHLine(-5, 3, 40);
+    ok &= clipped(out, counter, "drawHLine across the window", 100, 23, 127, 23);
+    auto calls = counter.calls;
+    window.putPixel(30, 0);
+    window.fillRect(-20, 0, -1, 10);
+    ok &= counter.calls == calls;
+    std::fprintf(out, "  outside the window: %u calls\n", counter.calls - calls);
+
+    // The knob's title, 96 by 16 at (0, 0), in 6x8 glyphs: text and bitmaps stay within it.
+    window.setOffset(0, 0);
+    window.setSize(96, 16);
+    window.printFixed(0, 0, "Electric Grand Piano 2", STYLE_NORMAL);
+    ok &= printed(out, counter, "printFixed past the right", 0, 0, "Electric Grand P");
+    window.printFixed(0, 0, "Piano\nElectric Grand Piano 2", STYLE_NORMAL);
+    ok &= printed(out, counter, "printFixed, two lines", 0, 8, "Electric Grand P");
+    window.printFixedN(40, 0, "Piano", STYLE_NORMAL, FONT_SIZE_2X);
+    ok &= printed(out, counter, "printFixedN at twice the size", 40, 0, "Pian");
+    window.drawBitmap1(0, 8, 8, 16, BITMAP);
+    ok &= clipped(out, counter, "drawBitmap1 past the bottom", 0, 8, 7, 15);
+    calls = counter.calls;
+    window.printFixed(0, 12, "Piano", STYLE_NORMAL);
+    window.printFixed(92, 0, "Piano", STYLE_NORMAL);
+    window.drawBitmap1(90, 0, 8, 16, BITMAP);
+    ok &= counter.calls == calls;
+    std::fprintf(out, "  text too low or narrow, bitmap past the right: %u calls\n", counter.calls - calls);
+    window.setSize(128, 64);
+
+    // The same title into the frame buffer: nothing reaches the number beside it.
+    Label title(0, 0, 96, 16, "Electric Grand Piano 2");
+    drawn.setOffset(0, 0);
+    drawn.clear();
+    title.render(drawn, true);
+    auto buffer = static_cast<FrameDisplay &>(display).getBuffer();
+    uint32_t spilled = 0;
+    uint32_t lit = 0;
+    for (lcduint_t page = 0; page < FrameDisplay::PAGES; page++) {
+        for (lcduint_t x = 0; x < FrameDisplay::WIDTH; x++) {
+            auto bits = buffer[page * FrameDisplay::WIDTH + x];
+            (x < 96 && page < 2 ? lit : spilled) += bits != 0;
+        }
+    }
+    std::fprintf(out, "  label of 22 characters in 96 pixels: %u columns lit, %u outside%s\n", lit, spilled,
+        spilled ? "  WRONG" : "");
+    ok &= lit && !spilled;
+    drawn.clear();
+    window.setOffset(0, 0);
+    return ok;
+}
@@ -0,0 +1,107 @@
+/**
+ * @copyright Copyright (c) 2021 Bob Kerns
+ * License: MIT
+ */
+#include "Checks.h"
+#include "NativeHAL.h"
+#include <USB-MIDI.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+namespace {
+    struct Check {
+        const char *name;
+        bool (*run)(FILE *out);
+    };
+
+    const Check CHECKS[] = {
+        {"ring", checks::ring},
+        {"knob", checks::knob},
+        {"accel", checks::acceleration},
+        {"callback", checks::callback},
+        {"route", checks::route},
+        {"latency", checks::latency},
+        {"window", checks::window},
+        {"clock", checks::clock},
+        {"sweep", checks::sweep},
+        {"presets", checks::presets},
+        {"sysex", checks::sysex},
+        {"banks", checks::banks},
+    };
+
+    int runOne(const Check &check, FILE *out) {
+        std::fprintf(out, "%s:\n", check.name);
+        auto ok = check.run(out);
+        std::fprintf(out, "%s %s\n", ok ? "PASS" : "FAIL", check.name);
+        return ok ? 0 : 1;
+    }
+}
+
+void checks::boot() {
+    for (auto pin : {A0, A1, A2, A3, A6, A7, A8, A9, A10}) {
+        hal::setPin(pin, HIGH);
+    }
+    setup();
+    idle(1000);
+}
+
+void checks::idle(uint32_t ms) {
+    for (uint32_t i = 0; i < ms * 10; i++) {
+        loop();
+        hal::advance(100);
+    }
+}
+
+void checks::receive(uint8_t cable, const std::vector<uint8_t> &bytes) {
+    hal::midiIn(cable - 1, bytes.data(), bytes.size());
+    auto input = usbMidi::usbMidiTransport::cables[cable - 1];
+    while (input && !input->input.empty()) {
+        loop();
+        hal::advance(100);
+    }
+    loop();
+}
+
+void checks::turn(int clk, int dt, int counts) {
+    for (; counts; counts += counts > 0 ? -1 : 1) {
+        // Clockwise, clk leads: it changes when the pins are equal, dt when they differ.
+        auto equal = digitalRead(clk) == digitalRead(dt);
+        auto pin = (equal == (counts > 0)) ? clk : dt;
+        hal::setPin(pin, !digitalRead(pin));
+    }
+}
+
+int checks::run(const std::string &name, FILE *out) {
+    if (name == "all") {
+        int failed = 0;
+        for (auto &check : CHECKS) {
+            std::fflush(out);
+            auto pid = fork();
+            if (pid == 0) {
+                auto status = runOne(check, out);
+                std::fflush(out);
+                _exit(status);
+            }
+            int status = 1;
+            if (pid < 0 || waitpid(pid, &status, 0) < 0 || !WIFEXITED(status) || WEXITSTATUS(status)) {
+                if (pid < 0 || !WIFEXITED(status)) {
+                    std::fprintf(out, "FAIL %s (did not finish)\n", check.name);
+                }
+                failed++;
+            }
+        }
+        std::fprintf(out, "%d of %zu checks failed\n", failed, sizeof(CHECKS) / sizeof(CHECKS[0]));
+        return failed ? 1 : 0;
+    }
+    for (auto &check : CHECKS) {
+        if (name == check.name) {
+            return runOne(check, out);
+        }
+    }
+    std::fprintf(out, "no check %s; there are:", name.c_str());
+    for (auto &check : CHECKS) {
+        std::fprintf(out, " %s", check.name);
+    }
+    std::fprintf(out, " all\n");
+    return 2;
+}
@@ -0,0 +1,60 @@
+/**
+ * @copyright Copyright (c) 2021 Bob Kerns
+ * License: MIT
+ */
+// Host-side checks and benchmarks of the firmware's parts, run with -c <name>. Each prints what
+// it measured, and returns false if a result is wrong; timings are reported, not judged.
+#pragma once
+#include <cstdio>
+#include <string>
+#include <vector>
+
+namespace checks {
+    // EventRing between a producer thread and a consumer: order and overflow accounting.
+    bool ring(FILE *out);
+    // Knob interrupt handler: cost per edge, and steps missed when turned faster than read(),
+    // beside the switch decoder it replaced.
+    bool knob(FILE *out);
+    // Knob acceleration: the multiplier for slow, fast and mid-ramp steps, after reversing,
+    // and at the ends of a range, with and without wrapping.
+    bool acceleration(FILE *out);
+    // Callback trampolines: dispatch cost against the std::function table they replaced, and
+    // claiming, refusing and freeing slots.
+    bool callback(FILE *out);
+
+    // Routing between cables: a SysEx route carries every channel message to its destination.
+    bool route(FILE *out);
+    // MIDI latency while a full-screen update goes out over 400 kHz I2C.
+    bool latency(FILE *out);
+    // Window drawing primitives: cost per call against the std::function translation they
+    // replaced, clipping, and drawing state sent only on change.
+    bool window(FILE *out);
+    // MidiClock tempo from jittered, lossy and doubled clock streams, and what tick() costs.
+    bool clock(FILE *out);
+    // Controller knobs swept over their range: messages per sweep, and what LSB-only sends save.
+    bool sweep(FILE *out);
+    // Presets across restarts: programs and knob positions restored, a damaged record passed
+    // over, and a part-written page skipped.
+    bool presets(FILE *out);
+    // SysEx split into the MIDI library's pieces, with notes in between: one reply per command,
+    // and every note handled; and a knob bound or moved by a program change turns on from there.
+    bool sysex(FILE *out);
+    // Menus with banks: incoming bank and program matched to entries, and bank select sent first.
+    bool banks(FILE *out);
+
+    // Run setup(), with the knobs' pins pulled up, and then loop() until the firmware is ready.
+    void boot();
+    // Call loop() for ms of virtual time, 100 microseconds a pass.
+    void idle(uint32_t ms);
+    // Queue bytes on a cable (1-3), and call loop() until it has taken them all.
+    void receive(uint8_t cable, const std::vector<uint8_t> &bytes);
+
+    // Turn an encoder on pins clk and dt by counts quadrature edges, one count each; negative
+    // is counterclockwise. Each edge fires the pin's interrupt, as hal::setPin does.
+    void turn(int clk, int dt, int counts);
+
+    // Run the named check, or with "all" each check in a process of its own, so each starts
+    // from a freshly loaded firmware.
+    // @returns the exit status: 0 if everything passed, 1 if not, 2 if there is no such check.
+    int run(const std::string &name, FILE *out);
+}
@@ -0,0 +1,24 @@
+/**
+ * @copyright Copyright (c) 2021 Bob Kerns
+ * License: MIT
+ */
+// Generated by tools/patchlists.py from native/patches/banked.csv. Do not edit.
+#include <Arduino.h>
+#include "FixturePatches.h"
+
+static const char names[] PROGMEM =
+    "Grand Piano Wide\0" "Drawbar Organ 2\0" "Tine EP Chorus\0" "Drawbar Organ\0"
+    "GM Piano Wide\0" "Bright Piano\0" "Grand Piano\0" "Square Lead\0" "GM Piano\0"
+    "Strings\0" "Tine EP\0" "Rhodes\0";
+
+static const uint16_t banked_offsets[] PROGMEM = {
+    89, 76, 0, 130, 33, 138, 48, 17, 122, 113, 62, 101
+};
+
+// MSB, LSB, program
+static const uint8_t banked_patches[] PROGMEM = {
+    0, 0, 0, 0, 0, 1, 0, 1, 0, 8, 0, 4, 8, 2, 4,
+    0, 0, 4, 16, 0, 16, 16, 1, 16, 0, 0, 48, 121, 0, 0,
+    121, 1, 0, 0, 0, 80
+};
+const NamePool banked = {12, banked_offsets, names, banked_patches};
@@ -0,0 +1,10 @@
+/**
+ * @copyright Copyright (c) 2021 Bob Kerns
+ * License: MIT
+ */
+// Generated by tools/patchlists.py from native/patches/banked.csv. Do not edit.
+#pragma once
+#include <NamePool.h>
+
+// 12 names, with banks, from banked.csv.
+extern const NamePool banked;
@@ -0,0 +1,315 @@
+/**
+ * @copyright Copyright (c) 2021 Bob Kerns
+ * License: MIT
+ */
+// Replay of recorded MIDI through the firmware's handlers: built-in captures, Standard MIDI
+// File flattening, and per-handler timing and allocation counts.
+#include <Arduino.h>
+#include <USB-MIDI.h>
+#include "NativeHAL.h"
+#include <algorithm>
+#include <chrono>
+#include <cstdlib>
+#include <new>
+
+namespace {
+    bool replaying = false;
+    // Allocations made while inside a handler.
+    uint64_t handler_allocs = 0;
+    // Nesting depth of HandlerTiming; allocations only count inside a handler.
+    int depth = 0;
+
+    struct TypeStats {
+        uint64_t count = 0;
+        uint64_t allocs = 0;
+        std::vector<uint32_t> ns;
+    };
+    TypeStats stats[256];
+
+    uint64_t wallNs() {
+        return std::chrono::duration_cast<std::chrono::nanoseconds>(
+            std::chrono::steady_clock::now().time_since_epoch()).count();
+    }
+
+    const char *typeName(uint8_t type) {
+        switch (type) {
+            case midi::NoteOff: return "NoteOff";
+            case midi::NoteOn: return "NoteOn";
+            case midi::AfterTouchPoly: return "AfterTouchPoly";
+            case midi::ControlChange: return "ControlChange";
+            case midi::ProgramChange: return "ProgramChange";
+            case midi::AfterTouchChannel: return "AfterTouchChannel";
+            case midi::PitchBend: return "PitchBend";
+            case midi::SystemExclusive: return "SystemExclusive";
+            case midi::TimeCodeQuarterFrame: return "TimeCode";
+            case midi::SongPosition: return "SongPosition";
+            case midi::SongSelect: return "SongSelect";
+            case midi::TuneRequest: return "TuneRequest";
+            case midi::Clock: return "Clock";
+            case midi::Start: return "Start";
+            case midi::Continue: return "Continue";
+            case midi::Stop: return "Stop";
+            case midi::ActiveSensing: return "ActiveSensing";
+            case midi::SystemReset: return "SystemReset";
+            default: return "?";
+        }
+    }
+
+    uint32_t percentile(std::vector<uint32_t> &v, unsigned pct) {
+        if (v.empty()) {
+            return 0;
+        }
+        auto i = (v.size() - 1) * pct / 100;
+        std::nth_element(v.begin(), v.begin() + i, v.end());
+        return v[i];
+    }
+
+    // Channels with knobs (1, 10, 16, 0-based), so the handlers' per-channel state is exercised.
+    const uint8_t KNOB_CHANNELS[] = {0, 9, 15};
+
+    // Ten-note chords, struck and released together, as a keyboard's USB port sends them:
+    // explicit status for the first note of each chord, running status for the rest, and
+    // note-on with velocity 0 for the releases.
+    std::vector<uint8_t> chords() {
+        std::vector<uint8_t> out;
+        for (int n = 0; n < 3000; n++) {
+            uint8_t ch = KNOB_CHANNELS[n % 3];
+            uint8_t root = 36 + (n * 7) % 48;
+            for (int off = 0; off < 2; off++) {
+                out.push_back(midi::NoteOn | ch);
+                for (int k = 0; k < 10; k++) {
+                    out.push_back(root + k * 4);
+                    out.push_back(off ? 0 : 64 + k);
+                }
+            }
+        }
+        return out;
+    }
+
+    // Sweeps of the mod wheel (CC 1/33, 14-bit), expression, pitch bend and channel pressure,
+    // with running status, and an occasional program change in between.
+    std::vector<uint8_t> controllers() {
+        std::vector<uint8_t> out;
+        for (int n = 0; n < 2000; n++) {
+            uint8_t ch = KNOB_CHANNELS[n % 3];
+            out.push_back(midi::ControlChange | ch);
+            for (int v = 0; v < 8; v++) {
+                auto value = (n * 8 + v) & 0x3fff;
+                out.insert(out.end(), {1, uint8_t(value >> 7), 33, uint8_t(value & 0x7f), 11, uint8_t(v * 16)});
+            }
+            out.push_back(midi::PitchBend | ch);
+            for (int v = 0; v < 8; v++) {
+                auto bend = (n * 512 + v * 64) & 0x3fff;
+                out.insert(out.end(), {uint8_t(bend & 0x7f), uint8_t(bend >> 7)});
+            }
+            out.push_back(midi::AfterTouchChannel | ch);
+            for (int v = 0; v < 8; v++) {
+                out.push_back((n + v * 16) & 0x7f);
+            }
+            if (n % 100 == 99) {
+                out.insert(out.end(), {uint8_t(midi::ProgramChange | ch), uint8_t((n / 100) % 24)});
+            }
+        }
+        return out;
+    }
+
+    // A sequencer playing: 24 clocks a beat, a note on each sixteenth released at the next, and
+    // every 50 bars a stop, a song position back to bar 9, and a continue, as when looping a section.
+    std::vector<uint8_t> sequencer() {
+        std::vector<uint8_t> out;
+        out.push_back(midi::Start);
+        for (int bar = 0; bar < 500; bar++) {
+            uint8_t ch = KNOB_CHANNELS[bar % 3];
+            for (int tick = 0; tick < 96; tick++) {
+                out.push_back(midi::Clock);
+                if (tick % 6 == 0) {
+                    uint8_t note = 48 + tick / 6;
+                    out.insert(out.end(), {uint8_t(midi::NoteOn | ch), note, 100, uint8_t(note - 1), 0});
+                }
+            }
+            if (bar % 50 == 49) {
+                out.insert(out.end(), {midi::Stop, midi::SongPosition, 0, 1, midi::Continue});
+            }
+        }
+        return out;
+    }
+
+    struct SmfReader {
+        const std::vector<uint8_t> &in;
+        size_t pos;
+        bool ok = true;
+        uint8_t byte() {
+            if (pos >= in.size()) {
+                ok = false;
+                return 0;
+            }
+            return in[pos++];
+        }
+        uint32_t be(int n) {
+            uint32_t v = 0;
+            while (n--) v = (v << 8) | byte();
+            return v;
+        }
+        uint32_t varlen() {
+            uint32_t v = 0;
+            uint8_t b;
+            int n = 0;
+            do {
+                b = byte();
+                v = (v << 7) | (b & 0x7f);
+            } while ((b & 0x80) && ok && ++n < 4);
+            return v;
+        }
+    };
+
+    struct SmfEvent {
+        uint64_t tick;
+        uint32_t order;
+        std::vector<uint8_t> bytes;
+    };
+
+    std::vector<uint8_t> flattenSmf(const std::vector<uint8_t> &in) {
+        SmfReader r{in, 0};
+        std::vector<SmfEvent> events;
+        uint32_t order = 0;
+        while (r.ok && r.pos + 8 <= in.size()) {
+            auto id = r.be(4);
+            auto len = r.be(4);
+            auto end = std::min<size_t>(r.pos + len, in.size());
+            if (id != 0x4d54726b) { // "MTrk"; skip the header and unknown chunks
+                r.pos = end;
+                continue;
+            }
+            uint64_t tick = 0;
+            uint8_t status = 0;
+            while (r.ok && r.pos < end) {
+                tick += r.varlen();
+                auto b = r.byte();
+                if (b == 0xff) {
+                    r.byte();
+                    r.pos += r.varlen();
+                    continue;
+                }
+                SmfEvent ev{tick, order++, {}};
+                if (b == midi::SystemExclusive || b == midi::SystemExclusiveEnd) {
+                    auto n = r.varlen();
+                    if (b == midi::SystemExclusive) ev.bytes.push_back(b);
+                    for (uint32_t i = 0; i < n && r.ok; i++) ev.bytes.push_back(r.byte());
+                    status = 0;
+                } else {
+                    if (b & 0x80) {
+                        status = b;
+                    } else {
+                        r.pos--;
+                    }
+                    if (!status) {
+                        r.ok = false;
+                        break;
+                    }
+                    uint8_t n = (status & 0xe0) == 0xc0 ? 1 : 2;
+                    ev.bytes.push_back(status);
+                    while (n--) ev.bytes.push_back(r.byte());
+                }
+                events.push_back(std::move(ev));
+            }
+            r.pos = end;
+        }
+        std::stable_sort(events.begin(), events.end(), [](const SmfEvent &a, const SmfEvent &b) {
+            return a.tick < b.tick || (a.tick == b.tick && a.order < b.order);
+        });
+        std::vector<uint8_t> out;
+        for (auto &ev : events) {
+            out.insert(out.end(), ev.bytes.begin(), ev.bytes.end());
+        }
+        return out;
+    }
+}
+
+void *operator new(size_t size) {
+    if (depth > 0) {
+        handler_allocs++;
+    }
+    if (auto p = std::malloc(size ? size : 1)) {
+        return p;
+    }
+    throw std::bad_alloc();
+}
+
+void operator delete(void *p) noexcept {
+    std::free(p);
+}
+
+void operator delete(void *p, size_t) noexcept {
+    std::free(p);
+}
+
+midi::HandlerTiming::HandlerTiming(byte type): type(type), start_ns(0), start_allocs(handler_allocs) {
+    if (replaying) {
+        depth++;
+        start_ns = wallNs();
+    }
+}
+
+midi::HandlerTiming::~HandlerTiming() {
+    if (replaying) {
+        auto ns = wallNs() - start_ns;
+        depth--;
+        auto &s = stats[type];
+        s.count++;
+        s.allocs += handler_allocs - start_allocs;
+        // Outside the counted region, so the sample storage is not charged to the handler.
+        auto saved = depth;
+        depth = 0;
+        s.ns.push_back(static_cast<uint32_t>(std::min<uint64_t>(ns, UINT32_MAX)));
+        depth = saved;
+    }
+}
+
+std::vector<uint8_t> hal::midiFixture(const std::string &name) {
+    if (name == "chords") {
+        return chords();
+    } else if (name == "controllers") {
+        return controllers();
+    } else if (name == "clock") {
+        return sequencer();
+    }
+    return {};
+}
+
+std::vector<uint8_t> hal::midiStream(const std::vector<uint8_t> &contents) {
+    if (contents.size() >= 14 && std::equal(contents.begin(), contents.begin() + 4, "MThd")) {
+        return flattenSmf(contents);
+    }
+    return contents;
+}
+
+void hal::replayStart() {
+    for (auto &s : stats) {
+        s = TypeStats();
+    }
+    handler_allocs = 0;
+    replaying = true;
+}
+
+void hal::replayReport(FILE *out, uint64_t loop_ns) {
+    replaying = false;
+    uint64_t messages = 0;
+    uint64_t allocs = 0;
+    for (auto &s : stats) {
+        messages += s.count;
+        allocs += s.allocs;
+    }
+    std::fprintf(out, "%llu messages, %.0f messages/s of loop() time, %.2f allocations/message\n",
+        (unsigned long long)messages, loop_ns ? messages * 1e9 / loop_ns : 0.0,
+        messages ? (double)allocs / messages : 0.0);
+    std::fprintf(out, "%-18s %10s %10s %10s %12s\n", "type", "count", "p50 ns", "p99 ns", "allocs/msg");
+    for (unsigned t = 0; t < 256; t++) {
+        auto &s = stats[t];
+        if (s.count) {
+            auto p50 = percentile(s.ns, 50);
+            auto p99 = percentile(s.ns, 99);
+            std::fprintf(out, "%-18s %10llu %10u %10u %12.2f\n", typeName(t),
+                (unsigned long long)s.count, p50, p99, (double)s.allocs / s.count);
+        }
+    }
+}
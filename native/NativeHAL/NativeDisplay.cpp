@@ -0,0 +1,262 @@
+/**
+ * @copyright Copyright (c) 2021 Bob Kerns
+ * License: MIT
+ */
+// Native stand-in for the lcdgfx SSD1306 driver and its fixed fonts.
+#include "lcdgfx.h"
+#include "NativeHAL.h"
+
+NanoFont g_canvas_font;
+
+namespace {
+    // Synthetic fixed font in the lcdgfx layout. The glyph shapes are arbitrary but distinct,
+    // so that changing a character changes the pixels.
+    template<uint8_t W, uint8_t H>
+    struct FixedFont {
+        static const unsigned PAGES = (H + 7) / 8;
+        static const unsigned CHARS = 96;
+        uint8_t data[4 + CHARS * PAGES * W];
+        constexpr FixedFont(): data() {
+            data[0] = 0x00;
+            data[1] = W;
+            data[2] = H;
+            data[3] = ' ';
+            // Leave the space (and the last column of each glyph) blank.
+            for (unsigned c = 1; c < CHARS; c++) {
+                for (unsigned p = 0; p < PAGES; p++) {
+                    for (unsigned col = 0; col < W - 1u; col++) {
+                        data[4 + (c * PAGES + p) * W + col] = static_cast<uint8_t>(((c + ' ') * 0x9d) ^ (col * 0x3b) ^ (p * 0xa5));
+                    }
+                }
+            }
+        }
+    };
+
+    constexpr FixedFont<6, 8> font6x8;
+    constexpr FixedFont<8, 16> font8x16;
+}
+
+const uint8_t *const ssd1306xled_font6x8 = font6x8.data;
+const uint8_t *const ssd1306xled_font8x16 = font8x16.data;
+
+void NanoFont::loadFixedFont(const uint8_t *progmemFont) {
+    m_data = progmemFont;
+    m_width = progmemFont[1];
+    m_height = progmemFont[2];
+    m_first = progmemFont[3];
+    m_count = 128 - m_first;
+}
+
+void NanoFont::getCharBitmap(uint16_t ch, SCharInfo *info) const {
+    info->width = m_width;
+    info->height = m_height;
+    info->spacing = m_spacing;
+    info->glyph = m_data && ch >= m_first && ch < m_first + m_count
+        ? m_data + 4 + (ch - m_first) * ((m_height + 7) >> 3) * m_width
+        : nullptr;
+}
+
+void DisplaySSD1306_128x64_I2C::begin() {
+    clear();
+}
+
+namespace {
+    uint32_t i2c_byte_ns = 0;
+    uint32_t i2c_pending_ns = 0;
+    uint64_t first_data = UINT64_MAX;
+}
+
+void hal::setI2cByteTime(uint32_t ns) {
+    i2c_byte_ns = ns;
+}
+
+uint64_t hal::firstDisplayData() {
+    return first_data;
+}
+
+void DisplaySSD1306_128x64_I2C::send(lcdint_t x, lcdint_t page, uint8_t data) {
+    if (x >= 0 && x < (lcdint_t)WIDTH && page >= 0 && page < (lcdint_t)PAGES) {
+        m_gdram[page * WIDTH + x] = data;
+        m_bytes_sent++;
+        if (first_data == UINT64_MAX) {
+            first_data = hal::now();
+        }
+        // Blocking transfer: the time passes while the byte goes out.
+        i2c_pending_ns += i2c_byte_ns;
+        if (i2c_pending_ns >= 1000) {
+            hal::advance(i2c_pending_ns / 1000);
+            i2c_pending_ns %= 1000;
+        }
+    }
+}
+
+template<typename F>
+void DisplaySSD1306_128x64_I2C::area(lcdint_t x, lcdint_t y, lcduint_t w, lcduint_t h, F on) {
+    if (!w || !h) {
+        return;
+    }
+    lcdint_t y2 = y + (lcdint_t)h - 1;
+    for (lcdint_t page = std::max(0, y >> 3); page <= std::min((lcdint_t)PAGES - 1, y2 >> 3); page++) {
+        uint8_t mask = 0;
+        for (lcdint_t bit = 0; bit < 8; bit++) {
+            auto row = page * 8 + bit;
+            if (row >= y && row <= y2) {
+                mask |= 1 << bit;
+            }
+        }
+        for (lcduint_t col = 0; col < w; col++) {
+            auto cx = x + (lcdint_t)col;
+            if (cx < 0 || cx >= (lcdint_t)WIDTH) {
+                continue;
+            }
+            uint8_t bits = 0;
+            for (lcdint_t bit = 0; bit < 8; bit++) {
+                if ((mask & (1 << bit)) && on(col, page * 8 + bit - y)) {
+                    bits |= 1 << bit;
+                }
+            }
+            auto old = m_gdram[page * WIDTH + cx];
+            send(cx, page, (old & ~mask) | (blend(bits) & mask));
+        }
+    }
+}
+
+void DisplaySSD1306_128x64_I2C::putPixel(lcdint_t x, lcdint_t y) {
+    area(x, y, 1, 1, [](lcduint_t, lcduint_t){ return true; });
+}
+
+void DisplaySSD1306_128x64_I2C::drawVLine(lcdint_t x1, lcdint_t y1, lcdint_t y2) {
+    area(x1, std::min(y1, y2), 1, std::abs(y2 - y1) + 1, [](lcduint_t, lcduint_t){ return true; });
+}
+
+void DisplaySSD1306_128x64_I2C::drawHLine(lcdint_t x1, lcdint_t y1, lcdint_t x2) {
+    area(std::min(x1, x2), y1, std::abs(x2 - x1) + 1, 1, [](lcduint_t, lcduint_t){ return true; });
+}
+
+void DisplaySSD1306_128x64_I2C::fillRect(lcdint_t x1, lcdint_t y1, lcdint_t x2, lcdint_t y2) {
+    area(std::min(x1, x2), std::min(y1, y2), std::abs(x2 - x1) + 1, std::abs(y2 - y1) + 1,
+        [](lcduint_t, lcduint_t){ return true; });
+}
+
+void DisplaySSD1306_128x64_I2C::drawXBitmap(lcdint_t x, lcdint_t y, lcduint_t w, lcduint_t h, const uint8_t *bitmap) {
+    auto stride = (w + 7) / 8;
+    area(x, y, w, h, [bitmap, stride](lcduint_t col, lcduint_t row){
+        return (bitmap[row * stride + col / 8] >> (col & 7)) & 1;
+    });
+}
+
+void DisplaySSD1306_128x64_I2C::drawBitmap1(lcdint_t x, lcdint_t y, lcduint_t w, lcduint_t h, const uint8_t *bitmap) {
+    area(x, y, w, h, [bitmap, w](lcduint_t col, lcduint_t row){
+        return (bitmap[(row / 8) * w + col] >> (row & 7)) & 1;
+    });
+}
+
+void DisplaySSD1306_128x64_I2C::gfx_drawMonoBitmap(lcdint_t x, lcdint_t y, lcduint_t w, lcduint_t h, const uint8_t *buf) {
+    drawBitmap1(x, y, w, h, buf);
+}
+
+void DisplaySSD1306_128x64_I2C::drawBitmap4(lcdint_t x, lcdint_t y, lcduint_t w, lcduint_t h, const uint8_t *bitmap) {
+    area(x, y, w, h, [bitmap, w](lcduint_t col, lcduint_t row){
+        auto i = row * w + col;
+        return ((bitmap[i / 2] >> ((i & 1) * 4)) & 0x0f) != 0;
+    });
+}
+
+void DisplaySSD1306_128x64_I2C::drawBitmap8(lcdint_t x, lcdint_t y, lcduint_t w, lcduint_t h, const uint8_t *bitmap) {
+    area(x, y, w, h, [bitmap, w](lcduint_t col, lcduint_t row){
+        return bitmap[row * w + col] != 0;
+    });
+}
+
+void DisplaySSD1306_128x64_I2C::drawBitmap16(lcdint_t x, lcdint_t y, lcduint_t w, lcduint_t h, const uint8_t *bitmap) {
+    area(x, y, w, h, [bitmap, w](lcduint_t col, lcduint_t row){
+        auto i = 2 * (row * w + col);
+        return (bitmap[i] | bitmap[i + 1]) != 0;
+    });
+}
+
+void DisplaySSD1306_128x64_I2C::drawBuffer1(lcdint_t x, lcdint_t y, lcduint_t w, lcduint_t h, const uint8_t *buffer) {
+    drawBitmap1(x, y, w, h, buffer);
+}
+
+void DisplaySSD1306_128x64_I2C::drawBuffer4(lcdint_t x, lcdint_t y, lcduint_t w, lcduint_t h, const uint8_t *buffer) {
+    drawBitmap4(x, y, w, h, buffer);
+}
+
+void DisplaySSD1306_128x64_I2C::drawBuffer8(lcdint_t x, lcdint_t y, lcduint_t w, lcduint_t h, const uint8_t *buffer) {
+    drawBitmap8(x, y, w, h, buffer);
+}
+
+void DisplaySSD1306_128x64_I2C::drawBuffer16(lcdint_t x, lcdint_t y, lcduint_t w, lcduint_t h, const uint8_t *buffer) {
+    drawBitmap16(x, y, w, h, buffer);
+}
+
+void DisplaySSD1306_128x64_I2C::clear() {
+    for (lcduint_t i = 0; i < PAGES * WIDTH; i++) {
+        send(i % WIDTH, i / WIDTH, 0);
+    }
+}
+
+void DisplaySSD1306_128x64_I2C::fill(uint16_t color) {
+    for (lcduint_t i = 0; i < PAGES * WIDTH; i++) {
+        send(i % WIDTH, i / WIDTH, color & 0xff);
+    }
+}
+
+void DisplaySSD1306_128x64_I2C::glyph(lcdint_t x, lcdint_t y, uint8_t c, EFontStyle style, uint8_t factor) {
+    SCharInfo info;
+    m_font->getCharBitmap(c, &info);
+    auto data = info.glyph;
+    auto fw = info.width;
+    auto scale = 1u << factor;
+    area(x, y, (fw + info.spacing) * scale, info.height * scale, [data, fw, style, scale](lcduint_t col, lcduint_t row){
+        auto gx = col / scale;
+        auto gy = row / scale;
+        if (!data || gx >= fw) {
+            return false;
+        }
+        auto bits = data[(gy / 8) * fw + gx];
+        if (style == STYLE_BOLD && gx > 0) {
+            bits |= data[(gy / 8) * fw + gx - 1];
+        }
+        return ((bits >> (gy & 7)) & 1) != 0;
+    });
+}
+
+uint8_t DisplaySSD1306_128x64_I2C::printChar(uint8_t c) {
+    if (!m_font) {
+        return 0;
+    }
+    SCharInfo info;
+    m_font->getCharBitmap(c, &info);
+    if (c == '\n') {
+        m_cursorX = 0;
+        m_cursorY += info.height;
+        return 1;
+    }
+    glyph(m_cursorX, m_cursorY, c, STYLE_NORMAL, 0);
+    m_cursorX += info.width + info.spacing;
+    return 1;
+}
+
+size_t DisplaySSD1306_128x64_I2C::write(uint8_t c) {
+    return printChar(c);
+}
+
+void DisplaySSD1306_128x64_I2C::printFixed(lcdint_t xpos, lcdint_t y, const char *ch, EFontStyle style) {
+    printFixedN(xpos, y, ch, style, 0);
+}
+
+void DisplaySSD1306_128x64_I2C::printFixedN(lcdint_t xpos, lcdint_t y, const char *ch, EFontStyle style, uint8_t factor) {
+    if (!m_font) {
+        return;
+    }
+    SCharInfo info;
+    m_font->getCharBitmap(' ', &info);
+    // Like lcdgfx, text is placed on page boundaries.
+    y &= ~7;
+    auto advance = (info.width + info.spacing) << factor;
+    for (; *ch && xpos < (lcdint_t)WIDTH; ch++, xpos += advance) {
+        glyph(xpos, y, static_cast<uint8_t>(*ch), style, factor);
+    }
+}
@@ -0,0 +1,76 @@
+/**
+ * @copyright Copyright (c) 2021 Bob Kerns
+ * License: MIT
+ */
+// Native stand-in for the preset flash: an image in RAM, optionally kept in a file so presets
+// survive from one run to the next. Erases and writes take as long on the virtual clock as
+// they do on the SAMD21.
+#include "NativeHAL.h"
+#include <Flash.h>
+#include <cstring>
+
+namespace {
+    const uint32_t erase_us = 6000;
+    const uint32_t write_us = 2500;
+
+    uint8_t image[flash::ROWS * flash::ROW_SIZE];
+    bool loaded = false;
+    std::string file;
+    uint64_t busy_until = 0;
+
+    void load() {
+        if (loaded) {
+            return;
+        }
+        loaded = true;
+        std::memset(image, 0xff, sizeof(image));
+        if (!file.empty()) {
+            if (auto in = std::fopen(file.c_str(), "rb")) {
+                std::fread(image, 1, sizeof(image), in);
+                std::fclose(in);
+            }
+        }
+    }
+
+    void store() {
+        if (!file.empty()) {
+            if (auto out = std::fopen(file.c_str(), "wb")) {
+                std::fwrite(image, 1, sizeof(image), out);
+                std::fclose(out);
+            }
+        }
+    }
+}
+
+void hal::setFlashFile(const std::string &path) {
+    file = path;
+    loaded = false;
+}
+
+bool flash::busy() {
+    return hal::now() < busy_until;
+}
+
+void flash::read(size_t page, void *data, size_t len) {
+    load();
+    std::memcpy(data, image + page * PAGE_SIZE, len);
+}
+
+void flash::erase(size_t row) {
+    load();
+    std::memset(image + row * ROW_SIZE, 0xff, ROW_SIZE);
+    busy_until = hal::now() + erase_us;
+    store();
+}
+
+void flash::write(size_t page, const void *data) {
+    load();
+    // Like flash, writing can only clear bits.
+    auto src = static_cast<const uint8_t *>(data);
+    auto dst = image + page * PAGE_SIZE;
+    for (size_t i = 0; i < PAGE_SIZE; i++) {
+        dst[i] &= src[i];
+    }
+    busy_until = hal::now() + write_us;
+    store();
+}
@@ -0,0 +1,337 @@
+/**
+ * @copyright Copyright (c) 2021 Bob Kerns
+ * License: MIT
+ */
+// Native implementation of the Arduino core subset, plus main() to drive setup() and loop()
+// against a virtual clock.
+#include <Arduino.h>
+#include <USB-MIDI.h>
+#include "NativeHAL.h"
+#include "Checks.h"
+#include <chrono>
+#include <cstdio>
+#include <fstream>
+#include <iterator>
+#include <vector>
+#include <unistd.h>
+
+namespace {
+    uint64_t clock_us = 0;
+
+    struct Pin {
+        uint32_t mode = INPUT;
+        bool driven = false;
+        int level = LOW;
+        int output = LOW;
+        voidFuncPtr isr = nullptr;
+        uint32_t isr_mode = CHANGE;
+        bool pending = false;
+    };
+    Pin pins[NUM_DIGITAL_PINS];
+
+    bool interrupts_enabled = true;
+    uint32_t isr_count = 0;
+
+    const uint64_t NEVER = UINT64_MAX;
+    uint64_t first_midi_read = NEVER;
+
+    int inputLevel(const Pin &p) {
+        if (p.driven) {
+            return p.level;
+        }
+        switch (p.mode) {
+            case INPUT_PULLUP:
+                return HIGH;
+            case OUTPUT:
+                return p.output;
+            default:
+                return LOW;
+        }
+    }
+
+    // Run an ISR the way the NVIC would: with further interrupts held off.
+    void runIsr(Pin &p) {
+        p.pending = false;
+        if (p.isr) {
+            interrupts_enabled = false;
+            isr_count++;
+            p.isr();
+            interrupts_enabled = true;
+        }
+    }
+
+    bool triggers(uint32_t mode, int before, int after) {
+        switch (mode) {
+            case CHANGE: return before != after;
+            case RISING: return before == LOW && after == HIGH;
+            case FALLING: return before == HIGH && after == LOW;
+            case LOW: return after == LOW;
+            case HIGH: return after == HIGH;
+            default: return false;
+        }
+    }
+}
+
+usbMidi::usbMidiTransport *usbMidi::usbMidiTransport::cables[usbMidi::usbMidiTransport::MAX_CABLES];
+
+usbMidi::usbMidiTransport::usbMidiTransport(uint8_t cableNumber): cableNumber(cableNumber) {
+    if (cableNumber < MAX_CABLES) {
+        cables[cableNumber] = this;
+    }
+}
+
+byte usbMidi::usbMidiTransport::read() {
+    if (first_midi_read == NEVER) {
+        first_midi_read = clock_us;
+    }
+    auto b = input.front();
+    input.pop_front();
+    return b;
+}
+
+unsigned long millis() {
+    return static_cast<unsigned long>(clock_us / 1000);
+}
+
+unsigned long micros() {
+    return static_cast<unsigned long>(clock_us);
+}
+
+void delay(unsigned long ms) {
+    hal::advance(ms * 1000);
+}
+
+void delayMicroseconds(unsigned int us) {
+    hal::advance(us);
+}
+
+void pinMode(uint32_t pin, uint32_t mode) {
+    if (pin < NUM_DIGITAL_PINS) {
+        pins[pin].mode = mode;
+    }
+}
+
+void digitalWrite(uint32_t pin, uint32_t val) {
+    if (pin < NUM_DIGITAL_PINS) {
+        pins[pin].output = val ? HIGH : LOW;
+    }
+}
+
+int digitalRead(uint32_t pin) {
+    return pin < NUM_DIGITAL_PINS ? inputLevel(pins[pin]) : LOW;
+}
+
+void attachInterrupt(uint32_t interrupt, voidFuncPtr callback, uint32_t mode) {
+    if (interrupt < NUM_DIGITAL_PINS) {
+        pins[interrupt].isr = callback;
+        pins[interrupt].isr_mode = mode;
+        pins[interrupt].pending = false;
+    }
+}
+
+void detachInterrupt(uint32_t interrupt) {
+    if (interrupt < NUM_DIGITAL_PINS) {
+        pins[interrupt].isr = nullptr;
+        pins[interrupt].pending = false;
+    }
+}
+
+void noInterrupts() {
+    interrupts_enabled = false;
+}
+
+void interrupts() {
+    interrupts_enabled = true;
+    for (auto &p : pins) {
+        if (p.pending) {
+            runIsr(p);
+        }
+    }
+}
+
+USBDeviceClass USBDevice;
+Serial_ Serial;
+
+void Serial_::flush() {
+    std::fflush(stdout);
+}
+
+size_t Serial_::write(uint8_t c) {
+    std::putchar(c);
+    return 1;
+}
+
+size_t Serial_::print(const char *str) {
+    return std::fputs(str, stdout) < 0 ? 0 : std::strlen(str);
+}
+
+size_t Serial_::println(const char *str) {
+    return print(str) + println();
+}
+
+size_t Serial_::println() {
+    return write('\r') + write('\n');
+}
+
+uint64_t hal::now() {
+    return clock_us;
+}
+
+void hal::advance(uint32_t us) {
+    clock_us += us;
+}
+
+void hal::setPin(uint32_t pin, int level) {
+    if (pin >= NUM_DIGITAL_PINS) {
+        return;
+    }
+    auto &p = pins[pin];
+    auto before = inputLevel(p);
+    p.driven = true;
+    p.level = level ? HIGH : LOW;
+    if (p.isr && triggers(p.isr_mode, before, p.level)) {
+        if (interrupts_enabled) {
+            runIsr(p);
+        } else {
+            p.pending = true;
+        }
+    }
+}
+
+void hal::releasePin(uint32_t pin) {
+    if (pin < NUM_DIGITAL_PINS) {
+        auto before = inputLevel(pins[pin]);
+        pins[pin].driven = false;
+        auto after = inputLevel(pins[pin]);
+        if (after != before) {
+            pins[pin].driven = true;
+            pins[pin].level = before;
+            setPin(pin, after);
+            pins[pin].driven = false;
+        }
+    }
+}
+
+int hal::pinOutput(uint32_t pin) {
+    return pin < NUM_DIGITAL_PINS ? pins[pin].output : LOW;
+}
+
+void hal::midiIn(uint8_t cable, const uint8_t *data, size_t len) {
+    auto transport = cable < usbMidi::usbMidiTransport::MAX_CABLES ? usbMidi::usbMidiTransport::cables[cable] : nullptr;
+    if (transport) {
+        transport->input.insert(transport->input.end(), data, data + len);
+    }
+}
+
+const std::string &hal::midiOut(uint8_t cable) {
+    static const std::string none;
+    auto transport = cable < usbMidi::usbMidiTransport::MAX_CABLES ? usbMidi::usbMidiTransport::cables[cable] : nullptr;
+    return transport ? transport->output : none;
+}
+
+void hal::clearMidiOut(uint8_t cable) {
+    auto transport = cable < usbMidi::usbMidiTransport::MAX_CABLES ? usbMidi::usbMidiTransport::cables[cable] : nullptr;
+    if (transport) {
+        transport->output.clear();
+    }
+}
+
+uint64_t hal::firstMidiRead() {
+    return first_midi_read;
+}
+
+uint32_t hal::isrCount() {
+    return isr_count;
+}
+
+// Run the sketch for a fixed number of loop() iterations of virtual time, then report wall time.
+//   -n <loops>     number of loop() calls (default 100000)
+//   -t <us>        virtual microseconds per loop() call (default 100)
+//   -m <file>      MIDI to receive on the first cable: a Standard MIDI File, or raw bytes
+//   -f <fixture>   built-in MIDI to receive on the first cable: chords, controllers or clock
+//   -r             replay: stop once the MIDI is consumed, and report handler costs
+//   -i <ns>        simulated I2C time per display byte (default 0; 400 kHz is 22500)
+//   -p <file>      file holding the preset flash, kept from run to run
+//   -c <check>     instead, run a check or benchmark (see Checks.h), or all of them
+int main(int argc, char **argv) {
+    unsigned long loops = 100000;
+    unsigned long step_us = 100;
+    bool replay = false;
+    std::vector<uint8_t> midi;
+    std::string check;
+    int opt;
+    while ((opt = getopt(argc, argv, "n:t:m:f:ri:p:c:")) != -1) {
+        switch (opt) {
+            case 'n':
+                loops = std::strtoul(optarg, nullptr, 0);
+                break;
+            case 't':
+                step_us = std::strtoul(optarg, nullptr, 0);
+                break;
+            case 'm': {
+                std::ifstream in(optarg, std::ios::binary);
+                if (!in) {
+                    std::fprintf(stderr, "%s: cannot read %s\n", argv[0], optarg);
+                    return 1;
+                }
+                auto bytes = hal::midiStream(std::vector<uint8_t>(
+                    std::istreambuf_iterator<char>(in), std::istreambuf_iterator<char>()));
+                midi.insert(midi.end(), bytes.begin(), bytes.end());
+                break;
+            }
+            case 'f': {
+                auto bytes = hal::midiFixture(optarg);
+                if (bytes.empty()) {
+                    std::fprintf(stderr, "%s: no fixture %s (chords, controllers, clock)\n", argv[0], optarg);
+                    return 1;
+                }
+                midi.insert(midi.end(), bytes.begin(), bytes.end());
+                break;
+            }
+            case 'r':
+                replay = true;
+                break;
+            case 'i':
+                hal::setI2cByteTime(std::strtoul(optarg, nullptr, 0));
+                break;
+            case 'p':
+                hal::setFlashFile(optarg);
+                break;
+            case 'c':
+                check = optarg;
+                break;
+            default:
+                std::fprintf(stderr, "usage: %s [-n loops] [-t us-per-loop] [-m midi-file] [-f fixture] [-r] [-i ns-per-i2c-byte] [-p preset-file] [-c check]\n", argv[0]);
+                return 1;
+        }
+    }
+    if (!check.empty()) {
+        return checks::run(check, stdout);
+    }
+    // The MIDI is waiting from power-on, as if the host started sending as soon as it could.
+    hal::midiIn(0, midi.data(), midi.size());
+    setup();
+    auto input = usbMidi::usbMidiTransport::cables[0];
+    if (replay) {
+        hal::replayStart();
+    }
+    auto start = std::chrono::steady_clock::now();
+    unsigned long i = 0;
+    for (; i < loops; i++) {
+        if (replay && (!input || input->input.empty())) {
+            break;
+        }
+        loop();
+        hal::advance(step_us);
+    }
+    auto elapsed = std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - start).count();
+    std::fprintf(stderr, "%lu loops, %.3f s virtual, %.3f ms wall, %.1f ns/loop\n",
+        i, clock_us / 1e6, elapsed / 1e6, i ? (double)elapsed / i : 0.0);
+    auto ms = [](uint64_t us) { return us == NEVER ? -1.0 : us / 1e3; };
+    std::fprintf(stderr, "boot: first MIDI read at %.3f ms, first display data at %.3f ms (-1: never)\n",
+        ms(hal::firstMidiRead()), ms(hal::firstDisplayData()));
+    if (replay) {
+        hal::replayReport(stderr, elapsed);
+    }
+    return 0;
+}
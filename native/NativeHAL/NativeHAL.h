@@ -0,0 +1,61 @@
+/**
+ * @copyright Copyright (c) 2021 Bob Kerns
+ * License: MIT
+ */
+// Control surface for the native build: the virtual clock, simulated pins, and MIDI input.
+// The firmware never includes this; it is for the host-side driver (main) and profiling harnesses.
+#pragma once
+#include <Arduino.h>
+#include <cstdio>
+#include <string>
+#include <vector>
+
+namespace hal {
+    // The virtual clock. Nothing advances it except these calls and delay().
+    uint64_t now();
+    void advance(uint32_t us);
+
+    // Drive an input pin from outside, as the encoder or switch would.
+    // Fires any attached interrupt, or leaves it pending if interrupts are disabled.
+    void setPin(uint32_t pin, int level);
+    // Release an externally driven pin, so it reads its pull-up/pull-down level again.
+    void releasePin(uint32_t pin);
+    // Last level written by the firmware with digitalWrite().
+    int pinOutput(uint32_t pin);
+
+    // Queue raw MIDI bytes to be received on a virtual cable (0-based, as in USBMIDI_CREATE_INSTANCE).
+    void midiIn(uint8_t cable, const uint8_t *data, size_t len);
+    // Bytes sent by the firmware on a cable since the last clearMidiOut().
+    const std::string &midiOut(uint8_t cable);
+    void clearMidiOut(uint8_t cable);
+
+    // Simulated I2C speed: each byte sent to the display advances the clock by ns nanoseconds,
+    // as a blocking transfer would. 0 (the default) makes the display free; 400 kHz I2C is 22500.
+    void setI2cByteTime(uint32_t ns);
+
+    // Keep the preset flash in a file, read at first use and rewritten after each erase or write.
+    // Without one, flash starts erased and is lost at exit.
+    void setFlashFile(const std::string &path);
+
+    // Virtual time at which the firmware first took a byte of MIDI input, and first sent
+    // pixels to the display, in microseconds; UINT64_MAX if it has not.
+    uint64_t firstMidiRead();
+    uint64_t firstDisplayData();
+
+    // Count of interrupt service routine invocations, for sanity checks.
+    uint32_t isrCount();
+
+    // MIDI replay (MidiReplay.cpp).
+    // The raw byte stream of a built-in capture: "chords" (dense chords across the knob
+    // channels), "controllers" (high-rate CC, pitch bend and aftertouch) or "clock" (a
+    // sequencer's clock and transport, with notes). Empty if unknown.
+    std::vector<uint8_t> midiFixture(const std::string &name);
+    // Raw bytes from a file's contents. A Standard MIDI File is flattened to its events in
+    // time order; anything else is taken as a raw capture.
+    std::vector<uint8_t> midiStream(const std::vector<uint8_t> &contents);
+    // Start timing handlers and counting their allocations.
+    void replayStart();
+    // Print messages per second of loop() time, and per message type the count, p50/p99 handler
+    // time and allocations per message.
+    void replayReport(FILE *out, uint64_t loop_ns);
+}
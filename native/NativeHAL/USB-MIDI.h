@@ -0,0 +1,295 @@
+/**
+ * @copyright Copyright (c) 2021 Bob Kerns
+ * License: MIT
+ */
+// Host-side stand-in for lathoub/USB-MIDI and the Arduino MIDI Library it wraps.
+// The transport is a byte queue fed by hal::midiIn(); output is captured for hal::midiOut().
+// Parsing follows the MIDI Library: one message per read(), running status, real-time
+// messages interleaved anywhere, and SysEx delivered in buffer-sized chunks.
+#pragma once
+#include <Arduino.h>
+#include <deque>
+
+#define MIDI_CHANNEL_OMNI 0
+#define MIDI_CHANNEL_OFF 17
+
+namespace usbMidi {
+    class usbMidiTransport {
+        public:
+            static const uint8_t MAX_CABLES = 16;
+            const uint8_t cableNumber;
+            explicit usbMidiTransport(uint8_t cableNumber);
+            bool available() const { return !input.empty(); }
+            byte read();
+            void write(byte b) { output.push_back(static_cast<char>(b)); }
+            std::deque<byte> input;
+            std::string output;
+            static usbMidiTransport *cables[MAX_CABLES];
+    };
+}
+
+namespace midi {
+    // Native-only instrumentation: brackets each message the interface dispatches, whether or
+    // not a handler is set, so the replay report can time handlers and count their allocations.
+    class HandlerTiming {
+        public:
+            explicit HandlerTiming(byte type);
+            ~HandlerTiming();
+        private:
+            byte type;
+            uint64_t start_ns;
+            uint64_t start_allocs;
+    };
+
+    typedef byte DataByte;
+    typedef byte Channel;
+
+    enum MidiType: uint8_t {
+        InvalidType = 0x00,
+        NoteOff = 0x80,
+        NoteOn = 0x90,
+        AfterTouchPoly = 0xA0,
+        ControlChange = 0xB0,
+        ProgramChange = 0xC0,
+        AfterTouchChannel = 0xD0,
+        PitchBend = 0xE0,
+        SystemExclusive = 0xF0,
+        TimeCodeQuarterFrame = 0xF1,
+        SongPosition = 0xF2,
+        SongSelect = 0xF3,
+        TuneRequest = 0xF6,
+        SystemExclusiveEnd = 0xF7,
+        Clock = 0xF8,
+        Start = 0xFA,
+        Continue = 0xFB,
+        Stop = 0xFC,
+        ActiveSensing = 0xFE,
+        SystemReset = 0xFF
+    };
+
+    template<class Transport>
+    class MidiInterface {
+        public:
+            static const unsigned SysExMaxSize = 128;
+            explicit MidiInterface(Transport &transport): transport(transport) {}
+
+            void begin(Channel inChannel = 1) { input_channel = inChannel; }
+            Channel getInputChannel() const { return input_channel; }
+
+            // Process at most one complete message. Returns true if one was dispatched.
+            bool read();
+
+            void sendNoteOn(DataByte note, DataByte velocity, Channel channel) { send(NoteOn, note, velocity, channel); }
+            void sendNoteOff(DataByte note, DataByte velocity, Channel channel) { send(NoteOff, note, velocity, channel); }
+            void sendControlChange(DataByte number, DataByte value, Channel channel) { send(ControlChange, number, value, channel); }
+            void sendProgramChange(DataByte program, Channel channel) { send(ProgramChange, program, 0, channel); }
+            void sendAfterTouch(DataByte pressure, Channel channel) { send(AfterTouchChannel, pressure, 0, channel); }
+            void sendPitchBend(int bend, Channel channel) {
+                unsigned value = bend + 8192;
+                send(PitchBend, value & 0x7f, (value >> 7) & 0x7f, channel);
+            }
+            void sendSysEx(unsigned length, const byte *data, bool containsFrameBoundaries = false) {
+                if (!containsFrameBoundaries) transport.write(SystemExclusive);
+                for (unsigned i = 0; i < length; i++) transport.write(data[i]);
+                if (!containsFrameBoundaries) transport.write(SystemExclusiveEnd);
+            }
+            void sendRealTime(MidiType type) { transport.write(type); }
+            void send(MidiType type, DataByte d1, DataByte d2, Channel channel) {
+                transport.write(type | ((channel - 1) & 0x0f));
+                transport.write(d1 & 0x7f);
+                if (type != ProgramChange && type != AfterTouchChannel) {
+                    transport.write(d2 & 0x7f);
+                }
+            }
+
+            void setHandleNoteOff(void (*fptr)(byte channel, byte note, byte velocity)) { handle_note_off = fptr; }
+            void setHandleNoteOn(void (*fptr)(byte channel, byte note, byte velocity)) { handle_note_on = fptr; }
+            void setHandleAfterTouchPoly(void (*fptr)(byte channel, byte note, byte pressure)) { handle_after_touch_poly = fptr; }
+            void setHandleControlChange(void (*fptr)(byte channel, byte number, byte value)) { handle_control_change = fptr; }
+            void setHandleProgramChange(void (*fptr)(byte channel, byte number)) { handle_program_change = fptr; }
+            void setHandleAfterTouchChannel(void (*fptr)(byte channel, byte pressure)) { handle_after_touch_channel = fptr; }
+            void setHandlePitchBend(void (*fptr)(byte channel, int bend)) { handle_pitch_bend = fptr; }
+            void setHandleSystemExclusive(void (*fptr)(byte *array, unsigned size)) { handle_sysex = fptr; }
+            void setHandleTimeCodeQuarterFrame(void (*fptr)(byte data)) { handle_time_code = fptr; }
+            void setHandleSongPosition(void (*fptr)(unsigned beats)) { handle_song_position = fptr; }
+            void setHandleSongSelect(void (*fptr)(byte songnumber)) { handle_song_select = fptr; }
+            void setHandleTuneRequest(void (*fptr)()) { handle_tune_request = fptr; }
+            void setHandleClock(void (*fptr)()) { handle_clock = fptr; }
+            void setHandleStart(void (*fptr)()) { handle_start = fptr; }
+            void setHandleContinue(void (*fptr)()) { handle_continue = fptr; }
+            void setHandleStop(void (*fptr)()) { handle_stop = fptr; }
+            void setHandleActiveSensing(void (*fptr)()) { handle_active_sensing = fptr; }
+            void setHandleSystemReset(void (*fptr)()) { handle_system_reset = fptr; }
+
+        private:
+            Transport &transport;
+            Channel input_channel = 1;
+            byte running_status = 0;
+            byte pending[3];
+            uint8_t pending_count = 0;
+            byte sysex[SysExMaxSize];
+            unsigned sysex_count = 0;
+            bool in_sysex = false;
+
+            void (*handle_note_off)(byte, byte, byte) = nullptr;
+            void (*handle_note_on)(byte, byte, byte) = nullptr;
+            void (*handle_after_touch_poly)(byte, byte, byte) = nullptr;
+            void (*handle_control_change)(byte, byte, byte) = nullptr;
+            void (*handle_program_change)(byte, byte) = nullptr;
+            void (*handle_after_touch_channel)(byte, byte) = nullptr;
+            void (*handle_pitch_bend)(byte, int) = nullptr;
+            void (*handle_sysex)(byte *, unsigned) = nullptr;
+            void (*handle_time_code)(byte) = nullptr;
+            void (*handle_song_position)(unsigned) = nullptr;
+            void (*handle_song_select)(byte) = nullptr;
+            void (*handle_tune_request)() = nullptr;
+            void (*handle_clock)() = nullptr;
+            void (*handle_start)() = nullptr;
+            void (*handle_continue)() = nullptr;
+            void (*handle_stop)() = nullptr;
+            void (*handle_active_sensing)() = nullptr;
+            void (*handle_system_reset)() = nullptr;
+
+            static uint8_t dataLength(byte status) {
+                switch (status & 0xf0) {
+                    case ProgramChange:
+                    case AfterTouchChannel:
+                        return 1;
+                    case 0xf0:
+                        switch (status) {
+                            case TimeCodeQuarterFrame:
+                            case SongSelect:
+                                return 1;
+                            case SongPosition:
+                                return 2;
+                            default:
+                                return 0;
+                        }
+                    default:
+                        return 2;
+                }
+            }
+
+            bool realTime(byte b);
+            void flushSysEx();
+            void dispatch(byte status);
+    };
+
+    template<class Transport>
+    bool MidiInterface<Transport>::realTime(byte b) {
+        void (*fn)() = nullptr;
+        switch (b) {
+            case Clock: fn = handle_clock; break;
+            case Start: fn = handle_start; break;
+            case Continue: fn = handle_continue; break;
+            case Stop: fn = handle_stop; break;
+            case ActiveSensing: fn = handle_active_sensing; break;
+            case SystemReset: fn = handle_system_reset; break;
+            default: return false;
+        }
+        HandlerTiming timing(b);
+        if (fn) fn();
+        return true;
+    }
+
+    template<class Transport>
+    void MidiInterface<Transport>::flushSysEx() {
+        if (sysex_count) {
+            HandlerTiming timing(SystemExclusive);
+            if (handle_sysex) handle_sysex(sysex, sysex_count);
+        }
+        sysex_count = 0;
+    }
+
+    template<class Transport>
+    void MidiInterface<Transport>::dispatch(byte status) {
+        auto type = status < 0xf0 ? (status & 0xf0) : status;
+        Channel channel = (status & 0x0f) + 1;
+        if (status < 0xf0 && input_channel != MIDI_CHANNEL_OMNI && input_channel != channel) {
+            return;
+        }
+        HandlerTiming timing(type);
+        switch (type) {
+            case NoteOff: if (handle_note_off) handle_note_off(channel, pending[0], pending[1]); break;
+            case NoteOn: if (handle_note_on) handle_note_on(channel, pending[0], pending[1]); break;
+            case AfterTouchPoly: if (handle_after_touch_poly) handle_after_touch_poly(channel, pending[0], pending[1]); break;
+            case ControlChange: if (handle_control_change) handle_control_change(channel, pending[0], pending[1]); break;
+            case ProgramChange: if (handle_program_change) handle_program_change(channel, pending[0]); break;
+            case AfterTouchChannel: if (handle_after_touch_channel) handle_after_touch_channel(channel, pending[0]); break;
+            case PitchBend:
+                if (handle_pitch_bend) handle_pitch_bend(channel, ((pending[1] << 7) | pending[0]) - 8192);
+                break;
+            case TimeCodeQuarterFrame: if (handle_time_code) handle_time_code(pending[0]); break;
+            case SongPosition: if (handle_song_position) handle_song_position((pending[1] << 7) | pending[0]); break;
+            case SongSelect: if (handle_song_select) handle_song_select(pending[0]); break;
+            case TuneRequest: if (handle_tune_request) handle_tune_request(); break;
+        }
+    }
+
+    template<class Transport>
+    bool MidiInterface<Transport>::read() {
+        if (input_channel == MIDI_CHANNEL_OFF) {
+            return false;
+        }
+        while (transport.available()) {
+            auto b = transport.read();
+            if (b >= 0xf8) {
+                if (realTime(b)) return true;
+                continue;
+            }
+            if (in_sysex) {
+                if (b < 0x80) {
+                    sysex[sysex_count++] = b;
+                    if (sysex_count == SysExMaxSize) {
+                        flushSysEx();
+                        return true;
+                    }
+                    continue;
+                }
+                in_sysex = false;
+                if (b == SystemExclusiveEnd) {
+                    sysex[sysex_count++] = b;
+                    flushSysEx();
+                    return true;
+                }
+                // Any other status byte terminates the SysEx; fall through and process it.
+                flushSysEx();
+            }
+            if (b & 0x80) {
+                if (b == SystemExclusive) {
+                    in_sysex = true;
+                    sysex_count = 0;
+                    sysex[sysex_count++] = b;
+                    running_status = 0;
+                    continue;
+                }
+                pending_count = 0;
+                if (dataLength(b) == 0) {
+                    running_status = 0;
+                    dispatch(b);
+                    return true;
+                }
+                running_status = b;
+                continue;
+            }
+            if (!running_status) {
+                continue;
+            }
+            pending[pending_count++] = b;
+            if (pending_count == dataLength(running_status)) {
+                pending_count = 0;
+                auto status = running_status;
+                if (status >= 0xf0) {
+                    running_status = 0;
+                }
+                dispatch(status);
+                return true;
+            }
+        }
+        return false;
+    }
+}
+
+#define USBMIDI_CREATE_INSTANCE(CableNr, Name) \
+    usbMidi::usbMidiTransport usb##Name(CableNr); \
+    midi::MidiInterface<usbMidi::usbMidiTransport> Name((usbMidi::usbMidiTransport&)usb##Name);
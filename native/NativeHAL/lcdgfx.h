@@ -0,0 +1,137 @@
+/**
+ * @copyright Copyright (c) 2021 Bob Kerns
+ * License: MIT
+ */
+// Host-side stand-in for lexus2k/lcdgfx: just the types and the one display the firmware uses.
+// The display keeps an image of the SSD1306 GDRAM and counts the bytes that would have gone
+// over I2C, so drawing cost can be measured without a panel.
+#pragma once
+#include <Arduino.h>
+
+typedef int lcdint_t;
+typedef unsigned int lcduint_t;
+
+typedef struct {
+    lcdint_t x;
+    lcdint_t y;
+} NanoPoint;
+
+typedef struct {
+    NanoPoint p1;
+    NanoPoint p2;
+} NanoRect;
+
+enum EFontStyle {
+    STYLE_NORMAL,
+    STYLE_BOLD,
+    STYLE_ITALIC,
+};
+
+enum EFontSize {
+    FONT_SIZE_NORMAL = 0,
+    FONT_SIZE_2X = 1,
+    FONT_SIZE_4X = 2,
+    FONT_SIZE_8X = 3,
+};
+
+typedef struct {
+    uint8_t width;
+    uint8_t height;
+    uint8_t spacing;
+    const uint8_t *glyph;
+} SCharInfo;
+
+// Fixed fonts only. Header is { type, width, height, first char }, followed by the glyphs,
+// each stored as width bytes for each 8-pixel page, top page first.
+class NanoFont {
+    public:
+        void loadFixedFont(const uint8_t *progmemFont);
+        void loadFreeFont(const uint8_t *progmemFont) { loadFixedFont(progmemFont); }
+        void loadSecondaryFont(const uint8_t *progmemFont) { (void)progmemFont; }
+        void setSpacing(uint8_t spacing) { m_spacing = spacing; }
+        // Glyph for a character; glyph is nullptr if the font does not have it.
+        void getCharBitmap(uint16_t ch, SCharInfo *info) const;
+    private:
+        const uint8_t *m_data = nullptr;
+        uint8_t m_width = 0;
+        uint8_t m_height = 0;
+        uint8_t m_first = 0;
+        uint8_t m_count = 0;
+        uint8_t m_spacing = 0;
+};
+
+extern NanoFont g_canvas_font;
+extern const uint8_t *const ssd1306xled_font6x8;
+extern const uint8_t *const ssd1306xled_font8x16;
+
+class DisplaySSD1306_128x64_I2C {
+    public:
+        static const lcduint_t WIDTH = 128;
+        static const lcduint_t HEIGHT = 64;
+        static const lcduint_t PAGES = HEIGHT / 8;
+
+        explicit DisplaySSD1306_128x64_I2C(int8_t rstPin) { (void)rstPin; }
+
+        void begin();
+        void end() {}
+
+        lcduint_t width() const { return WIDTH; }
+        lcduint_t height() const { return HEIGHT; }
+
+        void setFont(NanoFont &font) { m_font = &font; }
+        void setFixedFont(const uint8_t *progmemFont) {
+            g_canvas_font.loadFixedFont(progmemFont);
+            setFont(g_canvas_font);
+        }
+        void setColor(uint16_t color) { m_color = color; }
+        uint16_t getColor() const { return m_color; }
+        void setBackground(uint16_t color) { m_bgColor = color; }
+        void invertColors() { std::swap(m_color, m_bgColor); }
+        void setTextCursor(lcdint_t x, lcdint_t y) { m_cursorX = x; m_cursorY = y; }
+
+        void putPixel(lcdint_t x, lcdint_t y);
+        void drawVLine(lcdint_t x1, lcdint_t y1, lcdint_t y2);
+        void drawHLine(lcdint_t x1, lcdint_t y1, lcdint_t x2);
+        void fillRect(lcdint_t x1, lcdint_t y1, lcdint_t x2, lcdint_t y2);
+        void drawXBitmap(lcdint_t x, lcdint_t y, lcduint_t w, lcduint_t h, const uint8_t *bitmap);
+        void drawBitmap1(lcdint_t x, lcdint_t y, lcduint_t w, lcduint_t h, const uint8_t *bitmap);
+        void gfx_drawMonoBitmap(lcdint_t x, lcdint_t y, lcduint_t w, lcduint_t h, const uint8_t *buf);
+        void drawBitmap4(lcdint_t x, lcdint_t y, lcduint_t w, lcduint_t h, const uint8_t *bitmap);
+        void drawBitmap8(lcdint_t x, lcdint_t y, lcduint_t w, lcduint_t h, const uint8_t *bitmap);
+        void drawBitmap16(lcdint_t x, lcdint_t y, lcduint_t w, lcduint_t h, const uint8_t *bitmap);
+        void drawBuffer1(lcdint_t x, lcdint_t y, lcduint_t w, lcduint_t h, const uint8_t *buffer);
+        void drawBuffer4(lcdint_t x, lcdint_t y, lcduint_t w, lcduint_t h, const uint8_t *buffer);
+        void drawBuffer8(lcdint_t x, lcdint_t y, lcduint_t w, lcduint_t h, const uint8_t *buffer);
+        void drawBuffer16(lcdint_t x, lcdint_t y, lcduint_t w, lcduint_t h, const uint8_t *buffer);
+        void clear();
+        void fill(uint16_t color);
+        uint8_t printChar(uint8_t c);
+        size_t write(uint8_t c);
+        void printFixed(lcdint_t xpos, lcdint_t y, const char *ch, EFontStyle style = STYLE_NORMAL);
+        void printFixedN(lcdint_t xpos, lcdint_t y, const char *ch, EFontStyle style, uint8_t factor);
+
+        // Native-only instrumentation.
+        const uint8_t *gdram() const { return m_gdram; }
+        uint32_t bytesSent() const { return m_bytes_sent; }
+        void resetBytesSent() { m_bytes_sent = 0; }
+
+    private:
+        uint8_t m_gdram[PAGES * WIDTH] = {};
+        uint32_t m_bytes_sent = 0;
+        NanoFont *m_font = nullptr;
+        uint16_t m_color = 0xFFFF;
+        uint16_t m_bgColor = 0x0000;
+        lcdint_t m_cursorX = 0;
+        lcdint_t m_cursorY = 0;
+
+        // Write one page byte, counting it as one byte over I2C.
+        void send(lcdint_t x, lcdint_t page, uint8_t data);
+        // Foreground/background blend of a page byte.
+        uint8_t blend(uint8_t bits) const {
+            return (m_color ? bits : 0) | (m_bgColor ? (uint8_t)~bits : 0);
+        }
+        // Draw a w x h area, pixel by pixel; on(col, row) says whether a pixel is foreground.
+        template<typename F>
+        void area(lcdint_t x, lcdint_t y, lcduint_t w, lcduint_t h, F on);
+        void glyph(lcdint_t x, lcdint_t y, uint8_t c, EFontStyle style, uint8_t factor);
+};
@@ -0,0 +1,186 @@
+#!/usr/bin/env python3
+"""Compile patch lists into NamePools for the firmware.
+
+Each patches/<list>.csv becomes a NamePool named <list>, declared in lib/Patches/Patches.h.
+A CSV has a program column (the MIDI program number, from 0) and a name column; a header row
+naming them is optional, and lines starting with # are comments. Programs missing from the
+list are named by number, so a menu index is always its program number.
+
+A list whose header also names msb and lsb columns spans banks: its entries stay in the order
+given, and each carries the bank select MSB and LSB (CC 0 and CC 32) to send before its program.
+
+All the lists share one block of names. A name already stored, whole or as the end of a longer
+name, is not stored again.
+
+Run by PlatformIO before each build (see extra_scripts in platformio.ini), which rewrites the
+output only if it changed, or by hand:
+    tools/patchlists.py [-o lib/Patches] [-n Patches] [patches/*.csv]
+
+The native build also compiles the lists in native/patches, used by its checks, into
+native/NativeHAL/FixturePatches.h and .cpp.
+"""
+import argparse
+import csv
+import glob
+import os
+import re
+import sys
+
+HEADER = """/**
+ * @copyright Copyright (c) 2021 Bob Kerns
+ * License: MIT
+ */
+// Generated by tools/patchlists.py from {sources}. Do not edit.
+"""
+
+
+def read_list(path):
+    """The names of a list, and for a list with banks, (msb, lsb, program) for each."""
+    columns = {'program': 0, 'name': 1}
+    entries = []
+    with open(path, newline='', encoding='utf-8') as f:
+        rows = csv.reader(line for line in f if not line.lstrip().startswith('#'))
+        for n, row in enumerate(rows):
+            if not row or not ''.join(row).strip():
+                continue
+            row = [cell.strip() for cell in row]
+            if n == 0 and not row[0].isdigit():
+                columns = {name.lower(): i for i, name in enumerate(row)}
+                if 'program' not in columns or 'name' not in columns:
+                    raise ValueError(f"{path}: header must name program and name columns")
+                continue
+            if len(row) < len(columns):
+                raise ValueError(f"{path}: row {n + 1}: expected {','.join(columns)}")
+            fields = {}
+            for key in ('msb', 'lsb', 'program'):
+                if key in columns:
+                    value = row[columns[key]]
+                    if not value.isdigit() or int(value) > 127:
+                        raise ValueError(f"{path}: row {n + 1}: bad {key} {value!r}")
+                    fields[key] = int(value)
+            name = row[columns['name']]
+            try:
+                name.encode('ascii')
+            except UnicodeEncodeError:
+                raise ValueError(f"{path}: row {n + 1}: {name!r} is not ASCII")
+            entries.append(((fields.get('msb', 0), fields.get('lsb', 0), fields['program']), name, n + 1))
+    if not entries:
+        raise ValueError(f"{path}: no programs")
+    seen = {}
+    for patch, name, row in entries:
+        if patch in seen:
+            raise ValueError(f"{path}: row {row}: same program as row {seen[patch]}")
+        seen[patch] = row
+    if 'msb' in columns or 'lsb' in columns:
+        if len(entries) > 0xffff:
+            raise ValueError(f"{path}: too many entries")
+        return [name for _, name, _ in entries], [patch for patch, _, _ in entries]
+    names = {patch[2]: name for patch, name, _ in entries}
+    return [names.get(p, str(p)) for p in range(max(names) + 1)], None
+
+
+def pack(lists):
+    """Place every name in one block; returns the block and each list's offsets."""
+    block = bytearray()
+    placed = {}
+    # Longest first, so shorter names can be found at the ends of longer ones.
+    for name in sorted({n for names in lists.values() for n in names}, key=lambda n: (-len(n), n)):
+        entry = name.encode('ascii') + b'\0'
+        at = block.find(entry)
+        if at < 0:
+            at = len(block)
+            block += entry
+        placed[name] = at
+    if len(block) > 0x10000:
+        raise ValueError("names take more than 64K")
+    return block, {key: [placed[n] for n in names] for key, names in lists.items()}
+
+
+def c_string(data, width=96):
+    """The block as C string literals, one name per piece."""
+    lines, line = [], '    "'
+    for name in data.split(b'\0')[:-1]:
+        text = name.decode('ascii').replace('\\', '\\\\').replace('"', '\\"').replace('?', '\\?')
+        piece = text + '\\0" "'
+        if len(line) + len(piece) > width and line != '    "':
+            lines.append(line[:-2])
+            line = '    "'
+        line += piece
+    lines.append(line[:-2])
+    return '\n'.join(lines)
+
+
+def generate(sources, outdir, root, basename='Patches'):
+    lists = {}
+    patches = {}
+    for path in sources:
+        key = os.path.splitext(os.path.basename(path))[0]
+        if not re.fullmatch(r'[A-Za-z_][A-Za-z0-9_]*', key):
+            raise ValueError(f"{path}: name must be a C identifier")
+        lists[key], patches[key] = read_list(path)
+    block, offsets = pack(lists)
+    names = sorted(lists)
+    rel = ', '.join(os.path.relpath(p, root) for p in sources)
+
+    header = HEADER.format(sources=rel) + "#pragma once\n#include <NamePool.h>\n\n"
+    for key in names:
+        banks = ", with banks" if patches[key] else ""
+        header += f"// {len(lists[key])} names{banks}, from {key}.csv.\nextern const NamePool {key};\n"
+
+    body = HEADER.format(sources=rel) + f'#include <Arduino.h>\n#include "{basename}.h"\n\n'
+    body += f"static const char names[] PROGMEM =\n{c_string(block)};\n"
+    for key in names:
+        values = offsets[key]
+        rows = [', '.join(str(v) for v in values[i:i + 16]) for i in range(0, len(values), 16)]
+        body += f"\nstatic const uint16_t {key}_offsets[] PROGMEM = {{\n    " + ',\n    '.join(rows) + "\n};\n"
+        if patches[key]:
+            rows = [', '.join(f"{m}, {l}, {p}" for m, l, p in patches[key][i:i + 5])
+                    for i in range(0, len(patches[key]), 5)]
+            body += f"\n// MSB, LSB, program\nstatic const uint8_t {key}_patches[] PROGMEM = {{\n    " + ',\n    '.join(rows) + "\n};\n"
+            body += f"const NamePool {key} = {{{len(values)}, {key}_offsets, names, {key}_patches}};\n"
+        else:
+            body += f"const NamePool {key} = {{{len(values)}, {key}_offsets, names}};\n"
+
+    os.makedirs(outdir, exist_ok=True)
+    for name, text in ((basename + ".h", header), (basename + ".cpp", body)):
+        path = os.path.join(outdir, name)
+        old = open(path, encoding='utf-8').read() if os.path.exists(path) else None
+        if text != old:
+            with open(path, 'w', encoding='utf-8') as f:
+                f.write(text)
+
+    total = sum(len(v) for v in lists.values())
+    separate = sum(4 + len(n) + 1 for v in lists.values() for n in v) + sum(3 * len(p) for p in patches.values() if p)
+    pooled = len(block) + 2 * total + sum(3 * len(p) for p in patches.values() if p)
+    return total, separate, pooled
+
+
+def main(argv, root):
+    parser = argparse.ArgumentParser(description=__doc__.split('\n\n')[0])
+    parser.add_argument('-o', '--outdir', default=os.path.join(root, 'lib', 'Patches'))
+    parser.add_argument('-n', '--name', default='Patches', help="base name of the .h and .cpp written")
+    parser.add_argument('sources', nargs='*')
+    args = parser.parse_args(argv)
+    sources = sorted(args.sources or glob.glob(os.path.join(root, 'patches', '*.csv')))
+    try:
+        total, separate, pooled = generate(sources, args.outdir, root, args.name)
+    except ValueError as e:
+        print(f"patchlists: {e}", file=sys.stderr)
+        return 1
+    print(f"patchlists: {total} names in {pooled} bytes ({separate} as separate strings and pointers)")
+    return 0
+
+
+try:
+    Import("env")  # noqa: F821 -- defined when run by PlatformIO
+except NameError:
+    if __name__ == '__main__':
+        sys.exit(main(sys.argv[1:], os.path.dirname(os.path.dirname(os.path.abspath(__file__)))))
+else:
+    project = env.subst("$PROJECT_DIR")  # noqa: F821
+    if main([], project):
+        env.Exit(1)  # noqa: F821
+    if env.subst("$PIOENV") == "native":  # noqa: F821
+        fixtures = sorted(glob.glob(os.path.join(project, 'native', 'patches', '*.csv')))
+        if fixtures and main(['-o', os.path.join(project, 'native', 'NativeHAL'), '-n', 'FixturePatches'] + fixtures, project):
+            env.Exit(1)  # noqa: F821